@@ -0,0 +1,33 @@
+// arena.cpp
+
+// Internal
+#include <sympp/core/arena.h>
+#include <sympp/core/unique_table.h>
+
+namespace sympp {
+
+    thread_local std::pmr::memory_resource *arena::current_{nullptr};
+
+    arena::arena() : resource_(&buffer_), previous_(current_) {
+        current_ = resource_;
+    }
+
+    arena::arena(std::pmr::memory_resource *r)
+        : resource_(r), previous_(current_) {
+        current_ = resource_;
+    }
+
+    arena::~arena() {
+        current_ = previous_;
+        // The unique table might still point to the control blocks of
+        // nodes in this arena. Drop them while the memory is valid.
+        if (resource_) {
+            unique_table::purge();
+        }
+    }
+
+    std::pmr::memory_resource *arena::resource() const { return resource_; }
+
+    std::pmr::memory_resource *arena::current() { return current_; }
+
+} // namespace sympp
@@ -0,0 +1,60 @@
+// arena.h
+
+#ifndef SYMPP_ARENA_H
+#define SYMPP_ARENA_H
+
+// C++
+#include <cstddef>
+#include <memory_resource>
+
+namespace sympp {
+    /// \class Memory arena for expression nodes
+    /// While an arena is alive, the nodes created in the same thread
+    /// (and the control blocks of the shared pointers holding them)
+    /// are allocated from the arena memory resource instead of the
+    /// heap. Arenas can be nested: the innermost arena is used.
+    /// By default, the arena owns a monotonic buffer, so freeing a
+    /// node is a no-op and the whole buffer is released at once when
+    /// the arena is destroyed.
+    /// Syms created inside the arena must be destroyed before the
+    /// arena itself.
+    class arena {
+      public:
+        /// Allocate nodes from a monotonic buffer owned by the arena
+        arena();
+
+        /// Allocate nodes from a memory resource supplied by the caller
+        /// A null resource allocates from the heap inside other arenas.
+        explicit arena(std::pmr::memory_resource *);
+
+        arena(const arena &) = delete;
+
+        arena &operator=(const arena &) = delete;
+
+        /// Restore the previous arena and release the memory owned
+        /// by this arena
+        ~arena();
+
+        /// Memory resource nodes are allocated from
+        [[nodiscard]] std::pmr::memory_resource *resource() const;
+
+        /// Memory resource of the innermost arena in this thread
+        /// This is nullptr if there is no arena
+        [[nodiscard]] static std::pmr::memory_resource *current();
+
+      private:
+        /// Monotonic buffer for the default arena
+        std::pmr::monotonic_buffer_resource buffer_;
+
+        /// Resource nodes are allocated from
+        std::pmr::memory_resource *resource_;
+
+        /// Arena we should restore when this arena is destroyed
+        std::pmr::memory_resource *previous_;
+
+        /// Innermost arena in this thread
+        static thread_local std::pmr::memory_resource *current_;
+    };
+} // namespace sympp
+
+#endif // SYMPP_ARENA_H
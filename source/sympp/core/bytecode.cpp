@@ -0,0 +1,464 @@
+// bytecode.cpp
+
+// C++
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+
+// Internal
+#include <sympp/core/bytecode.h>
+#include <sympp/node/function/pow.h>
+#include <sympp/node/terminal/constant.h>
+#include <sympp/node/terminal/variable.h>
+
+// GCC and Clang can jump to the address of a label. This is an
+// extension, so run silences the pedantic warnings about it.
+#if defined(__GNUC__)
+#define SYMPP_DIRECT_THREADING
+#endif
+
+namespace sympp {
+
+    namespace {
+        /// True if a leaf of the tape has its value in a register
+        bool is_constant_leaf(node_kind k) {
+            return is_number_kind(k) || k == node_kind::constant;
+        }
+
+        /// True if instruction i of the tape is the constant e
+        bool is_e_leaf(const tape &t, uint32_t i) {
+            const tape::instruction &in = t.instructions()[i];
+            return tape::is_leaf(in.kind) &&
+                   constant::is_e(t.leaves()[in.first]);
+        }
+    } // namespace
+
+    bytecode::bytecode(const sym &s, polynomial_form form) {
+        sym prepared = s;
+        prepared.fold_constants();
+        if (form == polynomial_form::horner) {
+            prepared.horner();
+        } else if (form == polynomial_form::estrin) {
+            prepared.estrin();
+        }
+        const tape t(prepared);
+        leaves_ = t.leaves();
+        const std::vector<tape::instruction> &ins = t.instructions();
+        const std::vector<uint32_t> &ops = t.operands();
+        const size_t n = ins.size();
+        auto operand = [&](size_t i, uint32_t k) {
+            return ops[ins[i].first + k];
+        };
+
+        // count the parents of each instruction
+        constexpr auto none = static_cast<uint32_t>(-1);
+        std::vector<uint32_t> uses(n, 0);
+        std::vector<uint32_t> parent(n, none);
+        for (size_t i = 0; i < n; ++i) {
+            for (uint32_t k = 0; k < ins[i].arity; ++k) {
+                ++uses[operand(i, k)];
+                parent[operand(i, k)] = static_cast<uint32_t>(i);
+            }
+        }
+
+        // instructions evaluated by their parent: x^-1 in products
+        // becomes a division, and then a*b in sums becomes a mul_add
+        std::vector<uint8_t> fused(n, 0);
+        for (size_t i = 0; i < n; ++i) {
+            if (ins[i].kind != node_kind::pow || uses[i] != 1) {
+                continue;
+            }
+            const uint32_t p = parent[i];
+            const pow::lowering l = t.power(i);
+            if (ins[p].kind == node_kind::product && operand(p, 0) != i &&
+                l.op == pow::lowering::integer && l.exponent == -1) {
+                fused[i] = 1;
+            }
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (ins[i].kind != node_kind::product || ins[i].arity != 2 ||
+                uses[i] != 1 || ins[parent[i]].kind != node_kind::summation ||
+                fused[operand(i, 1)]) {
+                continue;
+            }
+            fused[i] = 1;
+        }
+
+        // sin(x) and cos(x) are evaluated together where the first of
+        // them is
+        std::vector<uint32_t> partner(n, none);
+        {
+            std::vector<uint32_t> first_sin(n, none);
+            std::vector<uint32_t> first_cos(n, none);
+            for (size_t i = 0; i < n; ++i) {
+                const bool is_sin = ins[i].kind == node_kind::sin;
+                if (!is_sin && ins[i].kind != node_kind::cos) {
+                    continue;
+                }
+                const uint32_t x = operand(i, 0);
+                uint32_t &mine = is_sin ? first_sin[x] : first_cos[x];
+                const uint32_t other = is_sin ? first_cos[x] : first_sin[x];
+                if (mine != none) {
+                    continue;
+                }
+                mine = static_cast<uint32_t>(i);
+                if (other != none) {
+                    partner[other] = static_cast<uint32_t>(i);
+                    partner[i] = other;
+                }
+            }
+        }
+
+        // position where each instruction is evaluated
+        auto position = [&](size_t i) -> size_t {
+            if (fused[i]) {
+                return parent[i];
+            }
+            if (partner[i] != none) {
+                return std::min<size_t>(i, partner[i]);
+            }
+            return i;
+        };
+        std::vector<size_t> last_use(n, 0);
+        for (size_t i = 0; i < n; ++i) {
+            for (uint32_t k = 0; k < ins[i].arity; ++k) {
+                const uint32_t o = operand(i, k);
+                last_use[o] = std::max(last_use[o], position(i));
+            }
+        }
+
+        // numbers and constants go to the first registers
+        std::vector<uint32_t> reg(n, none);
+        for (size_t i = 0; i < n; ++i) {
+            if (is_constant_leaf(ins[i].kind)) {
+                reg[i] = static_cast<uint32_t>(constants_.size());
+                constants_.emplace_back(t.values()[ins[i].first]);
+            }
+        }
+        registers_ = constants_.size();
+        std::vector<uint32_t> free_registers;
+        auto allocate = [&](size_t i) {
+            if (free_registers.empty()) {
+                reg[i] = static_cast<uint32_t>(registers_++);
+            } else {
+                reg[i] = free_registers.back();
+                free_registers.pop_back();
+            }
+            return reg[i];
+        };
+        // registers of the operands are free after their last use
+        auto release = [&](uint32_t o, size_t i) {
+            if (last_use[o] == i && reg[o] != none &&
+                !is_constant_leaf(ins[o].kind)) {
+                free_registers.emplace_back(reg[o]);
+                // operands repeated in the same node are freed once
+                last_use[o] = none;
+            }
+        };
+        auto emit = [&](opcode op, uint32_t r, uint32_t a = 0, uint32_t b = 0,
+                        uint32_t c = 0, int k = 0) {
+            code_.push_back({nullptr, op, r, a, b, c, k});
+        };
+
+        for (size_t i = 0; i < n; ++i) {
+            const tape::instruction &in = ins[i];
+            if (fused[i] || reg[i] != none) {
+                // fused, constant, or the second of sin and cos
+                continue;
+            }
+            const uint32_t r = allocate(i);
+            auto arg = [&](uint32_t k) { return reg[operand(i, k)]; };
+            switch (in.kind) {
+            case node_kind::variable: {
+                const auto *v = leaves_[in.first].node_as<variable>();
+                const auto index = static_cast<uint32_t>(v->index());
+                switch (v->num_type()) {
+                case numeric_type::var_boolean:
+                    emit(opcode::load_bool, r, index);
+                    break;
+                case numeric_type::var_integer:
+                    emit(opcode::load_int, r, index);
+                    break;
+                default:
+                    emit(opcode::load_double, r, index);
+                    break;
+                }
+                break;
+            }
+            case node_kind::summation:
+            case node_kind::product: {
+                const bool is_sum = in.kind == node_kind::summation;
+                // the first term is the accumulator
+                uint32_t acc = arg(0);
+                if (const uint32_t o = operand(i, 0); fused[o]) {
+                    emit(opcode::multiply, r, reg[operand(o, 0)],
+                         reg[operand(o, 1)]);
+                    acc = r;
+                }
+                for (uint32_t k = 1; k < in.arity; ++k) {
+                    const uint32_t t_k = operand(i, k);
+                    if (!fused[t_k]) {
+                        emit(is_sum ? opcode::add : opcode::multiply, r, acc,
+                             reg[t_k]);
+                    } else if (is_sum) {
+                        emit(opcode::mul_add, r, reg[operand(t_k, 0)],
+                             reg[operand(t_k, 1)], acc);
+                    } else {
+                        emit(opcode::divide, r, acc, reg[operand(t_k, 0)]);
+                    }
+                    acc = r;
+                }
+                break;
+            }
+            case node_kind::pow: {
+                const pow::lowering l = t.power(i);
+                switch (l.op) {
+                case pow::lowering::integer:
+                    emit(opcode::pow_int, r, arg(0), 0, 0, l.exponent);
+                    break;
+                case pow::lowering::square_root:
+                    emit(l.exponent > 0 ? opcode::sqrt : opcode::rsqrt, r,
+                         arg(0));
+                    break;
+                case pow::lowering::exp:
+                    emit(opcode::exp, r, arg(1));
+                    break;
+                default:
+                    emit(opcode::pow, r, arg(0), arg(1));
+                    break;
+                }
+                break;
+            }
+            case node_kind::log:
+                if (is_e_leaf(t, operand(i, 1))) {
+                    emit(opcode::log, r, arg(0));
+                } else {
+                    emit(opcode::log_base, r, arg(0), arg(1));
+                }
+                break;
+            case node_kind::sin:
+            case node_kind::cos:
+                if (partner[i] != none) {
+                    const uint32_t other = allocate(partner[i]);
+                    const bool is_sin = in.kind == node_kind::sin;
+                    emit(opcode::sincos, is_sin ? r : other, arg(0),
+                         is_sin ? other : r);
+                } else {
+                    emit(in.kind == node_kind::sin ? opcode::sin
+                                                   : opcode::cos,
+                         r, arg(0));
+                }
+                break;
+            case node_kind::sinh:
+                emit(opcode::sinh, r, arg(0));
+                break;
+            case node_kind::cosh:
+                emit(opcode::cosh, r, arg(0));
+                break;
+            case node_kind::abs:
+                emit(opcode::abs, r, arg(0));
+                break;
+            default:
+                // nodes we cannot decompose evaluate their subtree
+                emit(opcode::call, r, in.first);
+                break;
+            }
+            // free the operands, and the operands of fused children
+            for (uint32_t k = 0; k < in.arity; ++k) {
+                const uint32_t o = operand(i, k);
+                if (fused[o]) {
+                    for (uint32_t j = 0; j < ins[o].arity; ++j) {
+                        release(operand(o, j), i);
+                    }
+                }
+                release(o, i);
+            }
+        }
+        emit(opcode::halt, 0, n == 0 ? 0 : reg[n - 1]);
+
+#ifdef SYMPP_DIRECT_THREADING
+        const void *const *labels = nullptr;
+        run(nullptr, nullptr, {}, {}, {}, {}, &labels);
+        for (instruction &c : code_) {
+            c.handler = labels[static_cast<size_t>(c.op)];
+        }
+#endif
+    }
+
+    const std::vector<bytecode::instruction> &bytecode::instructions() const {
+        return code_;
+    }
+
+    size_t bytecode::registers() const { return registers_; }
+
+    double bytecode::evaluate(const std::vector<uint8_t> &bool_values,
+                              const std::vector<int> &int_values,
+                              const std::vector<double> &double_values) const {
+        if (constants_.empty() && registers_ == 0) {
+            // empty expression
+            return 0.;
+        }
+        // small programs keep their registers on the stack
+        constexpr size_t stack_registers = 64;
+        std::array<double, stack_registers> small;
+        std::unique_ptr<double[]> large;
+        double *registers = small.data();
+        if (registers_ > stack_registers) {
+            large = std::make_unique<double[]>(registers_);
+            registers = large.get();
+        }
+        std::copy(constants_.begin(), constants_.end(), registers);
+        return run(code_.data(), registers, bool_values, int_values,
+                   double_values, leaves_, nullptr);
+    }
+
+    node_lambda bytecode::lambdify() const {
+        auto program = std::make_shared<const bytecode>(*this);
+        return [program](const std::vector<uint8_t> &bool_values,
+                         const std::vector<int> &int_values,
+                         const std::vector<double> &double_values) {
+            return program->evaluate(bool_values, int_values, double_values);
+        };
+    }
+
+#ifdef SYMPP_DIRECT_THREADING
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+    double bytecode::run(const instruction *code, double *registers,
+                         const std::vector<uint8_t> &bool_values,
+                         const std::vector<int> &int_values,
+                         const std::vector<double> &double_values,
+                         const std::vector<sym> &leaves,
+                         const void *const **labels) {
+        double *reg = registers;
+        const instruction *ip = code;
+#ifdef SYMPP_DIRECT_THREADING
+        // handlers in the order of the opcodes
+        static const void *const handlers[] = {
+            &&op_halt,     &&op_load_bool, &&op_load_int, &&op_load_double,
+            &&op_add,      &&op_multiply,  &&op_mul_add,  &&op_divide,
+            &&op_pow_int,  &&op_sqrt,      &&op_rsqrt,    &&op_exp,
+            &&op_pow,      &&op_log,       &&op_log_base, &&op_sin,
+            &&op_cos,      &&op_sincos,    &&op_sinh,     &&op_cosh,
+            &&op_abs,      &&op_call};
+        if (labels) {
+            *labels = handlers;
+            return 0.;
+        }
+#define SYMPP_OP(name) op_##name:
+#define SYMPP_NEXT                                                             \
+    ++ip;                                                                      \
+    goto *ip->handler
+        goto *ip->handler;
+        {
+#else
+        if (labels) {
+            return 0.;
+        }
+#define SYMPP_OP(name) case opcode::name:
+#define SYMPP_NEXT continue
+        for (;; ++ip) {
+            switch (ip->op) {
+#endif
+            SYMPP_OP(halt) { return reg[ip->a]; }
+            SYMPP_OP(load_bool) {
+                reg[ip->r] = static_cast<double>(bool_values[ip->a]);
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(load_int) {
+                reg[ip->r] = static_cast<double>(int_values[ip->a]);
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(load_double) {
+                reg[ip->r] = double_values[ip->a];
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(add) {
+                reg[ip->r] = reg[ip->a] + reg[ip->b];
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(multiply) {
+                reg[ip->r] = reg[ip->a] * reg[ip->b];
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(mul_add) {
+                reg[ip->r] = reg[ip->a] * reg[ip->b] + reg[ip->c];
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(divide) {
+                reg[ip->r] = reg[ip->a] / reg[ip->b];
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(pow_int) {
+                reg[ip->r] = pow::integer_power(reg[ip->a], ip->k);
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(sqrt) {
+                reg[ip->r] = std::sqrt(reg[ip->a]);
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(rsqrt) {
+                reg[ip->r] = 1. / std::sqrt(reg[ip->a]);
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(exp) {
+                reg[ip->r] = std::exp(reg[ip->a]);
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(pow) {
+                reg[ip->r] = std::pow(reg[ip->a], reg[ip->b]);
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(log) {
+                reg[ip->r] = std::log(reg[ip->a]);
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(log_base) {
+                reg[ip->r] = std::log(reg[ip->a]) / std::log(reg[ip->b]);
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(sin) {
+                reg[ip->r] = std::sin(reg[ip->a]);
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(cos) {
+                reg[ip->r] = std::cos(reg[ip->a]);
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(sincos) {
+                const double x = reg[ip->a];
+                reg[ip->r] = std::sin(x);
+                reg[ip->b] = std::cos(x);
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(sinh) {
+                reg[ip->r] = std::sinh(reg[ip->a]);
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(cosh) {
+                reg[ip->r] = std::cosh(reg[ip->a]);
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(abs) {
+                reg[ip->r] = std::abs(reg[ip->a]);
+                SYMPP_NEXT;
+            }
+            SYMPP_OP(call) {
+                reg[ip->r] = leaves[ip->a].evaluate(bool_values, int_values,
+                                                    double_values);
+                SYMPP_NEXT;
+            }
+#ifndef SYMPP_DIRECT_THREADING
+            }
+#endif
+        }
+#undef SYMPP_OP
+#undef SYMPP_NEXT
+    }
+#ifdef SYMPP_DIRECT_THREADING
+#pragma GCC diagnostic pop
+#endif
+
+} // namespace sympp
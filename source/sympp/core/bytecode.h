@@ -0,0 +1,158 @@
+// bytecode.h
+
+#ifndef SYMPP_BYTECODE_H
+#define SYMPP_BYTECODE_H
+
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Internal
+#include <sympp/core/cse.h>
+#include <sympp/core/sym.h>
+#include <sympp/core/tape.h>
+
+namespace sympp {
+    /// \class Register machine for evaluating an expression
+    /// The expression is compiled once into instructions that read
+    /// and write registers, and each evaluation runs them in a loop.
+    /// Compiling is a pass over the tape of the expression, so it
+    /// takes microseconds, while evaluating avoids the virtual calls
+    /// of the tree and the closures of lambdify. This is meant for
+    /// expressions that change too often to be worth compiling with
+    /// the C compiler.
+    ///
+    /// Some instructions fuse common patterns:
+    /// - mul_add evaluates the product terms of sums
+    /// - divide evaluates the factors x^-1 of products
+    /// - pow_int evaluates integer powers by repeated squaring
+    /// - sincos evaluates sin(x) and cos(x) together
+    ///
+    /// Registers are reused once their values are no longer needed,
+    /// so the register file stays small. Numbers and constants live in
+    /// the first registers and are never overwritten.
+    /// With GCC and Clang, each instruction stores the address of its
+    /// handler and jumps to the next one directly (direct threading).
+    /// Other compilers dispatch with a switch.
+    class bytecode {
+      public:
+        /// Operation of an instruction
+        enum class opcode : uint8_t {
+            /// Stop and return register a
+            halt,
+            /// r = bool_values[a]
+            load_bool,
+            /// r = int_values[a]
+            load_int,
+            /// r = double_values[a]
+            load_double,
+            /// r = a + b
+            add,
+            /// r = a * b
+            multiply,
+            /// r = a * b + c
+            mul_add,
+            /// r = a / b
+            divide,
+            /// r = a^k
+            pow_int,
+            /// r = sqrt(a)
+            sqrt,
+            /// r = 1 / sqrt(a)
+            rsqrt,
+            /// r = e^a
+            exp,
+            /// r = a^b
+            pow,
+            /// r = ln(a)
+            log,
+            /// r = ln(a) / ln(b)
+            log_base,
+            /// r = sin(a)
+            sin,
+            /// r = cos(a)
+            cos,
+            /// r = sin(a), b = cos(a)
+            sincos,
+            /// r = sinh(a)
+            sinh,
+            /// r = cosh(a)
+            cosh,
+            /// r = |a|
+            abs,
+            /// r = the value of opaque node a of the tape
+            call
+        };
+
+        /// \class One instruction
+        /// The operands a, b and c are registers unless the opcode
+        /// says otherwise.
+        struct instruction {
+            /// Address of the handler, for direct threading
+            const void *handler{nullptr};
+
+            /// Operation
+            opcode op{opcode::halt};
+
+            /// Register with the result
+            uint32_t r{0};
+
+            /// Operands
+            uint32_t a{0};
+            uint32_t b{0};
+            uint32_t c{0};
+
+            /// Exponent of pow_int
+            int k{0};
+        };
+
+        /// Compile an expression
+        /// The expression is prepared like in cse: constant subtrees
+        /// are folded and polynomials rewritten in the given form.
+        /// Call put_indexes on the expression first, as with evaluate.
+        explicit bytecode(const sym &,
+                          polynomial_form form = polynomial_form::horner);
+
+        /// Instructions of the program, ending with halt
+        [[nodiscard]] const std::vector<instruction> &instructions() const;
+
+        /// Number of registers the program uses
+        [[nodiscard]] size_t registers() const;
+
+        /// Evaluate the expression
+        [[nodiscard]] double
+        evaluate(const std::vector<uint8_t> &bool_values,
+                 const std::vector<int> &int_values,
+                 const std::vector<double> &double_values) const;
+
+        /// Function that evaluates the expression like evaluate
+        [[nodiscard]] node_lambda lambdify() const;
+
+      private:
+        /// Run the instructions with the given register file
+        /// If labels is not null, the function only stores the
+        /// addresses of the handlers in it, indexed by opcode.
+        static double run(const instruction *code, double *registers,
+                          const std::vector<uint8_t> &bool_values,
+                          const std::vector<int> &int_values,
+                          const std::vector<double> &double_values,
+                          const std::vector<sym> &leaves,
+                          const void *const **labels);
+
+      private:
+        /// Instructions ending with halt
+        std::vector<instruction> code_;
+
+        /// Values of the constant registers
+        std::vector<double> constants_;
+
+        /// Total number of registers
+        size_t registers_{0};
+
+        /// Leaves of the tape, for the opaque nodes
+        std::vector<sym> leaves_;
+    };
+} // namespace sympp
+
+#endif // SYMPP_BYTECODE_H
@@ -0,0 +1,639 @@
+// cse.cpp
+
+// C++
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <utility>
+
+// Internal
+#include <sympp/core/cse.h>
+#include <sympp/core/node_interface.h>
+#include <sympp/core/unique_table.h>
+#include <sympp/node/terminal/constant.h>
+#include <sympp/node/terminal/variable.h>
+
+namespace sympp {
+
+    namespace {
+        /// Evaluate a lowered power with the SIMD kernels
+        void simd_power(const pow::lowering &l, const double *x,
+                        const double *y, double *r, size_t n) {
+            switch (l.op) {
+            case pow::lowering::integer:
+                simd::integer_power(x, l.exponent, r, n);
+                break;
+            case pow::lowering::square_root:
+                simd::sqrt(x, r, n);
+                if (l.exponent < 0) {
+                    for (size_t j = 0; j < n; ++j) {
+                        r[j] = 1. / r[j];
+                    }
+                }
+                break;
+            case pow::lowering::exp:
+                simd::exp(y, r, n);
+                break;
+            default:
+                simd::pow(x, y, r, n);
+                break;
+            }
+        }
+
+        /// C expression of x^n by repeated squaring
+        /// x is the name of a variable or temporary. The squares of x
+        /// go to new temporaries in the code.
+        std::string c_power(const std::string &x, int n,
+                            const std::string &indent, std::string &code,
+                            size_t &temporaries) {
+            if (n == 0) {
+                return "1.";
+            }
+            unsigned k = n < 0 ? -static_cast<unsigned>(n) : n;
+            std::string square = x;
+            std::string r;
+            // short chains need no temporaries
+            for (; k <= 3 && k != 0; --k) {
+                r += r.empty() ? x : " * " + x;
+            }
+            while (k != 0) {
+                if (k & 1U) {
+                    r += r.empty() ? square : " * " + square;
+                }
+                k >>= 1U;
+                if (k != 0) {
+                    std::string t = "t" + std::to_string(temporaries++);
+                    code += indent + "double " + t + " = " + square +
+                            " * " + square + ";\n";
+                    square = std::move(t);
+                }
+            }
+            if (n < 0) {
+                return "(1. / (" + r + "))";
+            }
+            return r.find(' ') == std::string::npos ? r : "(" + r + ")";
+        }
+    } // namespace
+
+    cse::cse(const sym &s, polynomial_form form) {
+        sym lowered = s;
+        lowered.fold_constants();
+        if (form == polynomial_form::horner) {
+            lowered.horner();
+        } else if (form == polynomial_form::estrin) {
+            lowered.estrin();
+        }
+        visited_nodes visited;
+        root_ = add(lowered, visited);
+    }
+
+    size_t cse::size() const { return slots_.size(); }
+
+    std::vector<sym> cse::subexpressions() const {
+        std::vector<sym> r;
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            if (i != root_ && is_decomposed(slots_[i].kind) &&
+                slots_[i].uses > 1) {
+                r.emplace_back(slots_[i].expression);
+            }
+        }
+        return r;
+    }
+
+    size_t cse::tree_ops() const { return slots_[root_].tree_ops; }
+
+    size_t cse::ops() const {
+        size_t n = 0;
+        for (const slot &s : slots_) {
+            n += is_decomposed(s.kind) ? 1 : 0;
+        }
+        return n;
+    }
+
+    size_t cse::eliminated_ops() const { return tree_ops() - ops(); }
+
+    double cse::evaluate(const std::vector<uint8_t> &bool_values,
+                         const std::vector<int> &int_values,
+                         const std::vector<double> &double_values) const {
+        std::vector<double> values(slots_.size());
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            values[i] = evaluate_slot(slots_[i], values, bool_values,
+                                      int_values, double_values);
+        }
+        return values[root_];
+    }
+
+    node_lambda cse::lambdify() const {
+        auto program = std::make_shared<const cse>(*this);
+        return [program](const std::vector<uint8_t> &bool_values,
+                         const std::vector<int> &int_values,
+                         const std::vector<double> &double_values) {
+            return program->evaluate(bool_values, int_values, double_values);
+        };
+    }
+
+    batch_lambda cse::lambdify_batch() const {
+        auto program = std::make_shared<const cse>(*this);
+        return [program](size_t n,
+                         const std::vector<const uint8_t *> &bool_columns,
+                         const std::vector<const int *> &int_columns,
+                         const std::vector<const double *> &double_columns,
+                         double *out) {
+            program->evaluate_batch(n, bool_columns, int_columns,
+                                    double_columns, out);
+        };
+    }
+
+    batch_lambda
+    cse::lambdify_batch(const execution::simd_policy &policy) const {
+        auto program = std::make_shared<const cse>(*this);
+        return [program, policy](
+                   size_t n, const std::vector<const uint8_t *> &bool_columns,
+                   const std::vector<const int *> &int_columns,
+                   const std::vector<const double *> &double_columns,
+                   double *out) {
+            program->evaluate_batch(policy, n, bool_columns, int_columns,
+                                    double_columns, out);
+        };
+    }
+
+    std::optional<std::string> cse::c_code() const {
+        std::string code =
+            c_header() +
+            "double evaluate(_Bool bool_values[], int int_values[], double "
+            "double_values[])\n"
+            "{\n";
+        if (!c_body(code, false)) {
+            return std::nullopt;
+        }
+        code += "}\n";
+        return code;
+    }
+
+    std::optional<std::string> cse::c_batch_code() const {
+        std::string code =
+            c_header() +
+            "void evaluate_batch(unsigned long n, _Bool *bool_columns[], "
+            "int *int_columns[], double *double_columns[], double out[])\n"
+            "{\n"
+            " for (unsigned long i = 0; i < n; ++i) {\n";
+        if (!c_body(code, true)) {
+            return std::nullopt;
+        }
+        code += " }\n";
+        code += "}\n";
+        return code;
+    }
+
+    void cse::evaluate_batch(size_t n,
+                             const std::vector<const uint8_t *> &bool_columns,
+                             const std::vector<const int *> &int_columns,
+                             const std::vector<const double *> &double_columns,
+                             double *out) const {
+        evaluate_columns(n, bool_columns, int_columns, double_columns, out,
+                         false);
+    }
+
+    void cse::evaluate_batch(const execution::simd_policy &, size_t n,
+                             const std::vector<const uint8_t *> &bool_columns,
+                             const std::vector<const int *> &int_columns,
+                             const std::vector<const double *> &double_columns,
+                             double *out) const {
+        evaluate_columns(n, bool_columns, int_columns, double_columns, out,
+                         true);
+    }
+
+    void
+    cse::evaluate_columns(size_t n,
+                          const std::vector<const uint8_t *> &bool_columns,
+                          const std::vector<const int *> &int_columns,
+                          const std::vector<const double *> &double_columns,
+                          double *out, bool simd) const {
+        // the rows of all slots in a block fit in the L2 cache
+        const size_t block =
+            std::clamp<size_t>((size_t(1) << 16U) / slots_.size(), 16, 256);
+        std::vector<double> rows(slots_.size() * block);
+        // second operand of the kernels that need one
+        std::vector<double> scratch(simd ? block : 0);
+        // values do not depend on the point
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            if (is_value(slots_[i].kind)) {
+                std::fill_n(rows.data() + i * block, block, slots_[i].value);
+            }
+        }
+        // points for the nodes we do not decompose
+        std::vector<uint8_t> bool_values(bool_columns.size());
+        std::vector<int> int_values(int_columns.size());
+        std::vector<double> double_values(double_columns.size());
+        for (size_t first = 0; first < n; first += block) {
+            const size_t m = std::min(block, n - first);
+            for (size_t i = 0; i < slots_.size(); ++i) {
+                const slot &s = slots_[i];
+                double *r = rows.data() + i * block;
+                auto arg = [&](size_t k) {
+                    return rows.data() + s.args[k] * block;
+                };
+                auto apply = [&](auto f, auto kernel) {
+                    const double *x = arg(0);
+                    if (simd) {
+                        kernel(x, r, m);
+                        return;
+                    }
+                    for (size_t j = 0; j < m; ++j) {
+                        r[j] = f(x[j]);
+                    }
+                };
+                switch (s.kind) {
+                case node_kind::variable: {
+                    const auto *v = s.expression.node_as<variable>();
+                    switch (v->num_type()) {
+                    case numeric_type::var_boolean:
+                        std::copy_n(bool_columns[v->index()] + first, m, r);
+                        break;
+                    case numeric_type::var_integer:
+                        std::copy_n(int_columns[v->index()] + first, m, r);
+                        break;
+                    default:
+                        std::copy_n(double_columns[v->index()] + first, m, r);
+                        break;
+                    }
+                    break;
+                }
+                case node_kind::summation:
+                case node_kind::product: {
+                    const bool is_sum = s.kind == node_kind::summation;
+                    std::copy_n(arg(0), m, r);
+                    for (size_t k = 1; k < s.args.size(); ++k) {
+                        const double *x = arg(k);
+                        if (simd) {
+                            is_sum ? simd::add(r, x, r, m)
+                                   : simd::multiply(r, x, r, m);
+                            continue;
+                        }
+                        for (size_t j = 0; j < m; ++j) {
+                            r[j] = is_sum ? r[j] + x[j] : r[j] * x[j];
+                        }
+                    }
+                    break;
+                }
+                case node_kind::pow: {
+                    const double *x = arg(0);
+                    const double *y = arg(1);
+                    if (simd) {
+                        simd_power(s.power, x, y, r, m);
+                        break;
+                    }
+                    for (size_t j = 0; j < m; ++j) {
+                        r[j] = pow::evaluate(s.power, x[j], y[j]);
+                    }
+                    break;
+                }
+                case node_kind::log: {
+                    const double *x = arg(0);
+                    const double *b = arg(1);
+                    if (simd) {
+                        simd::log(x, r, m);
+                        simd::log(b, scratch.data(), m);
+                        for (size_t j = 0; j < m; ++j) {
+                            r[j] /= scratch[j];
+                        }
+                        break;
+                    }
+                    for (size_t j = 0; j < m; ++j) {
+                        r[j] = std::log(x[j]) / std::log(b[j]);
+                    }
+                    break;
+                }
+                case node_kind::sin:
+                    apply([](double x) { return std::sin(x); }, simd::sin);
+                    break;
+                case node_kind::cos:
+                    apply([](double x) { return std::cos(x); }, simd::cos);
+                    break;
+                case node_kind::sinh:
+                    apply([](double x) { return std::sinh(x); }, simd::sinh);
+                    break;
+                case node_kind::cosh:
+                    apply([](double x) { return std::cosh(x); }, simd::cosh);
+                    break;
+                case node_kind::abs:
+                    apply([](double x) { return std::abs(x); }, simd::abs);
+                    break;
+                default:
+                    if (is_value(s.kind)) {
+                        break;
+                    }
+                    // opaque nodes are evaluated one point at a time
+                    for (size_t j = 0; j < m; ++j) {
+                        for (size_t k = 0; k < bool_columns.size(); ++k) {
+                            bool_values[k] = bool_columns[k][first + j];
+                        }
+                        for (size_t k = 0; k < int_columns.size(); ++k) {
+                            int_values[k] = int_columns[k][first + j];
+                        }
+                        for (size_t k = 0; k < double_columns.size(); ++k) {
+                            double_values[k] = double_columns[k][first + j];
+                        }
+                        r[j] = s.expression.evaluate(bool_values, int_values,
+                                                     double_values);
+                    }
+                    break;
+                }
+            }
+            std::copy_n(rows.data() + root_ * block, m, out + first);
+        }
+    }
+
+    std::string cse::c_header() {
+        return
+            // include the "Simple libc header for TCC"
+            "extern double sin(double a);\n"
+            "extern double cos(double a);\n"
+            "extern double sinh(double a);\n"
+            "extern double cosh(double a);\n"
+            "extern double log(double a);\n"
+            "extern double fabs(double a);\n"
+            "extern double sqrt(double a);\n"
+            "extern double exp(double a);\n"
+            "extern double pow(double a, double b);\n"
+            "#ifdef _WIN32\n" // dynamically linked data needs 'dllimport'
+            " __attribute__((dllimport))\n"
+            "#endif\n"
+            "\n";
+    }
+
+    bool cse::c_body(std::string &code, bool batch) const {
+        const std::string indent = batch ? "  " : " ";
+        // Slots used more than once go to temporaries and the others
+        // are inlined in the expression of their parent
+        // Bases of multiplication chains are used more than once too
+        std::vector<bool> repeated(slots_.size(), false);
+        for (const slot &s : slots_) {
+            if (s.kind == node_kind::pow &&
+                s.power.op == pow::lowering::integer &&
+                std::abs(s.power.exponent) > 1) {
+                repeated[s.args[0]] = true;
+            }
+        }
+        std::vector<std::string> names(slots_.size());
+        size_t temporaries = 0;
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            const slot &s = slots_[i];
+            if (!is_decomposed(s.kind) && !is_value(s.kind) &&
+                s.kind != node_kind::variable) {
+                return false;
+            }
+            names[i] = c_expression(i, names, code, temporaries, batch);
+            if (i != root_ && is_decomposed(s.kind) &&
+                (s.uses > 1 || repeated[i])) {
+                std::string t = "t" + std::to_string(temporaries++);
+                code += indent + "double " + t + " = " + names[i] + ";\n";
+                names[i] = std::move(t);
+            }
+        }
+        if (batch) {
+            code += indent + "out[i] = " + names[root_] + ";\n";
+        } else {
+            code += indent + "return " + names[root_] + ";\n";
+        }
+        return true;
+    }
+
+    size_t cse::add(const sym &s, visited_nodes &visited) {
+        const node_interface *n = s.node_as<node_interface>();
+        if (auto it = visited.find(n); it != visited.end()) {
+            return it->second;
+        }
+        slot c{s.kind(), {}, s};
+        if (is_decomposed(c.kind)) {
+            c.args.reserve(s.size());
+            for (const sym &child : s) {
+                c.args.emplace_back(add(child, visited));
+            }
+            if (c.kind == node_kind::pow) {
+                c.power = s.node_as<pow>()->lower();
+            }
+        } else if (is_value(c.kind)) {
+            c.value = s.evaluate({}, {}, {});
+        }
+        // the same subtree built twice is the same slot
+        const size_t h = hash_slot(c);
+        auto [first, last] = index_.equal_range(h);
+        for (auto it = first; it != last; ++it) {
+            if (same_slot(slots_[it->second], c)) {
+                visited.emplace(n, it->second);
+                return it->second;
+            }
+        }
+        if (is_decomposed(c.kind)) {
+            c.tree_ops = 1;
+            for (size_t a : c.args) {
+                ++slots_[a].uses;
+                c.tree_ops += slots_[a].tree_ops;
+            }
+        }
+        const size_t i = slots_.size();
+        slots_.emplace_back(std::move(c));
+        index_.emplace(h, i);
+        visited.emplace(n, i);
+        return i;
+    }
+
+    size_t cse::hash_slot(const slot &s) const {
+        if (!is_decomposed(s.kind)) {
+            return s.expression.hash();
+        }
+        size_t h = std::hash<int>()(static_cast<int>(s.kind));
+        for (size_t a : s.args) {
+            h = hash_combine(h, a);
+        }
+        return h;
+    }
+
+    bool cse::same_slot(const slot &a, const slot &b) const {
+        if (a.kind != b.kind) {
+            return false;
+        }
+        if (is_decomposed(a.kind)) {
+            return a.args == b.args;
+        }
+        if (a.kind == node_kind::variable) {
+            // variables with the same name might have other indexes
+            // if put_indexes was called on a part of the tree
+            const auto *x = a.expression.node_as<variable>();
+            const auto *y = b.expression.node_as<variable>();
+            return x->name_id() == y->name_id() &&
+                   x->num_type() == y->num_type() && x->index() == y->index();
+        }
+        return unique_table::identical(*a.expression.node_as<node_interface>(),
+                                       *b.expression.node_as<node_interface>());
+    }
+
+    bool cse::is_decomposed(node_kind k) {
+        switch (k) {
+        case node_kind::summation:
+        case node_kind::product:
+        case node_kind::pow:
+        case node_kind::log:
+        case node_kind::sin:
+        case node_kind::cos:
+        case node_kind::sinh:
+        case node_kind::cosh:
+        case node_kind::abs:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool cse::is_value(node_kind k) {
+        return is_number_kind(k) || k == node_kind::constant;
+    }
+
+    double
+    cse::evaluate_slot(const slot &s, const std::vector<double> &values,
+                       const std::vector<uint8_t> &bool_values,
+                       const std::vector<int> &int_values,
+                       const std::vector<double> &double_values) const {
+        switch (s.kind) {
+        case node_kind::variable: {
+            const auto *v = s.expression.node_as<variable>();
+            switch (v->num_type()) {
+            case numeric_type::var_boolean:
+                return static_cast<double>(bool_values[v->index()]);
+            case numeric_type::var_integer:
+                return static_cast<double>(int_values[v->index()]);
+            default:
+                return double_values[v->index()];
+            }
+        }
+        case node_kind::summation: {
+            double r = 0.;
+            for (size_t a : s.args) {
+                r += values[a];
+            }
+            return r;
+        }
+        case node_kind::product: {
+            double r = 1.;
+            for (size_t a : s.args) {
+                r *= values[a];
+            }
+            return r;
+        }
+        case node_kind::pow:
+            return pow::evaluate(s.power, values[s.args[0]],
+                                 values[s.args[1]]);
+        case node_kind::log:
+            return std::log(values[s.args[0]]) / std::log(values[s.args[1]]);
+        case node_kind::sin:
+            return std::sin(values[s.args[0]]);
+        case node_kind::cos:
+            return std::cos(values[s.args[0]]);
+        case node_kind::sinh:
+            return std::sinh(values[s.args[0]]);
+        case node_kind::cosh:
+            return std::cosh(values[s.args[0]]);
+        case node_kind::abs:
+            return std::abs(values[s.args[0]]);
+        default:
+            if (is_value(s.kind)) {
+                return s.value;
+            }
+            // nodes we do not decompose evaluate their whole subtree
+            return s.expression.evaluate(bool_values, int_values,
+                                         double_values);
+        }
+    }
+
+    std::string cse::c_expression(size_t i,
+                                  const std::vector<std::string> &names,
+                                  std::string &code, size_t &temporaries,
+                                  bool batch) const {
+        const slot &s = slots_[i];
+        auto join = [&](const char *separator) {
+            std::string r = "(";
+            for (size_t j = 0; j < s.args.size(); ++j) {
+                if (j != 0) {
+                    r += separator;
+                }
+                r += names[s.args[j]];
+            }
+            return r + ")";
+        };
+        auto call = [&](const char *f) {
+            return std::string(f) + "(" + names[s.args[0]] + ")";
+        };
+        switch (s.kind) {
+        case node_kind::variable: {
+            const auto *v = s.expression.node_as<variable>();
+            // batches read the point i of each column
+            const std::string index = "[" + std::to_string(v->index()) + "]" +
+                                      (batch ? "[i]" : "");
+            const std::string suffix = batch ? "_columns" : "_values";
+            switch (v->num_type()) {
+            case numeric_type::var_boolean:
+                return "bool" + suffix + index;
+            case numeric_type::var_integer:
+                return "int" + suffix + index;
+            default:
+                return "double" + suffix + index;
+            }
+        }
+        case node_kind::summation:
+            return join(" + ");
+        case node_kind::product:
+            return join(" * ");
+        case node_kind::pow:
+            switch (s.power.op) {
+            case pow::lowering::integer:
+                return c_power(names[s.args[0]], s.power.exponent,
+                               batch ? "  " : " ", code, temporaries);
+            case pow::lowering::square_root:
+                return s.power.exponent > 0 ? call("sqrt")
+                                            : "(1. / " + call("sqrt") + ")";
+            case pow::lowering::exp:
+                return "exp(" + names[s.args[1]] + ")";
+            default:
+                return "pow(" + names[s.args[0]] + ", " + names[s.args[1]] +
+                       ")";
+            }
+        case node_kind::log:
+            if (constant::is_e(slots_[s.args[1]].expression)) {
+                return call("log");
+            }
+            return "(log(" + names[s.args[0]] + ") / log(" +
+                   names[s.args[1]] + "))";
+        case node_kind::sin:
+            return call("sin");
+        case node_kind::cos:
+            return call("cos");
+        case node_kind::sinh:
+            return call("sinh");
+        case node_kind::cosh:
+            return call("cosh");
+        case node_kind::abs:
+            return call("fabs");
+        default: {
+            // C has no literals for the non-finite numbers
+            if (std::isnan(s.value)) {
+                return "(0./0.)";
+            }
+            if (std::isinf(s.value)) {
+                return s.value < 0 ? "(-1./0.)" : "(1./0.)";
+            }
+            // numbers with all their digits
+            std::ostringstream o;
+            o.precision(17);
+            o << s.value;
+            std::string r = o.str();
+            if (r.find_first_of(".e") == std::string::npos) {
+                r += ".";
+            }
+            return s.value < 0 ? "(" + r + ")" : r;
+        }
+        }
+    }
+
+} // namespace sympp
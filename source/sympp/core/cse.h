@@ -0,0 +1,197 @@
+// cse.h
+
+#ifndef SYMPP_CSE_H
+#define SYMPP_CSE_H
+
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Internal
+#include <sympp/core/node_kind.h>
+#include <sympp/core/simd_math.h>
+#include <sympp/core/sym.h>
+#include <sympp/node/function/pow.h>
+
+namespace sympp {
+    /// Form of the polynomial subtrees before the pass
+    enum class polynomial_form { expanded, horner, estrin };
+
+    /// \class Common subexpression elimination
+    /// The pass numbers the subtrees of an expression by their
+    /// structure, so every distinct subtree gets one slot no matter
+    /// how many times it appears. The slots are in evaluation order,
+    /// like the instructions of a straight-line program, and each
+    /// slot only uses the slots before it.
+    /// Code generation assigns the slots used more than once to
+    /// temporaries, and the interpreter evaluates each slot once, so
+    /// a model with cos(2*pi*x) in many terms only computes it once.
+    /// Constant subtrees are folded first. Polynomial subtrees are
+    /// then rewritten in Horner form by default, so sums of monomials
+    /// do not need a pow call per term, and powers are lowered to
+    /// multiplications, sqrt and exp when their exponents allow it.
+    /// Call put_indexes on the expression before the pass, as with
+    /// evaluate and lambdify.
+    class cse {
+      public:
+        /// Number the subtrees of an expression
+        explicit cse(const sym &,
+                     polynomial_form form = polynomial_form::horner);
+
+        /// Number of distinct subtrees
+        [[nodiscard]] size_t size() const;
+
+        /// Subexpressions that appear more than once, in evaluation
+        /// order. These are the temporaries of the generated code.
+        [[nodiscard]] std::vector<sym> subexpressions() const;
+
+        /// Number of operations in the expression tree
+        [[nodiscard]] size_t tree_ops() const;
+
+        /// Number of operations we evaluate after the pass
+        [[nodiscard]] size_t ops() const;
+
+        /// Number of operations the pass eliminated
+        [[nodiscard]] size_t eliminated_ops() const;
+
+        /// Evaluate the expression with each slot evaluated once
+        [[nodiscard]] double
+        evaluate(const std::vector<uint8_t> &bool_values,
+                 const std::vector<int> &int_values,
+                 const std::vector<double> &double_values) const;
+
+        /// Function that evaluates the expression like evaluate
+        [[nodiscard]] node_lambda lambdify() const;
+
+        /// Evaluate the expression at n points
+        /// Each column has the values of one variable at all points, so
+        /// the value of variable k at point j is columns[k][j]. The
+        /// slots are evaluated for a block of points at a time, and the
+        /// results go to out, which has room for n values.
+        void evaluate_batch(size_t n,
+                            const std::vector<const uint8_t *> &bool_columns,
+                            const std::vector<const int *> &int_columns,
+                            const std::vector<const double *> &double_columns,
+                            double *out) const;
+
+        /// Evaluate the expression at n points with the SIMD kernels
+        /// Each slot applies one kernel to the rows of its arguments,
+        /// so the whole block is evaluated in vector lanes.
+        void evaluate_batch(const execution::simd_policy &, size_t n,
+                            const std::vector<const uint8_t *> &bool_columns,
+                            const std::vector<const int *> &int_columns,
+                            const std::vector<const double *> &double_columns,
+                            double *out) const;
+
+        /// Function that evaluates the expression like evaluate_batch
+        [[nodiscard]] batch_lambda lambdify_batch() const;
+
+        /// Function that evaluates the expression with the SIMD kernels
+        [[nodiscard]] batch_lambda
+        lambdify_batch(const execution::simd_policy &) const;
+
+        /// C code with the repeated subexpressions in temporaries
+        /// \return The code, or nullopt if the expression has nodes
+        /// we cannot generate code for, such as user functions
+        [[nodiscard]] std::optional<std::string> c_code() const;
+
+        /// C code of a function evaluating the expression at n points
+        /// The function is evaluate_batch, with the arguments of
+        /// cse::evaluate_batch.
+        [[nodiscard]] std::optional<std::string> c_batch_code() const;
+
+      private:
+        /// Distinct subtree
+        struct slot {
+            /// Kind of the root of the subtree
+            node_kind kind;
+
+            /// Slots of the children
+            std::vector<size_t> args;
+
+            /// The subtree itself
+            sym expression;
+
+            /// Value of numbers and constants
+            double value{0.};
+
+            /// Operation that evaluates a power
+            pow::lowering power{};
+
+            /// Number of parents using this slot
+            size_t uses{0};
+
+            /// Number of operations in the subtree
+            size_t tree_ops{0};
+        };
+
+        /// Slots of the nodes we have already added
+        /// Nodes shared by many parents are only walked once.
+        using visited_nodes =
+            std::unordered_map<const node_interface *, size_t>;
+
+        /// Add a subtree and return its slot
+        size_t add(const sym &, visited_nodes &);
+
+        /// Hash of a slot from its kind and arguments
+        [[nodiscard]] size_t hash_slot(const slot &) const;
+
+        /// True if two slots are the same subtree
+        [[nodiscard]] bool same_slot(const slot &, const slot &) const;
+
+        /// True if we evaluate the children of this kind of node
+        /// Other nodes are opaque and evaluated as a whole.
+        static bool is_decomposed(node_kind);
+
+        /// True if the node of a slot is a value known in advance
+        static bool is_value(node_kind);
+
+        /// Evaluate a slot from the values of its arguments
+        [[nodiscard]] double
+        evaluate_slot(const slot &, const std::vector<double> &values,
+                      const std::vector<uint8_t> &bool_values,
+                      const std::vector<int> &int_values,
+                      const std::vector<double> &double_values) const;
+
+        /// Evaluate the expression at n points
+        /// The slots use the SIMD kernels if simd is true.
+        void
+        evaluate_columns(size_t n,
+                         const std::vector<const uint8_t *> &bool_columns,
+                         const std::vector<const int *> &int_columns,
+                         const std::vector<const double *> &double_columns,
+                         double *out, bool simd) const;
+
+        /// Declarations of the functions the C code calls
+        static std::string c_header();
+
+        /// Append the statements evaluating the expression to C code
+        /// \return False if there are nodes we cannot generate code for
+        bool c_body(std::string &code, bool batch) const;
+
+        /// C expression of a slot
+        /// Integer powers above 3 append the squares of their base to
+        /// the code as temporaries. Batches read the variables from
+        /// columns.
+        [[nodiscard]] std::string
+        c_expression(size_t, const std::vector<std::string> &names,
+                     std::string &code, size_t &temporaries,
+                     bool batch) const;
+
+      private:
+        /// Slots in evaluation order
+        std::vector<slot> slots_;
+
+        /// Slots indexed by their hash
+        std::unordered_multimap<size_t, size_t> index_;
+
+        /// Slot of the whole expression
+        size_t root_{0};
+    };
+} // namespace sympp
+
+#endif // SYMPP_CSE_H
@@ -0,0 +1,748 @@
+// e_graph.cpp
+
+// C++
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+
+// Internal
+#include <sympp/core/e_graph.h>
+#include <sympp/core/node_interface.h>
+#include <sympp/core/sparse_polynomial.h>
+#include <sympp/core/sym_builder.h>
+#include <sympp/core/unique_table.h>
+#include <sympp/node/function/abs.h>
+#include <sympp/node/function/cos.h>
+#include <sympp/node/function/cosh.h>
+#include <sympp/node/function/log.h>
+#include <sympp/node/function/pow.h>
+#include <sympp/node/function/sin.h>
+#include <sympp/node/function/sinh.h>
+#include <sympp/node/terminal/integer.h>
+
+namespace sympp {
+
+    e_graph::e_graph(unsigned rules) : rules_(rules) {}
+
+    e_graph::class_id e_graph::add(const sym &s) {
+        e_node n{s.kind(), s, {}};
+        if (is_decomposed(n.kind)) {
+            n.children.reserve(s.size());
+            for (const sym &child : s) {
+                n.children.emplace_back(add(child));
+            }
+        }
+        return add(std::move(n));
+    }
+
+    void e_graph::merge(class_id a, class_id b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) {
+            return;
+        }
+        // keep the e-class with more e-nodes as the root
+        if (class_nodes_[a].size() < class_nodes_[b].size()) {
+            std::swap(a, b);
+        }
+        parent_[b] = a;
+        class_nodes_[a].insert(class_nodes_[a].end(),
+                               class_nodes_[b].begin(),
+                               class_nodes_[b].end());
+        class_nodes_[b].clear();
+        class_nodes_[b].shrink_to_fit();
+        ++merges_;
+    }
+
+    void e_graph::rebuild() {
+        // Merging e-classes might make two e-nodes identical, which
+        // means their e-classes are equivalent too (congruence)
+        bool merged = true;
+        while (merged) {
+            merged = false;
+            memo_.clear();
+            for (size_t i = 0; i < nodes_.size(); ++i) {
+                canonicalize(nodes_[i]);
+                const size_t h = hash_node(nodes_[i]);
+                bool found = false;
+                auto [first, last] = memo_.equal_range(h);
+                for (auto it = first; it != last; ++it) {
+                    if (same_node(nodes_[it->second], nodes_[i])) {
+                        if (!equivalent(node_class_[it->second],
+                                        node_class_[i])) {
+                            merge(node_class_[it->second], node_class_[i]);
+                            merged = true;
+                        }
+                        found = true;
+                        break;
+                    }
+                }
+                if (!found) {
+                    memo_.emplace(h, i);
+                }
+            }
+        }
+    }
+
+    e_graph::class_id e_graph::find(class_id c) const {
+        class_id root = c;
+        while (parent_[root] != root) {
+            root = parent_[root];
+        }
+        while (parent_[c] != root) {
+            class_id next = parent_[c];
+            parent_[c] = root;
+            c = next;
+        }
+        return root;
+    }
+
+    bool e_graph::equivalent(class_id a, class_id b) const {
+        return find(a) == find(b);
+    }
+
+    size_t e_graph::node_count() const { return nodes_.size(); }
+
+    size_t e_graph::class_count() const {
+        size_t n = 0;
+        for (class_id c = 0; c < parent_.size(); ++c) {
+            n += parent_[c] == c;
+        }
+        return n;
+    }
+
+    bool e_graph::saturate(const limits &l) {
+        limits_ = l;
+        start_ = clock::now();
+        iterations_ = 0;
+        rebuild();
+        while (iterations_ < l.max_iterations) {
+            ++iterations_;
+            const size_t nodes_before = nodes_.size();
+            const size_t merges_before = merges_;
+            for (size_t i = 0; i < nodes_before; ++i) {
+                if (exceeded()) {
+                    rebuild();
+                    return false;
+                }
+                apply_rules(i);
+            }
+            rebuild();
+            if (nodes_.size() == nodes_before && merges_ == merges_before) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool e_graph::exceeded() const {
+        return nodes_.size() >= limits_.max_nodes ||
+               (limits_.max_time != clock::duration::max() &&
+                clock::now() - start_ >= limits_.max_time);
+    }
+
+    size_t e_graph::iterations() const { return iterations_; }
+
+    sym e_graph::extract(class_id c) const {
+        // count_ops is the number of terminals in the tree, so the cost
+        // of an e-node is the sum of the costs of its children and we
+        // do not need to build the candidates to compare them
+        const size_t n_classes = parent_.size();
+        std::vector<double> best_cost(n_classes,
+                                      std::numeric_limits<double>::max());
+        std::vector<size_t> best_node(n_classes, nodes_.size());
+        bool any_changed = true;
+        while (any_changed) {
+            any_changed = false;
+            for (size_t i = 0; i < nodes_.size(); ++i) {
+                const e_node &n = nodes_[i];
+                double node_cost = n.children.empty() ? 1. : 0.;
+                for (class_id child : n.children) {
+                    node_cost += best_cost[find(child)];
+                }
+                const class_id k = find(node_class_[i]);
+                if (node_cost < best_cost[k]) {
+                    best_cost[k] = node_cost;
+                    best_node[k] = i;
+                    any_changed = true;
+                }
+            }
+        }
+        // build the best expression of each e-class once
+        std::vector<std::optional<sym>> best(n_classes);
+        std::function<const sym &(class_id)> build_class =
+            [&](class_id k) -> const sym & {
+            k = find(k);
+            if (!best[k]) {
+                const e_node &n = nodes_[best_node[k]];
+                std::vector<sym> children;
+                children.reserve(n.children.size());
+                for (class_id child : n.children) {
+                    children.emplace_back(build_class(child));
+                }
+                best[k] = build(n, children);
+            }
+            return *best[k];
+        };
+        return build_class(c);
+    }
+
+    sym e_graph::extract(class_id c, const complexity_lambda &cost) const {
+        // Bottom-up fixed point: the best expression of an e-class is
+        // the cheapest expression we can build from any of its
+        // e-nodes and the best expressions of their children. An
+        // e-node is only rebuilt when the best expression of one of
+        // its children changed after we last built it.
+        const size_t n_classes = parent_.size();
+        std::vector<std::optional<sym>> best(n_classes);
+        std::vector<double> best_cost(n_classes,
+                                      std::numeric_limits<double>::max());
+        // time of the last change of each e-class and of the last
+        // time we built each e-node
+        size_t now = 1;
+        std::vector<size_t> changed_at(n_classes, 0);
+        std::vector<size_t> built_at(nodes_.size(), 0);
+        std::vector<sym> children;
+        bool any_changed = true;
+        while (any_changed) {
+            any_changed = false;
+            for (size_t i = 0; i < nodes_.size(); ++i) {
+                const e_node &n = nodes_[i];
+                bool ready = true;
+                bool dirty = built_at[i] == 0;
+                for (class_id child : n.children) {
+                    const class_id k = find(child);
+                    ready = ready && best[k];
+                    dirty = dirty || changed_at[k] > built_at[i];
+                }
+                if (!ready || !dirty) {
+                    continue;
+                }
+                built_at[i] = now++;
+                children.clear();
+                for (class_id child : n.children) {
+                    children.emplace_back(*best[find(child)]);
+                }
+                sym candidate = build(n, children);
+                const double candidate_cost =
+                    cost(*std::as_const(candidate).root_node());
+                const class_id k = find(node_class_[i]);
+                if (candidate_cost < best_cost[k]) {
+                    best[k] = std::move(candidate);
+                    best_cost[k] = candidate_cost;
+                    changed_at[k] = now++;
+                    any_changed = true;
+                }
+            }
+        }
+        return *best[find(c)];
+    }
+
+    sym e_graph::simplify(const sym &s, const complexity_lambda &cost,
+                          const limits &l, unsigned rules) {
+        e_graph g(rules);
+        const class_id c = g.add(s);
+        g.saturate(l);
+        return g.extract(c, cost);
+    }
+
+    sym e_graph::simplify(const sym &s, const limits &l, unsigned rules) {
+        e_graph g(rules);
+        const class_id c = g.add(s);
+        g.saturate(l);
+        return g.extract(c);
+    }
+
+    sym e_graph::simplify(const sym &s) { return simplify(s, limits()); }
+
+    e_graph::class_id e_graph::add(e_node n) {
+        canonicalize(n);
+        const size_t h = hash_node(n);
+        auto [first, last] = memo_.equal_range(h);
+        for (auto it = first; it != last; ++it) {
+            if (same_node(nodes_[it->second], n)) {
+                return find(node_class_[it->second]);
+            }
+        }
+        const size_t i = nodes_.size();
+        const auto c = static_cast<class_id>(parent_.size());
+        nodes_.emplace_back(std::move(n));
+        node_class_.emplace_back(c);
+        parent_.emplace_back(c);
+        class_nodes_.emplace_back(std::vector<size_t>{i});
+        memo_.emplace(h, i);
+        return c;
+    }
+
+    e_graph::class_id e_graph::add(node_kind k,
+                                   std::vector<class_id> children) {
+        using coefficient = sparse_polynomial::coefficient;
+        if (k == node_kind::summation || k == node_kind::product) {
+            // flatten nested sums and products, and fold the numbers,
+            // so rules never create terms like x*(y*x^(-1)) or x^(1+1)
+            const bool sum = k == node_kind::summation;
+            std::optional<coefficient> folded;
+            std::vector<class_id> others;
+            auto push = [&](class_id child) {
+                if (std::optional<sym> v = number_of(child); v) {
+                    coefficient x = coefficient::from_number(*v);
+                    if (!folded) {
+                        folded = x;
+                    } else if (sum) {
+                        *folded += x;
+                    } else {
+                        folded = *folded * x;
+                    }
+                } else {
+                    others.emplace_back(find(child));
+                }
+            };
+            for (class_id child : children) {
+                if (const e_node *inner = nested_node(child, k); inner) {
+                    std::for_each(inner->children.begin(),
+                                  inner->children.end(), push);
+                } else {
+                    push(child);
+                }
+            }
+            if (sum) {
+                others = collect_terms(others);
+            }
+            if (folded) {
+                if (!sum && folded->is_zero()) {
+                    return add_number(0);
+                }
+                const bool identity =
+                    sum ? folded->is_zero() : folded->is_one();
+                if (!identity || others.empty()) {
+                    others.insert(others.begin(), add(folded->to_sym()));
+                }
+            }
+            if (others.empty()) {
+                return add_number(sum ? 0 : 1);
+            }
+            if (others.size() == 1) {
+                return find(others.front());
+            }
+            children = std::move(others);
+        } else if (k == node_kind::pow) {
+            // x^0 -> 1, x^1 -> x and c^n -> number
+            if (std::optional<int> e = integer_of(children[1]); e) {
+                if (*e == 0) {
+                    return add_number(1);
+                }
+                if (*e == 1) {
+                    return find(children[0]);
+                }
+                std::optional<sym> b = number_of(children[0]);
+                if (b && std::abs(*e) <= 64) {
+                    coefficient c = coefficient::from_number(*b);
+                    if (!c.is_zero() || *e > 0) {
+                        return add(c.power(*e).to_sym());
+                    }
+                }
+            }
+        }
+        return add(e_node{k, std::nullopt, std::move(children)});
+    }
+
+    std::vector<e_graph::class_id>
+    e_graph::collect_terms(const std::vector<class_id> &terms) {
+        using coefficient = sparse_polynomial::coefficient;
+        // c*t is (c, t) and t is (1, t)
+        std::vector<std::pair<class_id, coefficient>> groups;
+        for (class_id t : terms) {
+            coefficient c = coefficient::one();
+            if (const e_node *p = node_of(t, node_kind::product); p) {
+                if (std::optional<sym> v = number_of(p->children[0]); v) {
+                    c = coefficient::from_number(*v);
+                    std::vector<class_id> rest(p->children.begin() + 1,
+                                               p->children.end());
+                    t = add(node_kind::product, std::move(rest));
+                }
+            }
+            auto it = std::find_if(groups.begin(), groups.end(),
+                                   [&](const auto &g) { return g.first == t; });
+            if (it == groups.end()) {
+                groups.emplace_back(t, c);
+            } else {
+                it->second += c;
+            }
+        }
+        if (groups.size() == terms.size()) {
+            return terms;
+        }
+        std::vector<class_id> r;
+        for (const auto &[t, c] : groups) {
+            if (c.is_zero()) {
+                continue;
+            }
+            r.emplace_back(c.is_one() ? t
+                                      : add(node_kind::product,
+                                            {add(c.to_sym()), t}));
+        }
+        return r;
+    }
+
+    e_graph::class_id e_graph::add_number(int v) { return add(sym(v)); }
+
+    size_t e_graph::hash_node(const e_node &n) const {
+        size_t h = static_cast<size_t>(n.kind);
+        if (n.children.empty() && n.value) {
+            return h ^ n.value->root_node()->hash();
+        }
+        for (class_id child : n.children) {
+            h ^= child + 0x9e3779b9 + (h << 6U) + (h >> 2U);
+        }
+        return h;
+    }
+
+    bool e_graph::same_node(const e_node &a, const e_node &b) const {
+        if (a.kind != b.kind || a.children != b.children) {
+            return false;
+        }
+        if (a.children.empty() && a.value && b.value) {
+            return unique_table::identical(*a.value->root_node(),
+                                           *b.value->root_node());
+        }
+        return true;
+    }
+
+    void e_graph::canonicalize(e_node &n) {
+        for (class_id &child : n.children) {
+            child = find(child);
+        }
+    }
+
+    sym e_graph::build(const e_node &n, const std::vector<sym> &children) {
+        if (n.children.empty() && n.value) {
+            return *n.value;
+        }
+        switch (n.kind) {
+        case node_kind::summation:
+        case node_kind::product: {
+            sym_builder b(n.kind);
+            b.reserve(children.size());
+            for (const sym &child : children) {
+                b.push_back(child);
+            }
+            return b.build();
+        }
+        default:
+            break;
+        }
+        if (n.value) {
+            // copy the node, so functions keep their flags
+            sym s = *n.value;
+            for (size_t i = 0; i < children.size(); ++i) {
+                s[i] = children[i];
+            }
+            return s;
+        }
+        switch (n.kind) {
+        case node_kind::pow:
+            return sym(pow(children[0], children[1]));
+        case node_kind::log:
+            return sym(log(children[0], children[1]));
+        case node_kind::sin:
+            return sym(sin(children[0]));
+        case node_kind::cos:
+            return sym(cos(children[0]));
+        case node_kind::sinh:
+            return sym(sinh(children[0]));
+        case node_kind::cosh:
+            return sym(cosh(children[0]));
+        default:
+            return sym(abs(children[0]));
+        }
+    }
+
+    const e_graph::e_node *e_graph::node_of(class_id c, node_kind k) const {
+        for (size_t i : class_nodes_[find(c)]) {
+            if (nodes_[i].kind == k) {
+                return &nodes_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    const e_graph::e_node *e_graph::nested_node(class_id c,
+                                                node_kind k) const {
+        c = find(c);
+        for (size_t i : class_nodes_[c]) {
+            const e_node &n = nodes_[i];
+            auto is_self = [&](class_id child) { return find(child) == c; };
+            if (n.kind == k &&
+                std::none_of(n.children.begin(), n.children.end(), is_self)) {
+                return &n;
+            }
+        }
+        return nullptr;
+    }
+
+    std::optional<sym> e_graph::number_of(class_id c) const {
+        for (size_t i : class_nodes_[find(c)]) {
+            if (is_number_kind(nodes_[i].kind) && nodes_[i].value) {
+                return nodes_[i].value;
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::optional<int> e_graph::integer_of(class_id c) const {
+        if (const e_node *n = node_of(c, node_kind::integer); n) {
+            return static_cast<int>(*n->value->node_as<number_interface>());
+        }
+        return std::nullopt;
+    }
+
+    bool e_graph::is_decomposed(node_kind k) {
+        switch (k) {
+        case node_kind::summation:
+        case node_kind::product:
+        case node_kind::pow:
+        case node_kind::log:
+        case node_kind::sin:
+        case node_kind::cos:
+        case node_kind::sinh:
+        case node_kind::cosh:
+        case node_kind::abs:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    void e_graph::apply_rules(size_t i) {
+        // copy the e-node: the rules add e-nodes to the graph
+        const e_node n = nodes_[i];
+        const class_id c = find(node_class_[i]);
+        switch (n.kind) {
+        case node_kind::product:
+            apply_flatten(c, n);
+            if (rules_ & powsimp) {
+                apply_powsimp(c, n);
+            }
+            if (rules_ & logcombine) {
+                apply_logcombine(c, n);
+            }
+            break;
+        case node_kind::summation:
+            apply_flatten(c, n);
+            if (rules_ & logcombine) {
+                apply_logcombine(c, n);
+            }
+            break;
+        case node_kind::pow:
+            if (rules_ & powdenest) {
+                apply_powdenest(c, n);
+            }
+            break;
+        case node_kind::log:
+            if (rules_ & expand_log) {
+                apply_expand_log(c, n);
+            }
+            break;
+        case node_kind::sin:
+        case node_kind::cos:
+        case node_kind::sinh:
+        case node_kind::cosh:
+            if (rules_ & expand_trig) {
+                apply_expand_trig(c, n);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    void e_graph::apply_flatten(class_id c, const e_node &n) {
+        // a rule might have added a sum (or a product) to the e-class
+        // of a term, so we add the node again to flatten and collect it
+        const bool nested = std::any_of(
+            n.children.begin(), n.children.end(),
+            [&](class_id child) { return nested_node(child, n.kind); });
+        if (nested) {
+            merge(c, add(n.kind, n.children));
+        }
+    }
+
+    void e_graph::apply_powsimp(class_id c, const e_node &n) {
+        // Each factor is only paired with the first factor it matches.
+        // The next iterations pair the results, so we do not need to
+        // try every pair of a long product.
+        const size_t m = n.children.size();
+        for (size_t i = 0; i < m && !exceeded(); ++i) {
+            const auto [bi, ei] = power_of(n.children[i]);
+            for (size_t j = i + 1; j < m; ++j) {
+                const auto [bj, ej] = power_of(n.children[j]);
+                class_id p;
+                if (equivalent(bi, bj)) {
+                    // x^a*x^b -> x^{a+b}
+                    p = add(node_kind::pow,
+                            {bi, add(node_kind::summation, {ei, ej})});
+                } else if (equivalent(ei, ej) &&
+                           node_of(n.children[i], node_kind::pow) &&
+                           node_of(n.children[j], node_kind::pow)) {
+                    // x^a*y^a -> (x*y)^a
+                    p = add(node_kind::pow,
+                            {add(node_kind::product, {bi, bj}), ei});
+                } else {
+                    continue;
+                }
+                std::vector<class_id> factors{p};
+                for (size_t k = 0; k < m; ++k) {
+                    if (k != i && k != j) {
+                        factors.emplace_back(n.children[k]);
+                    }
+                }
+                merge(c, add(node_kind::product, std::move(factors)));
+                break;
+            }
+        }
+    }
+
+    void e_graph::apply_powdenest(class_id c, const e_node &n) {
+        // (x^a)^b -> x^{a*b} if b is an integer
+        if (!integer_of(n.children[1])) {
+            return;
+        }
+        if (const e_node *inner = node_of(n.children[0], node_kind::pow);
+            inner) {
+            const class_id x = inner->children[0];
+            const class_id a = inner->children[1];
+            const class_id b = n.children[1];
+            merge(c, add(node_kind::pow,
+                         {x, add(node_kind::product, {a, b})}));
+        }
+    }
+
+    void e_graph::apply_expand_log(class_id c, const e_node &n) {
+        const class_id x = n.children[0];
+        const class_id base = n.children[1];
+        // log(x*y) -> log(x)+log(y)
+        if (const e_node *p = node_of(x, node_kind::product); p) {
+            // copy the factors: adding e-nodes invalidates p
+            const std::vector<class_id> factors = p->children;
+            std::vector<class_id> terms;
+            terms.reserve(factors.size());
+            for (class_id factor : factors) {
+                terms.emplace_back(add(node_kind::log, {factor, base}));
+            }
+            merge(c, add(node_kind::summation, std::move(terms)));
+        }
+        // log(x^n) -> n*log(x)
+        if (const e_node *p = node_of(x, node_kind::pow); p) {
+            const class_id y = p->children[0];
+            const class_id e = p->children[1];
+            if (number_of(e)) {
+                merge(c, add(node_kind::product,
+                             {e, add(node_kind::log, {y, base})}));
+            }
+        }
+    }
+
+    void e_graph::apply_logcombine(class_id c, const e_node &n) {
+        const size_t m = n.children.size();
+        if (n.kind == node_kind::summation) {
+            // log(x)+log(y) -> log(x*y)
+            // Like in powsimp, each log is only paired with the next one
+            for (size_t i = 0; i < m && !exceeded(); ++i) {
+                const e_node *li = node_of(n.children[i], node_kind::log);
+                if (!li) {
+                    continue;
+                }
+                for (size_t j = i + 1; j < m; ++j) {
+                    const e_node *lj = node_of(n.children[j], node_kind::log);
+                    if (!lj || !equivalent(li->children[1], lj->children[1])) {
+                        continue;
+                    }
+                    const class_id base = li->children[1];
+                    const class_id x = add(
+                        node_kind::product, {li->children[0], lj->children[0]});
+                    std::vector<class_id> terms{
+                        add(node_kind::log, {x, base})};
+                    for (size_t k = 0; k < m; ++k) {
+                        if (k != i && k != j) {
+                            terms.emplace_back(n.children[k]);
+                        }
+                    }
+                    merge(c, add(node_kind::summation, std::move(terms)));
+                    break;
+                }
+            }
+            return;
+        }
+        // n*log(x) -> log(x^n)
+        for (size_t i = 0; i < m && !exceeded(); ++i) {
+            if (!number_of(n.children[i])) {
+                continue;
+            }
+            for (size_t j = 0; j < m; ++j) {
+                const e_node *l = node_of(n.children[j], node_kind::log);
+                if (!l) {
+                    continue;
+                }
+                const class_id x = l->children[0];
+                const class_id base = l->children[1];
+                const class_id e = n.children[i];
+                std::vector<class_id> factors{add(
+                    node_kind::log, {add(node_kind::pow, {x, e}), base})};
+                for (size_t k = 0; k < m; ++k) {
+                    if (k != i && k != j) {
+                        factors.emplace_back(n.children[k]);
+                    }
+                }
+                merge(c, add(node_kind::product, std::move(factors)));
+                break;
+            }
+        }
+    }
+
+    void e_graph::apply_expand_trig(class_id c, const e_node &n) {
+        const e_node *s = node_of(n.children[0], node_kind::summation);
+        if (!s || s->children.size() < 2) {
+            return;
+        }
+        // f(a+r) where r is the rest of the sum
+        const class_id a = s->children[0];
+        std::vector<class_id> rest(s->children.begin() + 1,
+                                   s->children.end());
+        const class_id r = add(node_kind::summation, std::move(rest));
+        const bool hyperbolic =
+            n.kind == node_kind::sinh || n.kind == node_kind::cosh;
+        const node_kind sk = hyperbolic ? node_kind::sinh : node_kind::sin;
+        const node_kind ck = hyperbolic ? node_kind::cosh : node_kind::cos;
+        const class_id sa = add(sk, {a});
+        const class_id ca = add(ck, {a});
+        const class_id sr = add(sk, {r});
+        const class_id cr = add(ck, {r});
+        class_id e;
+        if (n.kind == sk) {
+            // sin(a+r) -> sin(a)*cos(r)+cos(a)*sin(r)
+            e = add(node_kind::summation, {add(node_kind::product, {sa, cr}),
+                                           add(node_kind::product, {ca, sr})});
+        } else {
+            // cos(a+r) -> cos(a)*cos(r)-sin(a)*sin(r)
+            // cosh(a+r) -> cosh(a)*cosh(r)+sinh(a)*sinh(r)
+            std::vector<class_id> second{sa, sr};
+            if (!hyperbolic) {
+                second.emplace_back(add_number(-1));
+            }
+            e = add(node_kind::summation,
+                    {add(node_kind::product, {ca, cr}),
+                     add(node_kind::product, std::move(second))});
+        }
+        merge(c, e);
+    }
+
+    std::pair<e_graph::class_id, e_graph::class_id>
+    e_graph::power_of(class_id c) {
+        if (const e_node *p = node_of(c, node_kind::pow); p) {
+            return {p->children[0], p->children[1]};
+        }
+        return {c, add_number(1)};
+    }
+
+} // namespace sympp
@@ -0,0 +1,237 @@
+// e_graph.h
+
+#ifndef SYMPP_E_GRAPH_H
+#define SYMPP_E_GRAPH_H
+
+// C++
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Internal
+#include <sympp/core/node_kind.h>
+#include <sympp/core/sym.h>
+
+namespace sympp {
+    /// \class E-graph for equality saturation
+    /// An e-graph stores many equivalent expressions at once. Each
+    /// e-class is a set of equivalent e-nodes, and the children of
+    /// an e-node are e-classes rather than expressions, so a rewrite
+    /// never discards the expression it rewrites.
+    /// The engine loads an expression, applies the rewrite rules to
+    /// every e-node until no rule adds anything new (saturation) or a
+    /// limit is reached, and then extracts the equivalent expression
+    /// with the lowest cost.
+    /// The rules are the identities of powsimp, powdenest, expand_log,
+    /// logcombine and expand_trig. Like these transforms, the rules
+    /// assume the bases and arguments satisfy the conditions in their
+    /// documentation, such as being positive, so callers should only
+    /// enable the rules that are valid for their models.
+    class e_graph {
+      public:
+        /// Index of an e-class
+        using class_id = uint32_t;
+
+        /// Clock for the time limit
+        using clock = std::chrono::steady_clock;
+
+        /// Rewrite rules the engine can apply
+        enum rule : unsigned {
+            /// x^a*x^b -> x^{a+b} and x^a*y^a -> (x*y)^a
+            powsimp = 1U << 0U,
+            /// (x^a)^b -> x^{a*b} if b is an integer
+            powdenest = 1U << 1U,
+            /// log(x*y) -> log(x)+log(y) and log(x^n) -> n*log(x)
+            expand_log = 1U << 2U,
+            /// log(x)+log(y) -> log(x*y) and n*log(x) -> log(x^n)
+            logcombine = 1U << 3U,
+            /// Sum identities of sin, cos, sinh and cosh
+            expand_trig = 1U << 4U,
+            /// All rules
+            all_rules = (1U << 5U) - 1U
+        };
+
+        /// Limits that keep the saturation bounded
+        struct limits {
+            /// Stop when the graph has this many e-nodes
+            size_t max_nodes{10000};
+
+            /// Stop after applying the rules this many times
+            size_t max_iterations{30};
+
+            /// Stop after this much time has passed
+            clock::duration max_time{clock::duration::max()};
+        };
+
+      public /* constructors */:
+        /// Empty e-graph with a set of rules
+        explicit e_graph(unsigned rules = all_rules);
+
+      public /* graph */:
+        /// Add an expression and return its e-class
+        class_id add(const sym &);
+
+        /// Merge two e-classes that are equivalent
+        /// Call rebuild to restore the invariants after merging.
+        void merge(class_id, class_id);
+
+        /// Restore the congruence invariant after merges
+        /// E-nodes whose children became equivalent are merged too.
+        void rebuild();
+
+        /// Canonical e-class of an e-class
+        [[nodiscard]] class_id find(class_id) const;
+
+        /// True if two e-classes are equivalent
+        [[nodiscard]] bool equivalent(class_id, class_id) const;
+
+        /// Number of e-nodes
+        [[nodiscard]] size_t node_count() const;
+
+        /// Number of canonical e-classes
+        [[nodiscard]] size_t class_count() const;
+
+      public /* equality saturation */:
+        /// Apply the rules until saturation or until a limit is reached
+        /// \return True if the graph is saturated
+        bool saturate(const limits &);
+
+        /// Number of iterations in the last saturation
+        [[nodiscard]] size_t iterations() const;
+
+        /// Equivalent expression with the number of operations
+        /// Unlike other costs, this cost is additive, so we do not need
+        /// to build every candidate to compare them.
+        [[nodiscard]] sym extract(class_id) const;
+
+        /// Equivalent expression with the lowest cost in an e-class
+        [[nodiscard]] sym extract(class_id, const complexity_lambda &) const;
+
+        /// Load an expression, saturate the graph and extract the
+        /// equivalent expression with the lowest cost
+        static sym simplify(const sym &, const complexity_lambda &,
+                            const limits &, unsigned rules = all_rules);
+
+        /// Simplify with the number of operations as cost
+        static sym simplify(const sym &, const limits &,
+                            unsigned rules = all_rules);
+
+        /// Simplify with the number of operations as cost and the
+        /// default limits
+        static sym simplify(const sym &);
+
+      private:
+        /// Expression with e-classes as children
+        struct e_node {
+            /// Kind of the node
+            node_kind kind;
+
+            /// The terminal node itself, or a node of the same type
+            /// we can copy to rebuild the expression
+            /// Nodes created by the rules only need their kind.
+            std::optional<sym> value;
+
+            /// Children e-classes
+            std::vector<class_id> children;
+        };
+
+        /// Add an e-node and return its e-class
+        class_id add(e_node);
+
+        /// Add an e-node created by a rule and return its e-class
+        class_id add(node_kind, std::vector<class_id>);
+
+        /// Group the terms of a sum that only differ by a number
+        /// This is how the rules cancel terms like x-x.
+        std::vector<class_id> collect_terms(const std::vector<class_id> &);
+
+        /// Add a number and return its e-class
+        class_id add_number(int);
+
+        /// Hash of an e-node with canonical children
+        [[nodiscard]] size_t hash_node(const e_node &) const;
+
+        /// True if two e-nodes with canonical children are the same
+        [[nodiscard]] bool same_node(const e_node &, const e_node &) const;
+
+        /// Replace the children of an e-node with canonical e-classes
+        void canonicalize(e_node &);
+
+        /// Create the expression of an e-node from its children
+        [[nodiscard]] static sym build(const e_node &,
+                                       const std::vector<sym> &);
+
+        /// First e-node of a kind in an e-class
+        [[nodiscard]] const e_node *node_of(class_id, node_kind) const;
+
+        /// E-node of a kind in an e-class we can splice into its parent
+        /// E-nodes that contain their own e-class, as in y = y*x*x^(-1),
+        /// would make the sums and products grow forever.
+        [[nodiscard]] const e_node *nested_node(class_id, node_kind) const;
+
+        /// Number in an e-class, if any
+        [[nodiscard]] std::optional<sym> number_of(class_id) const;
+
+        /// Integer in an e-class, if any
+        [[nodiscard]] std::optional<int> integer_of(class_id) const;
+
+        /// True if we decompose nodes of this kind into e-nodes
+        /// Other nodes are stored as opaque terminals.
+        static bool is_decomposed(node_kind);
+
+        /// True if the saturation exceeded its limits
+        [[nodiscard]] bool exceeded() const;
+
+        /// Apply the rules to an e-node
+        void apply_rules(size_t node);
+
+        /// Flatten sums and products with nested sums and products
+        void apply_flatten(class_id, const e_node &);
+
+        /// The rules
+        void apply_powsimp(class_id, const e_node &);
+        void apply_powdenest(class_id, const e_node &);
+        void apply_expand_log(class_id, const e_node &);
+        void apply_logcombine(class_id, const e_node &);
+        void apply_expand_trig(class_id, const e_node &);
+
+        /// Base and exponent of a factor: x^a is (x, a) and x is (x, 1)
+        [[nodiscard]] std::pair<class_id, class_id> power_of(class_id);
+
+      private:
+        /// Rules enabled
+        unsigned rules_;
+
+        /// All e-nodes
+        std::vector<e_node> nodes_;
+
+        /// E-class of each e-node
+        std::vector<class_id> node_class_;
+
+        /// Union-find parent of each e-class
+        /// find compresses the paths, so this is mutable.
+        mutable std::vector<class_id> parent_;
+
+        /// E-nodes of each canonical e-class
+        std::vector<std::vector<size_t>> class_nodes_;
+
+        /// E-nodes indexed by their hash
+        std::unordered_multimap<size_t, size_t> memo_;
+
+        /// Number of merges that joined two e-classes
+        size_t merges_{0};
+
+        /// Iterations in the last saturation
+        size_t iterations_{0};
+
+        /// Limits and start time of the current saturation
+        limits limits_;
+        clock::time_point start_;
+    };
+} // namespace sympp
+
+#endif // SYMPP_E_GRAPH_H
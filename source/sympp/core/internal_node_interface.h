@@ -7,11 +7,15 @@
 
 // C++
 #include <algorithm>
+#include <cstddef>
+#include <iterator>
 #include <numeric>
+#include <utility>
 
 // Internal
 #include <sympp/core/node_interface.h>
 #include <sympp/core/sym.h>
+#include <sympp/core/thread_pool.h>
 
 namespace sympp {
 
@@ -26,6 +30,12 @@ namespace sympp {
             : child_nodes_(children) {}
         explicit internal_node_interface(std::vector<sym> &&children)
             : child_nodes_(std::move(children)) {}
+        internal_node_interface(const internal_node_interface &) = default;
+        internal_node_interface(internal_node_interface &&) noexcept = default;
+        internal_node_interface &
+        operator=(const internal_node_interface &) = default;
+        internal_node_interface &
+        operator=(internal_node_interface &&) noexcept = default;
         ~internal_node_interface() override = default;
 
       public /* virtual placeholders derived classes should override */:
@@ -49,20 +59,19 @@ namespace sympp {
             // This is a placeholder when we don't know how to
             // simplify it. If all symbols do that, nothing gets
             // simplified ever.
-            for (auto &child_node : child_nodes_) {
-                std::optional<sym> r =
-                    child_node.root_node()->simplify(ratio, func);
-                if (r) {
-                    child_node = sym(*r);
-                }
-            }
+            // Children in normal form are skipped
+            // In a parallel scope, the children run on the thread pool
+            parallel_scope::for_each_child(
+                child_nodes_,
+                [&](sym &child_node) { child_node.simplify(ratio, func); });
+            children_changed();
             return std::nullopt;
         }
 
         std::optional<sym> expand() override {
-            for (auto &child_node : child_nodes_) {
-                child_node.expand();
-            }
+            parallel_scope::for_each_child(
+                child_nodes_, [](sym &child_node) { child_node.expand(); });
+            children_changed();
             return std::nullopt;
         }
 
@@ -71,71 +80,63 @@ namespace sympp {
             if (this->compare(*x.root_node()) == 0) {
                 return y;
             }
+            // sym::subs only detaches the children that might change
             for (auto &child_node : child_nodes_) {
-                std::optional<sym> r = child_node.root_node()->subs(x, y);
-                if (r) {
-                    child_node = *r;
-                }
+                child_node.subs(x, y);
             }
+            children_changed();
             return std::nullopt;
         }
 
         [[nodiscard]] int compare(const node_interface &s) const override {
-            // first criterion is type
+            // first criterion is kind
+            if (kind() != s.kind()) {
+                return compare_kinds(kind(), s.kind());
+            }
+            // functions without their own kind share one
             if (type() != s.type()) {
                 return (type().before(s.type())) ? -1 : +1;
             }
 
             // second criterion is number of child nodes
-            using self_t = decltype(*this);
-            const auto &rhs = dynamic_cast<const self_t>(s);
+            const auto &rhs = static_cast<const internal_node_interface &>(s);
             if (child_nodes_.size() != rhs.child_nodes_.size()) {
                 return (child_nodes_.size() < rhs.child_nodes_.size()) ? -1
                                                                        : +1;
             }
 
-            // third criterion is if any child compares != 0
+            // third criterion is the first child that compares != 0
             if (!is_commutative()) {
-                for (size_t i = 0; i < child_nodes_.size(); ++i) {
-                    int r = child_nodes_[i].compare(rhs.child_nodes_[i]);
-                    if (r != 0) {
-                        return r;
-                    }
-                }
-            } else {
-                std::vector<uint8_t> pos_where_found(child_nodes_.size(),
-                                                     false);
-                for (const auto &rhs_child : rhs.child_nodes_) {
-                    auto this_begin = child_nodes_.begin();
-                    while (this_begin != child_nodes_.end()) {
-                        auto is_equal = [&](const auto &a) {
-                            return a.compare(rhs_child) == 0;
-                        };
-                        auto i = std::find_if(this_begin, child_nodes_.end(),
-                                              is_equal);
-                        bool not_found = i == child_nodes_.end();
-                        if (not_found) {
-                            int inequality_value =
-                                child_nodes_.begin()->compare(rhs_child);
-                            return inequality_value != 0 ? inequality_value
-                                                         : -1;
-                        } else {
-                            size_t found_pos = i - child_nodes_.end();
-                            const bool first_time_finding_it =
-                                !pos_where_found[found_pos];
-                            if (first_time_finding_it) {
-                                pos_where_found[found_pos] = true;
-                                this_begin = child_nodes_.end();
-                            } else {
-                                this_begin = std::next(i);
-                            }
-                        }
-                    }
-                }
+                return compare_children(child_nodes_.begin(),
+                                        rhs.child_nodes_.begin());
             }
 
-            // if equal in all criteria, return 0 (they are equal)
-            return 0;
+            // the order of the children of commutative nodes does not
+            // matter, so we compare them in canonical order
+            return compare_sorted_children(rhs);
+        }
+
+        /// Hash the kind and the children
+        /// The order of the children is ignored in commutative nodes,
+        /// so that the hash is consistent with `compare`
+        [[nodiscard]] size_t calculate_hash() const override {
+            // the kind is the same in every run, unlike the type, which
+            // only tells apart the functions that share a kind
+            size_t h = static_cast<size_t>(kind());
+            if (kind() == node_kind::function) {
+                h = hash_combine(h, type().hash_code());
+            }
+            if (is_commutative()) {
+                size_t children_hash = 0;
+                for (const auto &child_node : child_nodes_) {
+                    children_hash += child_node.hash();
+                }
+                return hash_combine(h, children_hash);
+            }
+            for (const auto &child_node : child_nodes_) {
+                h = hash_combine(h, child_node.hash());
+            }
+            return h;
         }
 
         /// Number of terms in an expression
@@ -161,14 +162,21 @@ namespace sympp {
             std::unordered_map<int, sym> &bool_symbols_vars,
             std::unordered_map<int, sym> &int_symbols_vars,
             std::unordered_map<int, sym> &real_symbols_vars,
-            std::unordered_map<std::string, int> &bool_symbols_names,
-            std::unordered_map<std::string, int> &int_symbols_names,
-            std::unordered_map<std::string, int> &real_symbols_names) override {
+            std::unordered_map<symbol_id, int> &bool_symbols_names,
+            std::unordered_map<symbol_id, int> &int_symbols_names,
+            std::unordered_map<symbol_id, int> &real_symbols_names) override {
             // By default, assume only the children might have indexes
+            // Only detach the children whose indexes change
             for (auto &child_node : child_nodes_) {
-                child_node.root_node()->put_indexes(
-                    bool_symbols_vars, int_symbols_vars, real_symbols_vars,
-                    bool_symbols_names, int_symbols_names, real_symbols_names);
+                if (indexes_changed(std::as_const(child_node),
+                                    bool_symbols_vars, int_symbols_vars,
+                                    real_symbols_vars, bool_symbols_names,
+                                    int_symbols_names, real_symbols_names)) {
+                    child_node.root_node()->put_indexes(
+                        bool_symbols_vars, int_symbols_vars,
+                        real_symbols_vars, bool_symbols_names,
+                        int_symbols_names, real_symbols_names);
+                }
             }
         }
 
@@ -199,6 +207,18 @@ namespace sympp {
             }
         }
 
+        /// Get the kind declared by the derived class
+        /// If your class is abstract, it won't inherit this function
+        [[nodiscard]] node_kind calculate_kind() const override {
+            if constexpr (has_kind_value<DERIVED>::value) {
+                return DERIVED::kind_value;
+            } else {
+                throw std::logic_error(
+                    std::string(typeid(DERIVED).name()) +
+                    "::calculate_kind() should not return for abstract types");
+            }
+        }
+
         [[nodiscard]] bool is_commutative() const override { return false; }
 
         /// Return true if this is a terminal node
@@ -221,6 +241,122 @@ namespace sympp {
             return child_nodes_.end();
         }
 
+      protected:
+        /// Compare the children from two positions up to the end
+        [[nodiscard]] int
+        compare_children(std::vector<sym>::const_iterator first,
+                         std::vector<sym>::const_iterator rhs_first) const {
+            for (; first != child_nodes_.end(); ++first, ++rhs_first) {
+                int r = first->compare(*rhs_first);
+                if (r != 0) {
+                    return r;
+                }
+            }
+            return 0;
+        }
+
+        /// Compare the children of two nodes in canonical order
+        /// If the children of both nodes are sorted, this is a linear
+        /// walk. Otherwise, it sorts pointers to the children, so it
+        /// does not reorder children other threads might be reading.
+        [[nodiscard]] int
+        compare_sorted_children(const internal_node_interface &rhs) const {
+            if (children_sorted_ && rhs.children_sorted_) {
+                return compare_children(child_nodes_.begin(),
+                                        rhs.child_nodes_.begin());
+            }
+            std::vector<const sym *> a = sorted_children();
+            std::vector<const sym *> b = rhs.sorted_children();
+            for (size_t i = 0; i < a.size(); ++i) {
+                int r = a[i]->compare(*b[i]);
+                if (r != 0) {
+                    return r;
+                }
+            }
+            return 0;
+        }
+
+        /// Pointers to the children in canonical order
+        [[nodiscard]] std::vector<const sym *> sorted_children() const {
+            std::vector<const sym *> r;
+            r.reserve(child_nodes_.size());
+            for (const auto &child : child_nodes_) {
+                r.emplace_back(&child);
+            }
+            auto less = [](const sym *a, const sym *b) {
+                return a->compare(*b) < 0;
+            };
+            if (!children_sorted_ &&
+                !std::is_sorted(r.begin(), r.end(), less)) {
+                std::stable_sort(r.begin(), r.end(), less);
+            }
+            return r;
+        }
+
+        /// Reset the caches after the children have been modified
+        /// Nodes that keep their children in canonical order, such
+        /// as sums and products, sort them again here. Const functions
+        /// never sort the children, so references to the children
+        /// only move when the node itself is modified.
+        void children_changed() {
+            invalidate_hash();
+            if constexpr (keeps_children_sorted()) {
+                sort_children();
+            }
+        }
+
+        /// True if the derived node keeps its children sorted
+        static constexpr bool keeps_children_sorted() {
+            if constexpr (has_kind_value<DERIVED>::value) {
+                return DERIVED::kind_value == node_kind::summation ||
+                       DERIVED::kind_value == node_kind::product;
+            } else {
+                return false;
+            }
+        }
+
+        /// Sort the children in canonical order
+        /// Operations that keep their children sorted, such as sums and
+        /// products, call this after they build the children. Nodes
+        /// reset children_sorted_ before they are modified, so the
+        /// children are only sorted again if they might have changed.
+        /// Sorting the children does not change the value of a
+        /// commutative node.
+        void sort_children() {
+            if (children_sorted_) {
+                return;
+            }
+            if (!std::is_sorted(child_nodes_.begin(), child_nodes_.end(),
+                                children_less)) {
+                std::stable_sort(child_nodes_.begin(), child_nodes_.end(),
+                                 children_less);
+            }
+            children_sorted_ = true;
+        }
+
+        /// Merge the sorted children before `mid` with the children
+        /// from `mid` to the end, which are sorted here if needed
+        /// This is O(n+m) when both ranges are already sorted.
+        void merge_children(size_t mid, bool tail_is_sorted = false) {
+            auto first = child_nodes_.begin();
+            auto middle = first + static_cast<std::ptrdiff_t>(mid);
+            auto last = child_nodes_.end();
+            if (!tail_is_sorted &&
+                !std::is_sorted(middle, last, children_less)) {
+                std::stable_sort(middle, last, children_less);
+            }
+            if (first != middle && middle != last &&
+                children_less(*middle, *std::prev(middle))) {
+                std::inplace_merge(first, middle, last, children_less);
+            }
+            children_sorted_ = true;
+        }
+
+        /// Canonical order of the children
+        static bool children_less(const sym &a, const sym &b) {
+            return a.compare(b) < 0;
+        }
+
       protected:
         /// Terms of this operation
         std::vector<sym> child_nodes_;
@@ -2,15 +2,83 @@
 // Created by Alan de Freitas on 02/08/19.
 //
 
+// C++
+#include <cstddef>
+#include <memory_resource>
+
+// Internal
+#include <sympp/core/arena.h>
 #include <sympp/core/node_interface.h>
 #include <sympp/core/sym.h>
+#include <sympp/node/terminal/variable.h>
 
 namespace sympp {
 
+    /// Space before each node where we keep its memory resource
+    constexpr size_t node_header_size = alignof(std::max_align_t);
+
+    node_interface::node_interface(const node_interface &rhs) noexcept {
+        *this = rhs;
+    }
+
+    node_interface &
+    node_interface::operator=(const node_interface &rhs) noexcept {
+        // the copy has the same tree, so the cached values still hold
+        const bool hash_valid = rhs.hash_valid_.load(std::memory_order_acquire);
+        hash_.store(rhs.hash_.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+        hash_valid_.store(hash_valid, std::memory_order_release);
+        kind_.store(rhs.kind_.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+        simplified_.store(rhs.simplified_.load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
+        children_sorted_ = rhs.children_sorted_;
+        return *this;
+    }
+
     node_interface::~node_interface() = default;
 
+    void *node_interface::operator new(size_t size) {
+        std::pmr::memory_resource *r = arena::current();
+        void *block =
+            r ? r->allocate(size + node_header_size, node_header_size)
+              : ::operator new(size + node_header_size);
+        *static_cast<std::pmr::memory_resource **>(block) = r;
+        return static_cast<std::byte *>(block) + node_header_size;
+    }
+
+    void node_interface::operator delete(void *p, size_t size) {
+        void *block = static_cast<std::byte *>(p) - node_header_size;
+        auto *r = *static_cast<std::pmr::memory_resource **>(block);
+        if (r) {
+            r->deallocate(block, size + node_header_size, node_header_size);
+        } else {
+            ::operator delete(block);
+        }
+    }
+
     const std::type_info &node_interface::type() const { return typeid(*this); }
 
+    size_t node_interface::hash() const {
+        if (!hash_valid_.load(std::memory_order_acquire)) {
+            // calculate_hash only reads the tree, so threads racing
+            // here calculate and store the same value
+            hash_.store(calculate_hash(), std::memory_order_relaxed);
+            hash_valid_.store(true, std::memory_order_release);
+        }
+        return hash_.load(std::memory_order_relaxed);
+    }
+
+    bool node_interface::has_hash() const {
+        return hash_valid_.load(std::memory_order_acquire);
+    }
+
+    void node_interface::invalidate_hash() {
+        hash_valid_.store(false, std::memory_order_relaxed);
+        children_sorted_ = false;
+        simplified_.store(false, std::memory_order_relaxed);
+    }
+
     std::vector<sym>::iterator node_interface::begin() {
         return std::vector<sym>::iterator();
     }
@@ -32,13 +100,23 @@ namespace sympp {
     }
 
     std::optional<sym> node_interface::simplify(double ratio) {
-        auto measure_fn = [](const node_interface &n) -> double {
-            return static_cast<double>(n.count_ops());
-        };
-        return simplify(ratio, measure_fn);
+        return simplify(ratio, &node_interface::default_measure);
     }
 
-    std::optional<sym> node_interface::simplify() { return simplify(1.7); }
+    std::optional<sym> node_interface::simplify() {
+        return simplify(default_ratio);
+    }
+
+    double node_interface::default_measure(const node_interface &n) {
+        return static_cast<double>(n.count_ops());
+    }
+
+    bool node_interface::is_default_simplify(double ratio,
+                                             const complexity_lambda &f) {
+        using measure_pointer = double (*)(const node_interface &);
+        const auto *p = f.target<measure_pointer>();
+        return ratio == default_ratio && p && *p == &default_measure;
+    }
 
     std::optional<sym> node_interface::expand() { return std::nullopt; }
 
@@ -75,8 +153,33 @@ namespace sympp {
     void node_interface::put_indexes(std::unordered_map<int, sym> &,
                                      std::unordered_map<int, sym> &,
                                      std::unordered_map<int, sym> &,
-                                     std::unordered_map<std::string, int> &,
-                                     std::unordered_map<std::string, int> &,
-                                     std::unordered_map<std::string, int> &) {}
+                                     std::unordered_map<symbol_id, int> &,
+                                     std::unordered_map<symbol_id, int> &,
+                                     std::unordered_map<symbol_id, int> &) {}
+
+    bool node_interface::indexes_changed(
+        const sym &s, std::unordered_map<int, sym> &bool_symbols_vars,
+        std::unordered_map<int, sym> &int_symbols_vars,
+        std::unordered_map<int, sym> &real_symbols_vars,
+        std::unordered_map<symbol_id, int> &bool_symbols_names,
+        std::unordered_map<symbol_id, int> &int_symbols_names,
+        std::unordered_map<symbol_id, int> &real_symbols_names) {
+        if (s.kind() == node_kind::variable) {
+            const variable *v = s.node_as<variable>();
+            return v->find_index(bool_symbols_vars, int_symbols_vars,
+                                 real_symbols_vars, bool_symbols_names,
+                                 int_symbols_names,
+                                 real_symbols_names) != v->index();
+        }
+        // visit all children, so all the names are added in order
+        bool changed = false;
+        for (const sym &child : s) {
+            changed |= indexes_changed(child, bool_symbols_vars,
+                                       int_symbols_vars, real_symbols_vars,
+                                       bool_symbols_names, int_symbols_names,
+                                       real_symbols_names);
+        }
+        return changed;
+    }
 
 } // namespace sympp
\ No newline at end of file
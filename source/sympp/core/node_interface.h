@@ -6,6 +6,7 @@
 #define SYMPP_NODE_INTERFACE_H
 
 // C++
+#include <atomic>
 #include <functional>
 #include <iostream>
 #include <optional>
@@ -15,7 +16,9 @@
 #include <vector>
 
 // Internal
+#include <sympp/core/node_kind.h>
 #include <sympp/core/sym.h>
+#include <sympp/core/symbol_table.h>
 
 namespace sympp {
     // forward declarations
@@ -23,10 +26,29 @@ namespace sympp {
 
     class statement;
 
+    /// Combine a hash value into a seed (as in boost::hash_combine)
+    inline size_t hash_combine(size_t seed, size_t h) {
+        return seed ^ (h + 0x9e3779b97f4a7c15ULL + (seed << 6U) + (seed >> 2U));
+    }
+
     /// Class with the functions any symbol in the tree should have
     class node_interface {
       public:
+        node_interface() = default;
+
+        /// Copy the cached values with the node
+        node_interface(const node_interface &) noexcept;
+
+        node_interface &operator=(const node_interface &) noexcept;
+
         virtual ~node_interface();
+
+      public /* allocation */:
+        /// Allocate a node from the current arena (or from the heap)
+        static void *operator new(size_t size);
+
+        /// Return the node memory to the resource it came from
+        static void operator delete(void *p, size_t size);
       public /* pure virtual functions */:
         /// Stream the node to ostream
         virtual void stream(std::ostream &, bool) const = 0;
@@ -42,6 +64,7 @@ namespace sympp {
         /// Get coefficients
         [[nodiscard]] virtual sym coeff(const node_interface &) const = 0;
 
+
         /// True if the operation is commutative
         [[nodiscard]] virtual bool is_commutative() const;
 
@@ -54,9 +77,22 @@ namespace sympp {
         put_indexes(std::unordered_map<int, sym> &bool_symbols_vars,
                     std::unordered_map<int, sym> &int_symbols_vars,
                     std::unordered_map<int, sym> &real_symbols_vars,
-                    std::unordered_map<std::string, int> &bool_symbols_names,
-                    std::unordered_map<std::string, int> &int_symbols_names,
-                    std::unordered_map<std::string, int> &real_symbols_names);
+                    std::unordered_map<symbol_id, int> &bool_symbols_names,
+                    std::unordered_map<symbol_id, int> &int_symbols_names,
+                    std::unordered_map<symbol_id, int> &real_symbols_names);
+
+        /// True if put_indexes would change an index in an expression
+        /// New names are added to the maps, in the order put_indexes
+        /// adds them, so the callers only need to detach and put the
+        /// indexes in the expressions where this is true
+        static bool
+        indexes_changed(const sym &,
+                        std::unordered_map<int, sym> &bool_symbols_vars,
+                        std::unordered_map<int, sym> &int_symbols_vars,
+                        std::unordered_map<int, sym> &real_symbols_vars,
+                        std::unordered_map<symbol_id, int> &bool_symbols_names,
+                        std::unordered_map<symbol_id, int> &int_symbols_names,
+                        std::unordered_map<symbol_id, int> &real_symbols_names);
 
         /// Evaluate expression to a number
         [[nodiscard]] virtual double
@@ -91,6 +127,90 @@ namespace sympp {
         /// Return true if this is a terminal node
         [[nodiscard]] virtual bool is_terminal() const = 0;
 
+      protected /* pure virtual functions */:
+        /// Calculate the structural hash of the expression tree
+        /// Nodes that compare equal must have the same hash
+        [[nodiscard]] virtual size_t calculate_hash() const = 0;
+
+        /// Calculate the kind of the concrete node type
+        [[nodiscard]] virtual node_kind calculate_kind() const = 0;
+
+      public /* node kind */:
+        /// Kind of the concrete node type
+        /// The kind is calculated once and cached
+        [[nodiscard]] node_kind kind() const {
+            node_kind k = kind_.load(std::memory_order_relaxed);
+            if (k == node_kind::undefined) {
+                k = calculate_kind();
+                kind_.store(k, std::memory_order_relaxed);
+            }
+            return k;
+        }
+
+        /// Check if this node is a NODE_TYPE or derives from it
+        template <class NODE_TYPE> [[nodiscard]] bool is() const {
+            if constexpr (is_kind_checkable_v<NODE_TYPE>) {
+                return is_kind_of<NODE_TYPE>(kind());
+            } else {
+                return dynamic_cast<const NODE_TYPE *>(this) != nullptr;
+            }
+        }
+
+        /// Checked static_cast to another node type
+        /// \return nullptr if this node is not a NODE_TYPE
+        template <class NODE_TYPE> [[nodiscard]] const NODE_TYPE *as() const {
+            return is<NODE_TYPE>() ? static_cast<const NODE_TYPE *>(this)
+                                   : nullptr;
+        }
+
+        /// Checked static_cast to another node type
+        /// \return nullptr if this node is not a NODE_TYPE
+        template <class NODE_TYPE> [[nodiscard]] NODE_TYPE *as() {
+            return is<NODE_TYPE>() ? static_cast<NODE_TYPE *>(this) : nullptr;
+        }
+
+      public /* hash */:
+        /// Structural hash of the expression tree
+        /// The hash is calculated once and cached until the
+        /// node is invalidated. Threads may read the same node
+        /// through different syms: if they calculate the hash at
+        /// the same time, they store the same value.
+        [[nodiscard]] size_t hash() const;
+
+        /// True if the hash has already been calculated
+        [[nodiscard]] bool has_hash() const;
+
+        /// Invalidate the cached hash, the order of the children
+        /// and the normal form flag
+        /// This needs to be called before the node is modified
+        void invalidate_hash();
+
+      public /* normal form */:
+        /// True if simplify has already put this node in normal form
+        /// Like the hash, the flag is reset when the node is modified.
+        /// The flag only refers to the default options, so it is only
+        /// used and set when simplify runs with the default ratio and
+        /// complexity measure.
+        [[nodiscard]] bool is_simplified() const {
+            return simplified_.load(std::memory_order_relaxed);
+        }
+
+        /// Mark this node as being in normal form
+        void mark_simplified() const {
+            simplified_.store(true, std::memory_order_relaxed);
+        }
+
+        /// Ratio simplify uses by default
+        static constexpr double default_ratio = 1.7;
+
+        /// Complexity measure simplify uses by default
+        /// This is the number of operations in the expression tree.
+        static double default_measure(const node_interface &);
+
+        /// True if these are the options simplify uses by default
+        [[nodiscard]] static bool
+        is_default_simplify(double ratio, const complexity_lambda &);
+
       public /* virtual functions */:
         /// Return type of this symbolic variable
         [[nodiscard]] virtual const std::type_info &type() const;
@@ -176,6 +296,30 @@ namespace sympp {
 
         /// Iterate the terms of an internal node (null iterator otherwise)
         [[nodiscard]] virtual std::vector<sym>::const_iterator end() const;
+
+      private:
+        /// The caches below are written by const functions, so they
+        /// are atomic: syms sharing a node can be read from many
+        /// threads at once
+
+        /// Cached structural hash
+        mutable std::atomic<size_t> hash_{0};
+
+        /// True if hash_ has been calculated
+        mutable std::atomic<bool> hash_valid_{false};
+
+        /// Cached kind of the concrete node type
+        mutable std::atomic<node_kind> kind_{node_kind::undefined};
+
+        /// True if the node is known to be in normal form
+        mutable std::atomic<bool> simplified_{false};
+
+      protected:
+        /// True if the children are known to be in canonical order
+        /// Like the hash, this is reset before the node is modified.
+        /// Only functions that modify the node sort the children, so
+        /// const functions never reorder them.
+        bool children_sorted_{false};
     };
 
 } // namespace sympp
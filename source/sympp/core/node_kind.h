@@ -0,0 +1,100 @@
+// node_kind.h
+
+#ifndef SYMPP_NODE_KIND_H
+#define SYMPP_NODE_KIND_H
+
+// C++
+#include <cstdint>
+#include <type_traits>
+
+namespace sympp {
+    // forward declarations
+    class number_interface;
+
+    class function_interface;
+
+    /// Compact tag with the concrete type of a node
+    /// Checking the kind of a node is a byte comparison, while
+    /// checking its type_info or dynamic_cast'ing it needs RTTI.
+    /// Numbers and functions are kept in contiguous ranges so
+    /// we can check the category of a node with two comparisons.
+    enum class node_kind : uint8_t {
+        /// Kind not calculated yet
+        undefined,
+        // numbers
+        boolean,
+        integer,
+        rational,
+        real,
+        // other terminals
+        constant,
+        variable,
+        // operations
+        summation,
+        product,
+        // functions
+        pow,
+        log,
+        sin,
+        cos,
+        sinh,
+        cosh,
+        abs,
+        /// Any other function derived from function_interface
+        function,
+        // statements
+        statement
+    };
+
+    /// True if the kind is a number
+    constexpr bool is_number_kind(node_kind k) {
+        return k >= node_kind::boolean && k <= node_kind::real;
+    }
+
+    /// True if the kind is a function
+    constexpr bool is_function_kind(node_kind k) {
+        return k >= node_kind::pow && k <= node_kind::function;
+    }
+
+    /// Order of two kinds: -1, 0 or +1
+    /// Unlike std::type_info::before, this order does not depend on
+    /// the compiler or on the process, so the canonical order of
+    /// expressions is the same everywhere.
+    constexpr int compare_kinds(node_kind a, node_kind b) {
+        if (a == b) {
+            return 0;
+        }
+        return a < b ? -1 : +1;
+    }
+
+    /// Check if a node type declares its kind in a `kind_value` constant
+    template <class NODE_TYPE, class = void>
+    struct has_kind_value : std::false_type {};
+
+    template <class NODE_TYPE>
+    struct has_kind_value<NODE_TYPE,
+                          std::void_t<decltype(NODE_TYPE::kind_value)>>
+        : std::true_type {};
+
+    /// Check if a node type can be identified by its kind only
+    /// Other types need a dynamic_cast
+    template <class NODE_TYPE>
+    constexpr bool is_kind_checkable_v =
+        std::is_same_v<std::remove_cv_t<NODE_TYPE>, number_interface> ||
+        std::is_same_v<std::remove_cv_t<NODE_TYPE>, function_interface> ||
+        has_kind_value<std::remove_cv_t<NODE_TYPE>>::value;
+
+    /// True if a node of kind k is a NODE_TYPE or derives from it
+    template <class NODE_TYPE> constexpr bool is_kind_of(node_kind k) {
+        using type = std::remove_cv_t<NODE_TYPE>;
+        if constexpr (std::is_same_v<type, number_interface>) {
+            return is_number_kind(k);
+        } else if constexpr (std::is_same_v<type, function_interface>) {
+            return is_function_kind(k);
+        } else {
+            return k == type::kind_value;
+        }
+    }
+} // namespace sympp
+
+#endif // SYMPP_NODE_KIND_H
@@ -0,0 +1,396 @@
+// rewrite_rule.cpp
+
+// C++
+#include <algorithm>
+#include <utility>
+
+// Internal
+#include <sympp/core/arena.h>
+#include <sympp/core/node_interface.h>
+#include <sympp/core/rewrite_rule.h>
+#include <sympp/core/sym_builder.h>
+#include <sympp/functions/operators.h>
+#include <sympp/node/function/cos.h>
+#include <sympp/node/function/cosh.h>
+#include <sympp/node/function/log.h>
+#include <sympp/node/function/pow.h>
+#include <sympp/node/function/sin.h>
+#include <sympp/node/function/sinh.h>
+
+namespace sympp {
+
+    namespace {
+        /// True if the children of a node match subsets of terms
+        bool is_associative(node_kind k) {
+            return k == node_kind::summation || k == node_kind::product;
+        }
+
+        /// Number of rewrites at the root of an expression on top of one
+        /// per term. This stops rules whose replacements simplify back
+        /// into their patterns.
+        constexpr size_t max_root_rewrites = 16;
+    } // namespace
+
+    rewrite_rule::rewrite_rule(sym pattern, sym replacement,
+                               std::vector<sym> wildcards, condition c)
+        : pattern_(std::move(pattern)), replacement_(std::move(replacement)),
+          wildcards_(std::move(wildcards)), condition_(std::move(c)) {}
+
+    const sym &rewrite_rule::pattern() const { return pattern_; }
+
+    std::optional<sym> rewrite_rule::apply(const sym &s) const {
+        bindings b(wildcards_.size());
+        std::vector<bool> bound(wildcards_.size(), false);
+        if (!is_associative(pattern_.kind()) || wildcard(pattern_)) {
+            if (!match(pattern_, s, b, bound) ||
+                (condition_ && !condition_(b))) {
+                return std::nullopt;
+            }
+            return instantiate(replacement_, b);
+        }
+        if (s.kind() != pattern_.kind() || s.size() < pattern_.size()) {
+            return std::nullopt;
+        }
+        // replace every disjoint match in the terms at once, so large
+        // sums do not need one rewrite per match
+        sym_builder result(s.kind());
+        std::vector<bool> used(s.size(), false);
+        for (;;) {
+            std::vector<bool> next_used = used;
+            if (!match_terms(pattern_, s, 0, next_used, b, bound, true)) {
+                break;
+            }
+            result.push_back(instantiate(replacement_, b));
+            used = std::move(next_used);
+            b.assign(wildcards_.size(), sym());
+            bound.assign(wildcards_.size(), false);
+        }
+        if (result.size() == 0) {
+            return std::nullopt;
+        }
+        // keep the terms the pattern did not match
+        for (size_t i = 0; i < s.size(); ++i) {
+            if (!used[i]) {
+                result.push_back(s[i]);
+            }
+        }
+        return result.build();
+    }
+
+    bool rewrite_rule::match(const sym &pattern, const sym &s, bindings &b,
+                             std::vector<bool> &bound) const {
+        if (std::optional<size_t> w = wildcard(pattern)) {
+            if (bound[*w]) {
+                return b[*w].compare(s) == 0;
+            }
+            b[*w] = s;
+            bound[*w] = true;
+            return true;
+        }
+        if (pattern.kind() != s.kind() || pattern.size() != s.size()) {
+            return false;
+        }
+        if (pattern.is_terminal()) {
+            return pattern.compare(s) == 0;
+        }
+        if (is_associative(pattern.kind())) {
+            std::vector<bool> used(s.size(), false);
+            return match_terms(pattern, s, 0, used, b, bound, false);
+        }
+        if (pattern.kind() == node_kind::function) {
+            // user functions with the same kind might still differ, so
+            // they only match themselves
+            return pattern.compare(s) == 0;
+        }
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            if (!match(pattern[i], s[i], b, bound)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool rewrite_rule::match_terms(const sym &pattern, const sym &s, size_t i,
+                                   std::vector<bool> &used, bindings &b,
+                                   std::vector<bool> &bound, bool root) const {
+        if (i == pattern.size()) {
+            // nested sums and products have to match every term, and
+            // the condition is part of the match, so a failed condition
+            // tries the next assignment of terms
+            if (!root) {
+                return std::all_of(used.begin(), used.end(),
+                                   [](bool u) { return u; });
+            }
+            return !condition_ || condition_(b);
+        }
+        for (size_t j = 0; j < s.size(); ++j) {
+            // skip the terms that cannot match before copying the bindings
+            if (used[j] || (!wildcard(pattern[i]) &&
+                            pattern[i].kind() != s[j].kind())) {
+                continue;
+            }
+            bindings next_b = b;
+            std::vector<bool> next_bound = bound;
+            if (!match(pattern[i], s[j], next_b, next_bound)) {
+                continue;
+            }
+            used[j] = true;
+            if (match_terms(pattern, s, i + 1, used, next_b, next_bound,
+                            root)) {
+                b = std::move(next_b);
+                bound = std::move(next_bound);
+                return true;
+            }
+            used[j] = false;
+        }
+        return false;
+    }
+
+    bool rewrite_rule::is_wildcard(const sym &s) const {
+        return wildcard(s).has_value();
+    }
+
+    std::optional<size_t> rewrite_rule::wildcard(const sym &s) const {
+        if (!s.is_variable()) {
+            return std::nullopt;
+        }
+        for (size_t i = 0; i < wildcards_.size(); ++i) {
+            if (wildcards_[i].compare(s) == 0) {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
+
+    sym rewrite_rule::instantiate(const sym &s, const bindings &b) const {
+        if (std::optional<size_t> w = wildcard(s)) {
+            return b[*w];
+        }
+        if (s.is_terminal()) {
+            return s;
+        }
+        if (is_associative(s.kind())) {
+            sym_builder result(s.kind());
+            result.reserve(s.size());
+            for (const sym &child : s) {
+                result.push_back(instantiate(child, b));
+            }
+            return result.build();
+        }
+        // copy the node, so functions keep their flags
+        sym result = s;
+        for (size_t i = 0; i < s.size(); ++i) {
+            result[i] = instantiate(s[i], b);
+        }
+        return result;
+    }
+
+    rule_set::rule_set() : trie_(1) {}
+
+    rule_set &rule_set::add(rewrite_rule r) {
+        // walk the pattern in preorder and extend the trie
+        std::vector<const sym *> pending{&r.pattern()};
+        size_t t = 0;
+        while (!pending.empty()) {
+            const sym &p = *pending.back();
+            pending.pop_back();
+            std::optional<size_t> next;
+            if (r.is_wildcard(p)) {
+                next = trie_[t].wildcard;
+                if (!next) {
+                    next = trie_.size();
+                    trie_[t].wildcard = next;
+                    trie_.emplace_back();
+                }
+            } else {
+                const key k = key_of(p);
+                auto it = trie_[t].edges.find(k);
+                if (it != trie_[t].edges.end()) {
+                    next = it->second;
+                } else {
+                    next = trie_.size();
+                    trie_[t].edges.emplace(k, *next);
+                    trie_.emplace_back();
+                }
+                if (descends(p)) {
+                    for (size_t i = p.size(); i > 0; --i) {
+                        pending.emplace_back(&p[i - 1]);
+                    }
+                }
+            }
+            t = *next;
+        }
+        trie_[t].rules.emplace_back(rules_.size());
+        rules_.emplace_back(std::move(r));
+        return *this;
+    }
+
+    rule_set &rule_set::add(const sym &pattern, const sym &replacement,
+                            const std::vector<sym> &wildcards,
+                            rewrite_rule::condition c) {
+        return add(rewrite_rule(pattern, replacement, wildcards, std::move(c)));
+    }
+
+    size_t rule_set::size() const { return rules_.size(); }
+
+    std::vector<size_t> rule_set::candidates(const sym &s) const {
+        std::vector<size_t> rules;
+        std::vector<const sym *> pending{&s};
+        collect(0, pending, rules);
+        std::sort(rules.begin(), rules.end());
+        rules.erase(std::unique(rules.begin(), rules.end()), rules.end());
+        return rules;
+    }
+
+    size_t rule_set::rewrite(sym &s) const {
+        attempts_ = 0;
+        return rewrite_tree(s);
+    }
+
+    size_t rule_set::attempts() const { return attempts_; }
+
+    rule_set::key rule_set::key_of(const sym &s) {
+        // the terms of sums and products match subsets, so their
+        // number of children is not part of the key
+        const auto k = static_cast<key>(s.kind()) << 16U;
+        return is_associative(s.kind()) ? k : k | static_cast<key>(s.size());
+    }
+
+    bool rule_set::descends(const sym &s) {
+        return !s.is_terminal() && !is_associative(s.kind());
+    }
+
+    void rule_set::collect(size_t t, std::vector<const sym *> &pending,
+                           std::vector<size_t> &rules) const {
+        const trie_node &n = trie_[t];
+        if (pending.empty()) {
+            rules.insert(rules.end(), n.rules.begin(), n.rules.end());
+            return;
+        }
+        const sym *s = pending.back();
+        pending.pop_back();
+        if (n.wildcard) {
+            // the wildcard skips the whole subtree
+            collect(*n.wildcard, pending, rules);
+        }
+        auto it = n.edges.find(key_of(*s));
+        if (it != n.edges.end()) {
+            const size_t size = pending.size();
+            if (descends(*s)) {
+                for (size_t i = s->size(); i > 0; --i) {
+                    pending.emplace_back(&(*s)[i - 1]);
+                }
+            }
+            collect(it->second, pending, rules);
+            pending.resize(size);
+        }
+        pending.emplace_back(s);
+    }
+
+    size_t rule_set::rewrite_tree(sym &s) const {
+        if (s.is_terminal()) {
+            return rewrite_root(s);
+        }
+        size_t n = 0;
+        for (size_t i = 0; i < s.size(); ++i) {
+            // only detach the nodes we rewrite
+            sym child = std::as_const(s)[i];
+            const size_t k = rewrite_tree(child);
+            if (k != 0) {
+                s[i] = std::move(child);
+                n += k;
+            }
+        }
+        if (n != 0) {
+            s.simplify();
+        }
+        return n + rewrite_root(s);
+    }
+
+    size_t rule_set::rewrite_root(sym &s) const {
+        // every rewrite of a sum or product can consume some of its
+        // terms, so the limit grows with the number of terms
+        const size_t limit = max_root_rewrites + s.size();
+        size_t n = 0;
+        while (n < limit) {
+            std::optional<sym> r;
+            for (size_t i : candidates(s)) {
+                ++attempts_;
+                r = rules_[i].apply(s);
+                if (r) {
+                    break;
+                }
+            }
+            if (!r) {
+                break;
+            }
+            s = std::move(*r);
+            s.simplify();
+            ++n;
+        }
+        return n;
+    }
+
+    namespace {
+        /// True if the value of a wildcard is a number
+        rewrite_rule::condition is_number_at(size_t i) {
+            return [i](const rewrite_rule::bindings &b) {
+                return b[i].is_number();
+            };
+        }
+    } // namespace
+
+    const rule_set &rule_set::trigsimp() {
+        static const rule_set rules = [] {
+            // the rules outlive any arena
+            arena heap(nullptr);
+            sym x("x_"), c("c_");
+            sym s = sym(sin(x));
+            sym co = sym(cos(x));
+            sym sh = sym(sinh(x));
+            sym ch = sym(cosh(x));
+            sym two(2);
+            rule_set r;
+            r.add(sym(pow(s, two)) + sym(pow(co, two)), sym(1), {x});
+            r.add(c * sym(pow(s, two)) + c * sym(pow(co, two)), c, {x, c});
+            r.add(sym(pow(ch, two)) - sym(pow(sh, two)), sym(1), {x});
+            r.add(s * co, sym(sin(two * x)) / two, {x});
+            r.add(c * s * co, c / two * sym(sin(two * x)), {x, c},
+                  is_number_at(1));
+            return r;
+        }();
+        return rules;
+    }
+
+    const rule_set &rule_set::powsimp() {
+        static const rule_set rules = [] {
+            // the rules outlive any arena
+            arena heap(nullptr);
+            sym x("x_"), y("y_"), a("a_"), b("b_");
+            rule_set r;
+            r.add(sym(pow(x, a)) * sym(pow(x, b)), sym(pow(x, a + b)),
+                  {x, a, b});
+            r.add(x * sym(pow(x, a)), sym(pow(x, a + 1)), {x, a});
+            r.add(sym(pow(x, a)) * sym(pow(y, a)), sym(pow(x * y, a)),
+                  {x, y, a});
+            return r;
+        }();
+        return rules;
+    }
+
+    const rule_set &rule_set::logcombine() {
+        static const rule_set rules = [] {
+            // the rules outlive any arena
+            arena heap(nullptr);
+            sym x("x_"), y("y_"), b("b_"), n("n_");
+            rule_set r;
+            r.add(sym(log(x, b)) + sym(log(y, b)), sym(log(x * y, b)),
+                  {x, y, b});
+            r.add(n * sym(log(x, b)), sym(log(sym(pow(x, n)), b)), {n, x, b},
+                  is_number_at(0));
+            return r;
+        }();
+        return rules;
+    }
+
+} // namespace sympp
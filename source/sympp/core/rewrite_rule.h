@@ -0,0 +1,178 @@
+// rewrite_rule.h
+
+#ifndef SYMPP_REWRITE_RULE_H
+#define SYMPP_REWRITE_RULE_H
+
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Internal
+#include <sympp/core/node_kind.h>
+#include <sympp/core/sym.h>
+
+namespace sympp {
+    /// \class Declarative rewrite rule
+    /// A rule replaces the expressions that match a pattern with a
+    /// replacement. The wildcards are variables that match any
+    /// expression, and every occurrence of a wildcard in the pattern
+    /// must match the same expression. The replacement uses the values
+    /// of the wildcards, and an optional condition can reject a match.
+    /// The children of sums and products in the pattern match any
+    /// subset of the terms of a sum or product, so a pattern like
+    /// sin(x)^2+cos(x)^2 also matches sin(x)^2+cos(x)^2+y and the
+    /// terms that do not match are kept next to the replacement.
+    class rewrite_rule {
+      public:
+        /// Values of the wildcards, in the order the wildcards were given
+        using bindings = std::vector<sym>;
+
+        /// Side condition of a rule
+        using condition = std::function<bool(const bindings &)>;
+
+        /// Rule pattern -> replacement with wildcards
+        rewrite_rule(sym pattern, sym replacement, std::vector<sym> wildcards,
+                     condition = nullptr);
+
+        /// Pattern of the rule
+        [[nodiscard]] const sym &pattern() const;
+
+        /// Try to rewrite an expression with this rule
+        /// \return The replacement, or nullopt if the rule does not match
+        [[nodiscard]] std::optional<sym> apply(const sym &) const;
+
+        /// True if an expression is one of the wildcards
+        [[nodiscard]] bool is_wildcard(const sym &) const;
+
+      private:
+        /// Match a pattern with an expression and bind the wildcards
+        bool match(const sym &pattern, const sym &, bindings &,
+                   std::vector<bool> &bound) const;
+
+        /// Match the children of a sum or product pattern with a
+        /// subset of the children of the expression
+        /// At the root, the condition is part of the match and the
+        /// expression can have more children than the pattern.
+        bool match_terms(const sym &pattern, const sym &, size_t i,
+                         std::vector<bool> &used, bindings &,
+                         std::vector<bool> &bound, bool root) const;
+
+        /// Index of a wildcard, or nullopt if it is not a wildcard
+        [[nodiscard]] std::optional<size_t> wildcard(const sym &) const;
+
+        /// Replace the wildcards in an expression with their values
+        [[nodiscard]] sym instantiate(const sym &, const bindings &) const;
+
+      private:
+        /// Pattern
+        sym pattern_;
+
+        /// Replacement
+        sym replacement_;
+
+        /// Wildcards
+        std::vector<sym> wildcards_;
+
+        /// Side condition
+        condition condition_;
+    };
+
+    /// \class Set of rewrite rules
+    /// The rules are indexed in a discrimination tree: a trie whose
+    /// keys are the kinds of the pattern nodes in preorder, where
+    /// wildcards are a key that matches any subtree. Looking up the
+    /// rules for an expression walks the trie with the expression, so
+    /// each node visit only checks the rules that can match it, and a
+    /// rewrite pass stays linear in the size of the tree as the rule
+    /// set grows. Sums and products are a single key, because their
+    /// children match subsets of the terms.
+    class rule_set {
+      public:
+        /// Empty rule set
+        rule_set();
+
+        /// Add a rule
+        /// Rules added first are tried first.
+        rule_set &add(rewrite_rule);
+
+        /// Add a rule pattern -> replacement with wildcards
+        rule_set &add(const sym &pattern, const sym &replacement,
+                      const std::vector<sym> &wildcards,
+                      rewrite_rule::condition = nullptr);
+
+        /// Number of rules
+        [[nodiscard]] size_t size() const;
+
+        /// Indexes of the rules that might match an expression
+        /// The rules are in the order they were added.
+        [[nodiscard]] std::vector<size_t> candidates(const sym &) const;
+
+        /// Rewrite an expression bottom-up until no rule matches
+        /// The replacements are simplified before we try the rules
+        /// again on them.
+        /// \return Number of rewrites
+        size_t rewrite(sym &) const;
+
+        /// Number of rules we tried in the last rewrite
+        [[nodiscard]] size_t attempts() const;
+
+      public /* rules for the transforms */:
+        /// Trigonometric identities for trigsimp
+        static const rule_set &trigsimp();
+
+        /// Identities x^a*x^b=x^{a+b} and x^a*y^a=(xy)^a for powsimp
+        static const rule_set &powsimp();
+
+        /// Identities log(x)+log(y)=log(xy) and n*log(x)=log(x^n) for
+        /// logcombine
+        static const rule_set &logcombine();
+
+      private:
+        /// Key of a node in the discrimination tree
+        using key = uint32_t;
+
+        /// Node of the discrimination tree
+        struct trie_node {
+            /// Children by the key of the next pattern node
+            std::unordered_map<key, size_t> edges;
+
+            /// Child for a wildcard
+            std::optional<size_t> wildcard;
+
+            /// Rules whose pattern ends here
+            std::vector<size_t> rules;
+        };
+
+        /// Key of a node
+        static key key_of(const sym &);
+
+        /// True if the trie continues with the children of a node
+        static bool descends(const sym &);
+
+        /// Collect the rules that might match the pending subtrees
+        void collect(size_t trie, std::vector<const sym *> &pending,
+                     std::vector<size_t> &rules) const;
+
+        /// Rewrite the children of an expression and then its root
+        size_t rewrite_tree(sym &) const;
+
+        /// Rewrite the root of an expression until no rule matches
+        size_t rewrite_root(sym &) const;
+
+      private:
+        /// Rules
+        std::vector<rewrite_rule> rules_;
+
+        /// Discrimination tree with the root at index 0
+        std::vector<trie_node> trie_;
+
+        /// Rules we tried in the last rewrite
+        mutable size_t attempts_{0};
+    };
+} // namespace sympp
+
+#endif // SYMPP_REWRITE_RULE_H
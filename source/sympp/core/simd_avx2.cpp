@@ -0,0 +1,26 @@
+// simd_avx2.cpp
+
+// C++
+#include <cstdint>
+
+// Internal
+#define SYMPP_SIMD_TARGET "avx2,fma"
+#include <sympp/core/simd_kernels.h>
+
+SYMPP_SIMD_BEGIN(SYMPP_SIMD_TARGET)
+namespace sympp::simd {
+    namespace {
+        /// \class Vectors of four doubles
+        struct avx2 {
+            typedef double V __attribute__((vector_size(32)));
+            typedef uint64_t U __attribute__((vector_size(32)));
+
+            static V sqrt(V v) { return __builtin_ia32_sqrtpd256(v); }
+        };
+    } // namespace
+} // namespace sympp::simd
+SYMPP_SIMD_END
+
+namespace sympp::simd {
+    const kernel_table &avx2_kernels() { return kernels<avx2>::table(); }
+} // namespace sympp::simd
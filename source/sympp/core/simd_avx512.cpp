@@ -0,0 +1,29 @@
+// simd_avx512.cpp
+
+// C++
+#include <cstdint>
+
+// Internal
+#define SYMPP_SIMD_TARGET "avx512f,fma"
+#include <sympp/core/simd_kernels.h>
+
+SYMPP_SIMD_BEGIN(SYMPP_SIMD_TARGET)
+namespace sympp::simd {
+    namespace {
+        /// \class Vectors of eight doubles
+        struct avx512 {
+            typedef double V __attribute__((vector_size(64)));
+            typedef uint64_t U __attribute__((vector_size(64)));
+
+            static V sqrt(V v) {
+                // all lanes, with the current rounding mode
+                return __builtin_ia32_sqrtpd512_mask(v, v, -1, 4);
+            }
+        };
+    } // namespace
+} // namespace sympp::simd
+SYMPP_SIMD_END
+
+namespace sympp::simd {
+    const kernel_table &avx512_kernels() { return kernels<avx512>::table(); }
+} // namespace sympp::simd
@@ -0,0 +1,453 @@
+// simd_kernels.h
+
+#ifndef SYMPP_SIMD_KERNELS_H
+#define SYMPP_SIMD_KERNELS_H
+
+// C++
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+// Internal
+#include <sympp/core/simd_math.h>
+
+// The code between SYMPP_SIMD_BEGIN and SYMPP_SIMD_END is compiled for
+// an instruction set, such as "avx2,fma". We use target pragmas rather
+// than -m flags for the whole file: the inline functions of the
+// headers (std::abs, std::fill, ...) have vague linkage, so the linker
+// keeps one of their copies for all translation units, and that copy
+// must not use instructions the CPU might not have.
+#define SYMPP_SIMD_PRAGMA(x) _Pragma(#x)
+#if defined(__clang__)
+#define SYMPP_SIMD_BEGIN(isa)                                                  \
+    SYMPP_SIMD_PRAGMA(clang attribute push(__attribute__((target(isa))),       \
+                                           apply_to = function))
+#define SYMPP_SIMD_END SYMPP_SIMD_PRAGMA(clang attribute pop)
+#else
+// GCC declares the function pointer conversion of the lambdas without
+// the target, and warns about its vector arguments even though it is
+// never used.
+#define SYMPP_SIMD_BEGIN(isa)                                                  \
+    SYMPP_SIMD_PRAGMA(GCC push_options)                                        \
+    SYMPP_SIMD_PRAGMA(GCC target(isa))                                         \
+    SYMPP_SIMD_PRAGMA(GCC diagnostic push)                                     \
+    SYMPP_SIMD_PRAGMA(GCC diagnostic ignored "-Wpsabi")
+#define SYMPP_SIMD_END                                                         \
+    SYMPP_SIMD_PRAGMA(GCC diagnostic pop) SYMPP_SIMD_PRAGMA(GCC pop_options)
+#endif
+
+namespace sympp::simd {
+    /// \class Table of kernels for one instruction set
+    struct kernel_table {
+        void (*add)(const double *, const double *, double *, size_t);
+        void (*multiply)(const double *, const double *, double *, size_t);
+        void (*abs)(const double *, double *, size_t);
+        void (*sqrt)(const double *, double *, size_t);
+        void (*integer_power)(const double *, int, double *, size_t);
+        void (*pow)(const double *, const double *, double *, size_t);
+        void (*exp)(const double *, double *, size_t);
+        void (*log)(const double *, double *, size_t);
+        void (*sin)(const double *, double *, size_t);
+        void (*cos)(const double *, double *, size_t);
+        void (*sinh)(const double *, double *, size_t);
+        void (*cosh)(const double *, double *, size_t);
+    };
+
+    /// Kernels with AVX2 and FMA (simd_avx2.cpp)
+    const kernel_table &avx2_kernels();
+
+    /// Kernels with AVX-512 (simd_avx512.cpp)
+    const kernel_table &avx512_kernels();
+
+} // namespace sympp::simd
+
+// Each translation unit compiles the kernels for its own instruction
+// set, which it defines in SYMPP_SIMD_TARGET before including this
+// header, so the kernels have internal linkage. Otherwise the linker
+// could keep the AVX-512 copy of a kernel for every CPU.
+#ifdef SYMPP_SIMD_TARGET
+SYMPP_SIMD_BEGIN(SYMPP_SIMD_TARGET)
+namespace sympp::simd {
+    namespace {
+        /// \class Kernels over the lanes of a vector type
+        /// The traits define V, a GCC vector of doubles, U, a vector
+        /// of uint64_t with the same number of lanes, and sqrt.
+        template <class TRAITS> struct kernels {
+            using V = typename TRAITS::V;
+            using U = typename TRAITS::U;
+
+            /// Number of doubles in a vector
+            static constexpr size_t lanes = sizeof(V) / sizeof(double);
+
+            /// 1.5 * 2^52: adding it rounds a double to an integer
+            static constexpr double magic = 6755399441055744.;
+
+            static V load(const double *p) {
+                V v;
+                std::memcpy(&v, p, sizeof(V));
+                return v;
+            }
+
+            static void store(double *p, V v) { std::memcpy(p, &v, sizeof(V)); }
+
+            static V splat(double d) {
+                V v = {};
+                return v + d;
+            }
+
+            static U bits(V v) { return (U)v; }
+
+            static V from_bits(U u) { return (V)u; }
+
+            /// Lanes of a where the mask is set and of b elsewhere
+            template <class MASK> static V select(MASK m, V a, V b) {
+                const U mask = (U)m;
+                return from_bits((bits(a) & mask) | (bits(b) & ~mask));
+            }
+
+            /// Nearest integer, for |x| < 2^51
+            static V round(V x) { return (x + magic) - magic; }
+
+            /// Integer value of a rounded double, in two's complement
+            static U to_int(V rounded) {
+                return bits(rounded + magic) - bits(splat(magic));
+            }
+
+            /// Double value of a small integer in two's complement
+            static V to_double(U i) {
+                return from_bits(i + bits(splat(magic))) - magic;
+            }
+
+            /// 2^k for -1022 <= k <= 1023
+            static V pow2(U k) { return from_bits((k + 1023U) << 52U); }
+
+            /// Apply f to each vector of x, and g to the lanes where
+            /// the vector version is not accurate
+            template <class F, class NEEDS, class G>
+            static void unary(const double *x, double *r, size_t n, F f,
+                              NEEDS needs, G g) {
+                auto apply = [&](V v) {
+                    V y = f(v);
+                    for (size_t j = 0; j < lanes; ++j) {
+                        if (needs(v[j])) {
+                            y[j] = g(v[j]);
+                        }
+                    }
+                    return y;
+                };
+                size_t i = 0;
+                for (; i + lanes <= n; i += lanes) {
+                    store(r + i, apply(load(x + i)));
+                }
+                if (i < n) {
+                    // the last values are padded with ones
+                    double in[lanes];
+                    double out[lanes];
+                    std::fill(in, in + lanes, 1.);
+                    std::memcpy(in, x + i, (n - i) * sizeof(double));
+                    store(out, apply(load(in)));
+                    std::memcpy(r + i, out, (n - i) * sizeof(double));
+                }
+            }
+
+            /// Apply f to each vector of x
+            template <class F>
+            static void unary(const double *x, double *r, size_t n, F f) {
+                unary(
+                    x, r, n, f, [](double) { return false; },
+                    [](double v) { return v; });
+            }
+
+            /// Apply f to each pair of vectors of x and y
+            template <class F>
+            static void binary(const double *x, const double *y, double *r,
+                               size_t n, F f) {
+                size_t i = 0;
+                for (; i + lanes <= n; i += lanes) {
+                    store(r + i, f(load(x + i), load(y + i)));
+                }
+                if (i < n) {
+                    double a[lanes];
+                    double b[lanes];
+                    double out[lanes];
+                    std::fill(a, a + lanes, 1.);
+                    std::fill(b, b + lanes, 1.);
+                    std::memcpy(a, x + i, (n - i) * sizeof(double));
+                    std::memcpy(b, y + i, (n - i) * sizeof(double));
+                    store(out, f(load(a), load(b)));
+                    std::memcpy(r + i, out, (n - i) * sizeof(double));
+                }
+            }
+
+            /// e^x with Cody-Waite reduction and a Taylor polynomial
+            static V exp_lanes(V x) {
+                constexpr double ln2_hi = 6.93147180369123816490e-01;
+                constexpr double ln2_lo = 1.90821492927058770002e-10;
+                constexpr double inv_ln2 = 1.44269504088896338700e+00;
+                // clamp, so k stays small for infinities
+                const V c = select(x > 746., splat(746.),
+                                   select(x < -746., splat(-746.), x));
+                const V k = round(c * inv_ln2);
+                const V r = (c - k * ln2_hi) - k * ln2_lo;
+                // |r| <= ln(2)/2, so the terms after r^13/13! are
+                // below half an ulp
+                V p = splat(1.6059043836821613e-10);
+                p = p * r + 2.08767569878681e-09;
+                p = p * r + 2.505210838544172e-08;
+                p = p * r + 2.755731922398589e-07;
+                p = p * r + 2.755731922398589e-06;
+                p = p * r + 2.48015873015873e-05;
+                p = p * r + 1.984126984126984e-04;
+                p = p * r + 1.388888888888889e-03;
+                p = p * r + 8.333333333333333e-03;
+                p = p * r + 4.1666666666666664e-02;
+                p = p * r + 1.6666666666666666e-01;
+                p = p * r + 0.5;
+                p = p * r * r + r;
+                p = p + 1.;
+                // scale in two steps, so subnormal results are exact
+                const V k1 = round(k * 0.5);
+                const V k2 = k - k1;
+                V y = p * pow2(to_int(k1)) * pow2(to_int(k2));
+                y = select(x > 709.782712893384,
+                           splat(std::numeric_limits<double>::infinity()), y);
+                y = select(x < -745.1332191019412, splat(0.), y);
+                return select(x != x, x, y);
+            }
+
+            /// ln(x) with the reduction and polynomial of fdlibm
+            static V log_lanes(V x) {
+                constexpr double ln2_hi = 6.93147180369123816490e-01;
+                constexpr double ln2_lo = 1.90821492927058770002e-10;
+                constexpr double min_normal =
+                    std::numeric_limits<double>::min();
+                // subnormals are scaled to normal numbers
+                const auto subnormal = x < min_normal;
+                const V xs = select(subnormal, x * 4503599627370496., x);
+                const U b = bits(xs);
+                V e = to_double(((b >> 52U) & 0x7ffU) - 1023U) -
+                      select(subnormal, splat(52.), splat(0.));
+                // x = 2^e m with sqrt(2)/2 <= m < sqrt(2)
+                V m = from_bits((b & 0x000fffffffffffffU) |
+                                0x3ff0000000000000U);
+                const auto big = m > 1.4142135623730951;
+                m = select(big, m * 0.5, m);
+                e = e + select(big, splat(1.), splat(0.));
+                const V f = m - 1.;
+                const V s = f / (f + 2.);
+                const V z = s * s;
+                const V w = z * z;
+                const V t1 =
+                    w * (3.999999999940941908e-01 +
+                         w * (2.222219843214978396e-01 +
+                              w * 1.531383769920937332e-01));
+                const V t2 =
+                    z * (6.666666666666735130e-01 +
+                         w * (2.857142874366239149e-01 +
+                              w * (1.818357216161805012e-01 +
+                                   w * 1.479819860511658591e-01)));
+                const V hfsq = 0.5 * f * f;
+                V y = e * ln2_hi -
+                      ((hfsq - (s * (hfsq + t1 + t2) + e * ln2_lo)) - f);
+                constexpr double inf = std::numeric_limits<double>::infinity();
+                y = select(x == 0., splat(-inf), y);
+                y = select(x < 0., splat(std::nan("")), y);
+                y = select(x == inf, splat(inf), y);
+                return select(x != x, x, y);
+            }
+
+            /// Reduce x to r in [-pi/4, pi/4] and the quadrant of x
+            static void reduce(V x, V &r, U &q) {
+                constexpr double two_over_pi = 6.36619772367581382433e-01;
+                // pi/2 in three parts of 33 bits, as in fdlibm
+                constexpr double pio2_1 = 1.57079632673412561417e+00;
+                constexpr double pio2_2 = 6.07710050630396597660e-11;
+                constexpr double pio2_3 = 2.02226624871116645580e-21;
+                const V n = round(x * two_over_pi);
+                r = ((x - n * pio2_1) - n * pio2_2) - n * pio2_3;
+                q = to_int(n) & 3U;
+            }
+
+            /// sin(r) for |r| <= pi/4, as in fdlibm
+            static V sin_poly(V r) {
+                const V z = r * r;
+                const V p =
+                    8.33333333332248946124e-03 +
+                    z * (-1.98412698298579493134e-04 +
+                         z * (2.75573137070700676789e-06 +
+                              z * (-2.50507602534068634195e-08 +
+                                   z * 1.58969099521155010221e-10)));
+                return r + z * r * (-1.66666666666666324348e-01 + z * p);
+            }
+
+            /// cos(r) for |r| <= pi/4, as in fdlibm
+            static V cos_poly(V r) {
+                const V z = r * r;
+                V p = splat(-1.13596475577881948265e-11);
+                p = p * z + 2.08757232129817482790e-09;
+                p = p * z - 2.75573143513906633035e-07;
+                p = p * z + 2.48015872894767294178e-05;
+                p = p * z - 1.38888888888741095749e-03;
+                p = p * z + 4.16666666666666019037e-02;
+                p = p * z;
+                const V hz = 0.5 * z;
+                const V w = 1. - hz;
+                return w + (((1. - w) - hz) + z * p);
+            }
+
+            static V sin_lanes(V x) {
+                V r;
+                U q;
+                reduce(x, r, q);
+                const V s = sin_poly(r);
+                const V c = cos_poly(r);
+                const V y = select((q & 1U) != 0U, c, s);
+                return select((q & 2U) != 0U, -y, y);
+            }
+
+            static V cos_lanes(V x) {
+                V r;
+                U q;
+                reduce(x, r, q);
+                const V s = sin_poly(r);
+                const V c = cos_poly(r);
+                const V y = select((q & 1U) != 0U, s, c);
+                return select(((q + 1U) & 2U) != 0U, -y, y);
+            }
+
+            /// e^a / 2 for a >= 0 without overflow for large a
+            static V half_exp(V a) {
+                const auto big = a > 709.;
+                const V e = exp_lanes(select(big, a * 0.5, a));
+                return select(big, (0.5 * e) * e, 0.5 * e);
+            }
+
+            static V cosh_lanes(V x) {
+                const V a = select(x < 0., -x, x);
+                const V h = half_exp(a);
+                return h + 0.25 / h;
+            }
+
+            static V sinh_lanes(V x) {
+                const V a = select(x < 0., -x, x);
+                const V h = half_exp(a);
+                V y = h - 0.25 / h;
+                // the difference loses digits near 0, so small values
+                // use the Taylor series up to a^17/17!
+                const V z = a * a;
+                V p = splat(2.8114572543455206e-15);
+                p = p * z + 7.647163731819816e-13;
+                p = p * z + 1.6059043836821613e-10;
+                p = p * z + 2.505210838544172e-08;
+                p = p * z + 2.755731922398589e-06;
+                p = p * z + 1.984126984126984e-04;
+                p = p * z + 8.333333333333333e-03;
+                p = p * z + 1.6666666666666666e-01;
+                y = select(a < 1., a + a * z * p, y);
+                // restore the sign of x
+                return from_bits(bits(y) | (bits(x) & 0x8000000000000000U));
+            }
+
+            static void add(const double *x, const double *y, double *r,
+                            size_t n) {
+                binary(x, y, r, n, [](V a, V b) { return a + b; });
+            }
+
+            static void multiply(const double *x, const double *y, double *r,
+                                 size_t n) {
+                binary(x, y, r, n, [](V a, V b) { return a * b; });
+            }
+
+            static void abs(const double *x, double *r, size_t n) {
+                unary(x, r, n, [](V v) {
+                    return from_bits(bits(v) & 0x7fffffffffffffffU);
+                });
+            }
+
+            static void sqrt(const double *x, double *r, size_t n) {
+                unary(x, r, n, [](V v) { return TRAITS::sqrt(v); });
+            }
+
+            static void integer_power(const double *x, int k, double *r,
+                                      size_t n) {
+                // the same steps as pow::integer_power, so the results
+                // round the same way
+                const unsigned m = k < 0 ? -static_cast<unsigned>(k) : k;
+                unary(x, r, n, [k, m](V v) {
+                    V p = splat(1.);
+                    for (unsigned e = m; e != 0;) {
+                        if (e & 1U) {
+                            p = p * v;
+                        }
+                        e >>= 1U;
+                        if (e != 0) {
+                            v = v * v;
+                        }
+                    }
+                    return k < 0 ? 1. / p : p;
+                });
+            }
+
+            static void pow(const double *x, const double *y, double *r,
+                            size_t n) {
+                binary(x, y, r, n, [](V a, V b) {
+                    const V t = b * log_lanes(a);
+                    V z = exp_lanes(t);
+                    // the error grows with |y ln x|, and x <= 0 needs
+                    // the special cases of std::pow
+                    for (size_t j = 0; j < lanes; ++j) {
+                        if (!(a[j] > 0.) || !(std::abs(t[j]) <= 16.) ||
+                            !std::isfinite(a[j])) {
+                            z[j] = std::pow(a[j], b[j]);
+                        }
+                    }
+                    return z;
+                });
+            }
+
+            static void exp(const double *x, double *r, size_t n) {
+                unary(x, r, n, exp_lanes);
+            }
+
+            static void log(const double *x, double *r, size_t n) {
+                unary(x, r, n, log_lanes);
+            }
+
+            static void sin(const double *x, double *r, size_t n) {
+                unary(
+                    x, r, n, sin_lanes,
+                    [](double v) { return std::abs(v) > 1e5; },
+                    [](double v) { return std::sin(v); });
+            }
+
+            static void cos(const double *x, double *r, size_t n) {
+                unary(
+                    x, r, n, cos_lanes,
+                    [](double v) { return std::abs(v) > 1e5; },
+                    [](double v) { return std::cos(v); });
+            }
+
+            static void sinh(const double *x, double *r, size_t n) {
+                unary(x, r, n, sinh_lanes);
+            }
+
+            static void cosh(const double *x, double *r, size_t n) {
+                unary(x, r, n, cosh_lanes);
+            }
+
+            /// Table with these kernels
+            static const kernel_table &table() {
+                static const kernel_table t{
+                    add, multiply, abs, sqrt, integer_power, pow,
+                    exp, log,      sin, cos,  sinh,          cosh};
+                return t;
+            }
+        };
+    } // namespace
+} // namespace sympp::simd
+SYMPP_SIMD_END
+#endif
+
+#endif // SYMPP_SIMD_KERNELS_H
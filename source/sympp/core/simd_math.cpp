@@ -0,0 +1,180 @@
+// simd_math.cpp
+
+// C++
+#include <atomic>
+#include <cmath>
+
+// Internal
+#include <sympp/core/simd_kernels.h>
+#include <sympp/core/simd_math.h>
+#include <sympp/node/function/pow.h>
+
+namespace sympp::simd {
+    namespace {
+        /// Kernels calling the standard library
+        const kernel_table &scalar_kernels() {
+            static const kernel_table t{
+                [](const double *x, const double *y, double *r, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        r[i] = x[i] + y[i];
+                    }
+                },
+                [](const double *x, const double *y, double *r, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        r[i] = x[i] * y[i];
+                    }
+                },
+                [](const double *x, double *r, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        r[i] = std::abs(x[i]);
+                    }
+                },
+                [](const double *x, double *r, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        r[i] = std::sqrt(x[i]);
+                    }
+                },
+                [](const double *x, int k, double *r, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        r[i] = pow::integer_power(x[i], k);
+                    }
+                },
+                [](const double *x, const double *y, double *r, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        r[i] = std::pow(x[i], y[i]);
+                    }
+                },
+                [](const double *x, double *r, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        r[i] = std::exp(x[i]);
+                    }
+                },
+                [](const double *x, double *r, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        r[i] = std::log(x[i]);
+                    }
+                },
+                [](const double *x, double *r, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        r[i] = std::sin(x[i]);
+                    }
+                },
+                [](const double *x, double *r, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        r[i] = std::cos(x[i]);
+                    }
+                },
+                [](const double *x, double *r, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        r[i] = std::sinh(x[i]);
+                    }
+                },
+                [](const double *x, double *r, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        r[i] = std::cosh(x[i]);
+                    }
+                }};
+            return t;
+        }
+
+        /// Instruction set chosen with use(), or best()
+        std::atomic<instruction_set> &chosen() {
+            static std::atomic<instruction_set> set{best()};
+            return set;
+        }
+
+        /// Kernels of the active instruction set
+        const kernel_table &active_kernels() {
+#ifdef SYMPP_SIMD_X86
+            switch (active()) {
+            case instruction_set::avx512:
+                return avx512_kernels();
+            case instruction_set::avx2:
+                return avx2_kernels();
+            default:
+                break;
+            }
+#endif
+            return scalar_kernels();
+        }
+    } // namespace
+
+    instruction_set best() {
+#ifdef SYMPP_SIMD_X86
+        static const instruction_set set = [] {
+            if (__builtin_cpu_supports("avx512f")) {
+                return instruction_set::avx512;
+            }
+            if (__builtin_cpu_supports("avx2") &&
+                __builtin_cpu_supports("fma")) {
+                return instruction_set::avx2;
+            }
+            return instruction_set::scalar;
+        }();
+        return set;
+#else
+        return instruction_set::scalar;
+#endif
+    }
+
+    instruction_set active() {
+        return chosen().load(std::memory_order_relaxed);
+    }
+
+    void use(instruction_set set) {
+        // the sets are ordered, and a CPU supporting one set supports
+        // the sets before it
+        if (static_cast<int>(set) > static_cast<int>(best())) {
+            set = best();
+        }
+        chosen().store(set, std::memory_order_relaxed);
+    }
+
+    void add(const double *x, const double *y, double *r, size_t n) {
+        active_kernels().add(x, y, r, n);
+    }
+
+    void multiply(const double *x, const double *y, double *r, size_t n) {
+        active_kernels().multiply(x, y, r, n);
+    }
+
+    void abs(const double *x, double *r, size_t n) {
+        active_kernels().abs(x, r, n);
+    }
+
+    void sqrt(const double *x, double *r, size_t n) {
+        active_kernels().sqrt(x, r, n);
+    }
+
+    void integer_power(const double *x, int k, double *r, size_t n) {
+        active_kernels().integer_power(x, k, r, n);
+    }
+
+    void pow(const double *x, const double *y, double *r, size_t n) {
+        active_kernels().pow(x, y, r, n);
+    }
+
+    void exp(const double *x, double *r, size_t n) {
+        active_kernels().exp(x, r, n);
+    }
+
+    void log(const double *x, double *r, size_t n) {
+        active_kernels().log(x, r, n);
+    }
+
+    void sin(const double *x, double *r, size_t n) {
+        active_kernels().sin(x, r, n);
+    }
+
+    void cos(const double *x, double *r, size_t n) {
+        active_kernels().cos(x, r, n);
+    }
+
+    void sinh(const double *x, double *r, size_t n) {
+        active_kernels().sinh(x, r, n);
+    }
+
+    void cosh(const double *x, double *r, size_t n) {
+        active_kernels().cosh(x, r, n);
+    }
+} // namespace sympp::simd
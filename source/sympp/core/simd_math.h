@@ -0,0 +1,89 @@
+// simd_math.h
+
+#ifndef SYMPP_SIMD_MATH_H
+#define SYMPP_SIMD_MATH_H
+
+// C++
+#include <cstddef>
+
+namespace sympp {
+    namespace execution {
+        /// \class Execution policy for the SIMD batch kernels
+        struct simd_policy {};
+
+        /// Evaluate batches with the SIMD kernels
+        inline constexpr simd_policy simd{};
+    } // namespace execution
+
+    /// Math kernels over arrays of doubles
+    /// Each kernel applies one function to n values. The kernels have
+    /// versions for AVX2 and AVX-512 lanes, and the version is chosen
+    /// at runtime from the instruction sets of the CPU. Other CPUs use
+    /// the scalar versions, which call the standard library.
+    ///
+    /// The vector versions use their own polynomial approximations.
+    /// Their maximum errors, measured against the standard library
+    /// in units in the last place (ULP), are:
+    /// - exp, log: 1 ULP
+    /// - sin, cos: 1 ULP for |x| <= 4 and 2 ULP for |x| <= 1e5.
+    ///   Larger arguments use the standard library.
+    /// - sinh, cosh: 2 ULP, and 3 ULP for |x| > 709
+    /// - pow: 1 + 3 |y ln x| ULP, for |y ln x| <= 16. Other arguments,
+    ///   including x <= 0, use the standard library.
+    /// - sqrt, add, multiply, abs and integer powers round like the
+    ///   scalar operations.
+    namespace simd {
+        /// Instruction set of the kernels
+        enum class instruction_set { scalar, avx2, avx512 };
+
+        /// Best instruction set this CPU supports
+        [[nodiscard]] instruction_set best();
+
+        /// Instruction set the kernels use
+        /// This is best() unless use() chose another one.
+        [[nodiscard]] instruction_set active();
+
+        /// Choose the instruction set of the kernels
+        /// Sets the CPU does not support fall back to best(). This
+        /// is mostly useful to compare the versions.
+        void use(instruction_set);
+
+        /// r[i] = x[i] + y[i]
+        void add(const double *x, const double *y, double *r, size_t n);
+
+        /// r[i] = x[i] * y[i]
+        void multiply(const double *x, const double *y, double *r, size_t n);
+
+        /// r[i] = |x[i]|
+        void abs(const double *x, double *r, size_t n);
+
+        /// r[i] = sqrt(x[i])
+        void sqrt(const double *x, double *r, size_t n);
+
+        /// r[i] = x[i]^k by repeated squaring
+        void integer_power(const double *x, int k, double *r, size_t n);
+
+        /// r[i] = x[i]^y[i]
+        void pow(const double *x, const double *y, double *r, size_t n);
+
+        /// r[i] = e^x[i]
+        void exp(const double *x, double *r, size_t n);
+
+        /// r[i] = ln(x[i])
+        void log(const double *x, double *r, size_t n);
+
+        /// r[i] = sin(x[i])
+        void sin(const double *x, double *r, size_t n);
+
+        /// r[i] = cos(x[i])
+        void cos(const double *x, double *r, size_t n);
+
+        /// r[i] = sinh(x[i])
+        void sinh(const double *x, double *r, size_t n);
+
+        /// r[i] = cosh(x[i])
+        void cosh(const double *x, double *r, size_t n);
+    } // namespace simd
+} // namespace sympp
+
+#endif // SYMPP_SIMD_MATH_H
@@ -0,0 +1,171 @@
+// simplifier.cpp
+
+// C++
+#include <optional>
+#include <unordered_set>
+#include <utility>
+
+// Internal
+#include <sympp/core/node_interface.h>
+#include <sympp/core/simplifier.h>
+#include <sympp/core/sym_error.h>
+#include <sympp/functions/operators.h>
+
+namespace sympp {
+    thread_local simplifier *simplifier::current_{nullptr};
+
+    simplifier::simplifier(double ratio)
+        : simplifier(ratio, &node_interface::default_measure) {}
+
+    simplifier::simplifier(double ratio, complexity_lambda measure)
+        : ratio_(ratio), measure_(std::move(measure)) {
+        // Every pass leaves the candidate in normal form, so
+        // candidates are scored and compared in the same form
+        auto normalized = [ratio, m = measure_](sym &(sym::*f)()) {
+            return [ratio, m, f](sym &s) { (s.*f)().simplify(ratio, m); };
+        };
+        passes_ = {[ratio, m = measure_](sym &s) { s.simplify(ratio, m); },
+                   normalized(&sym::expand),
+                   normalized(&sym::collect),
+                   normalized(&sym::factor),
+                   normalized(&sym::cancel),
+                   normalized(&sym::powsimp),
+                   normalized(&sym::powdenest),
+                   normalized(&sym::trigsimp),
+                   normalized(&sym::logcombine)};
+    }
+
+    simplifier &simplifier::max_nodes(size_t n) {
+        max_nodes_ = n;
+        return *this;
+    }
+
+    simplifier &simplifier::max_time(clock::duration t) {
+        max_time_ = t;
+        return *this;
+    }
+
+    simplifier &simplifier::add_pass(transform f) {
+        passes_.emplace_back(std::move(f));
+        return *this;
+    }
+
+    simplifier &simplifier::clear_passes() {
+        passes_.clear();
+        return *this;
+    }
+
+    sym simplifier::operator()(const sym &s) {
+        start_ = clock::now();
+        pass_nodes_ = 0;
+        candidates_ = 0;
+        rejected_ = 0;
+        nodes_ = 0;
+        exhausted_ = false;
+
+        sym best = s;
+        double best_score = measure_(*s.root_node());
+        const double limit = ratio_ * best_score;
+        std::unordered_set<sym> seen{s};
+
+        // Passes check the budget of the driver running on this thread
+        struct restore {
+            simplifier *previous{current_};
+            ~restore() { current_ = previous; }
+        } r;
+        current_ = this;
+
+        // Number of steps in a row that did not improve the best candidate
+        int stale = 0;
+        sym current = s;
+        while (stale < 2) {
+            std::optional<sym> next;
+            double next_score = 0.;
+            for (const transform &pass : passes_) {
+                if (!within_budget()) {
+                    return best;
+                }
+                sym candidate = current;
+                pass_nodes_ = 0;
+                try {
+                    pass(candidate);
+                } catch (const sym_error &e) {
+                    if (e.error_number() != sym_error::BudgetExhausted) {
+                        throw;
+                    }
+                    return best;
+                }
+                pass_nodes_ = 0;
+                if (!seen.insert(candidate).second) {
+                    continue;
+                }
+                ++candidates_;
+                nodes_ += count_nodes(candidate);
+                const double score =
+                    measure_(*std::as_const(candidate).root_node());
+                if (score > limit) {
+                    ++rejected_;
+                    continue;
+                }
+                if (!next || score < next_score) {
+                    next = std::move(candidate);
+                    next_score = score;
+                }
+            }
+            if (!next) {
+                break;
+            }
+            current = std::move(*next);
+            // Prefer the candidates in normal form on ties
+            if (next_score <= best_score) {
+                best = current;
+            }
+            if (next_score < best_score) {
+                best_score = next_score;
+                stale = 0;
+            } else {
+                ++stale;
+            }
+        }
+        return best;
+    }
+
+    size_t simplifier::candidates() const { return candidates_; }
+
+    size_t simplifier::rejected() const { return rejected_; }
+
+    size_t simplifier::nodes() const { return nodes_; }
+
+    bool simplifier::exhausted() const { return exhausted_; }
+
+    bool simplifier::running() { return current_ != nullptr; }
+
+    void simplifier::check_budget(size_t nodes) {
+        simplifier *s = current_;
+        if (!s) {
+            return;
+        }
+        s->pass_nodes_ += nodes;
+        if (!s->within_budget()) {
+            throw sym_error(sym_error::BudgetExhausted);
+        }
+    }
+
+    bool simplifier::within_budget() {
+        if (nodes_ >= max_nodes_ || pass_nodes_ >= max_nodes_ - nodes_ ||
+            (max_time_ != clock::duration::max() &&
+             clock::now() - start_ >= max_time_)) {
+            exhausted_ = true;
+        }
+        return !exhausted_;
+    }
+
+    size_t simplifier::count_nodes(const sym &s) {
+        size_t n = 1;
+        for (const sym &child : s) {
+            n += count_nodes(child);
+        }
+        return n;
+    }
+
+} // namespace sympp
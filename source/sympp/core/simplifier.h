@@ -0,0 +1,125 @@
+// simplifier.h
+
+#ifndef SYMPP_SIMPLIFIER_H
+#define SYMPP_SIMPLIFIER_H
+
+// C++
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <vector>
+
+// Internal
+#include <sympp/core/sym.h>
+
+namespace sympp {
+    /// \class Budgeted simplification driver
+    /// The driver applies a list of transform passes (expand, factor,
+    /// collect, ...) to an expression and scores each candidate with
+    /// a complexity measure. Candidates that are more than `ratio`
+    /// times as complex as the original expression are rejected.
+    /// At each step, the driver moves to the simplest candidate it has
+    /// not seen yet, even if it is a bit more complex than the current
+    /// one, because some transforms (like expand) only pay off after
+    /// another transform. The search stops when two steps in a row do
+    /// not improve the best candidate.
+    /// The driver is an anytime algorithm: when the node or time
+    /// budget is exhausted, it returns the simplest candidate it has
+    /// found so far, which is never more complex than the original.
+    /// Long passes (like expand) check the budget as they go, so
+    /// the driver can stop them before they finish.
+    class simplifier {
+      public:
+        /// Transform that might make an expression simpler
+        using transform = std::function<void(sym &)>;
+
+        /// Clock for the time budget
+        using clock = std::chrono::steady_clock;
+
+        /// Driver with the default passes and no budget
+        /// The default measure is the number of operations.
+        explicit simplifier(double ratio = 1.7);
+
+        /// Driver with the default passes and a complexity measure
+        simplifier(double ratio, complexity_lambda measure);
+
+        /// Stop after scoring candidates with this many nodes in total
+        /// The nodes a pass builds count too, so a pass that builds
+        /// more nodes than the budget has left is interrupted.
+        simplifier &max_nodes(size_t);
+
+        /// Stop after this much time has passed
+        /// Passes that check the budget are interrupted, so only the
+        /// other passes might run over the budget.
+        simplifier &max_time(clock::duration);
+
+        /// Append a transform pass
+        simplifier &add_pass(transform);
+
+        /// Remove all transform passes
+        simplifier &clear_passes();
+
+        /// Return the simplest equivalent expression we find
+        [[nodiscard]] sym operator()(const sym &);
+
+      public /* statistics of the last run */:
+        /// Number of candidates scored
+        [[nodiscard]] size_t candidates() const;
+
+        /// Number of candidates rejected for exceeding the ratio
+        [[nodiscard]] size_t rejected() const;
+
+        /// Number of nodes in the candidates scored
+        [[nodiscard]] size_t nodes() const;
+
+        /// True if the search stopped because of the budget
+        [[nodiscard]] bool exhausted() const;
+
+      public /* budget of the running pass */:
+        /// True while a driver runs a pass on this thread
+        [[nodiscard]] static bool running();
+
+        /// Account for the nodes a long pass builds
+        /// Throws sym_error::BudgetExhausted if the driver running on
+        /// this thread is out of budget, so the driver can discard the
+        /// candidate. Outside a driver, this does nothing.
+        static void check_budget(size_t nodes = 1);
+
+      private:
+        /// Check the budget and update the exhausted flag
+        bool within_budget();
+
+        /// Number of nodes in an expression tree
+        static size_t count_nodes(const sym &);
+
+      private:
+        /// Maximum growth allowed for the candidates
+        double ratio_;
+
+        /// Complexity measure of the candidates
+        complexity_lambda measure_;
+
+        /// Transform passes in the order we try them
+        std::vector<transform> passes_;
+
+        /// Budget
+        size_t max_nodes_{std::numeric_limits<size_t>::max()};
+        clock::duration max_time_{clock::duration::max()};
+
+        /// Start of the last run and nodes built by the running pass
+        clock::time_point start_;
+        size_t pass_nodes_{0};
+
+        /// Driver running a pass on this thread
+        static thread_local simplifier *current_;
+
+        /// Statistics
+        size_t candidates_{0};
+        size_t rejected_{0};
+        size_t nodes_{0};
+        bool exhausted_{false};
+    };
+} // namespace sympp
+
+#endif // SYMPP_SIMPLIFIER_H
@@ -0,0 +1,48 @@
+// simplify_memo.cpp
+
+// Internal
+#include <sympp/core/node_interface.h>
+#include <sympp/core/simplify_memo.h>
+#include <sympp/core/unique_table.h>
+
+namespace sympp {
+
+    thread_local simplify_memo *simplify_memo::current_{nullptr};
+
+    simplify_memo::simplify_memo() : previous_(current_) { current_ = this; }
+
+    simplify_memo::~simplify_memo() { current_ = previous_; }
+
+    simplify_memo *simplify_memo::current() { return current_; }
+
+    std::optional<sym> simplify_memo::find(const sym &s) {
+        ++lookups_;
+        const node_interface &n = *s.root_node();
+        auto [first, last] = table_.equal_range(n.hash());
+        for (auto it = first; it != last; ++it) {
+            if (unique_table::identical(*it->second.first.root_node(), n)) {
+                ++hits_;
+                return it->second.second;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void simplify_memo::insert(const sym &expression, const sym &simplified) {
+        table_.emplace(expression.root_node()->hash(),
+                       std::make_pair(expression, simplified));
+    }
+
+    size_t simplify_memo::size() const { return table_.size(); }
+
+    size_t simplify_memo::lookups() const { return lookups_; }
+
+    size_t simplify_memo::hits() const { return hits_; }
+
+    void simplify_memo::clear() {
+        table_.clear();
+        lookups_ = 0;
+        hits_ = 0;
+    }
+
+} // namespace sympp
@@ -0,0 +1,80 @@
+// simplify_memo.h
+
+#ifndef SYMPP_SIMPLIFY_MEMO_H
+#define SYMPP_SIMPLIFY_MEMO_H
+
+// C++
+#include <cstddef>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+// Internal
+#include <sympp/core/sym.h>
+
+namespace sympp {
+    /// \class Memo table for simplify
+    /// While a memo is alive, the expressions simplified in the same
+    /// thread are stored in the memo with their simplified form.
+    /// When simplify finds an expression identical to one it has
+    /// already simplified, it reuses the result instead of simplifying
+    /// the expression again. This is useful for models with shared
+    /// subtrees that are not the same node, such as subexpressions
+    /// built separately.
+    /// Memos can be nested: the innermost memo is used.
+    /// The memo does not remember the ratio or the complexity measure,
+    /// so every expression simplified while the memo is alive should
+    /// use the same options.
+    /// If the memo is created inside an arena, it must be destroyed
+    /// before the arena itself.
+    class simplify_memo {
+      public:
+        /// Start memoizing simplify in this thread
+        simplify_memo();
+
+        simplify_memo(const simplify_memo &) = delete;
+
+        simplify_memo &operator=(const simplify_memo &) = delete;
+
+        /// Restore the previous memo
+        ~simplify_memo();
+
+        /// Innermost memo in this thread
+        /// This is nullptr if there is no memo
+        [[nodiscard]] static simplify_memo *current();
+
+        /// Simplified form of an expression identical to the argument
+        [[nodiscard]] std::optional<sym> find(const sym &);
+
+        /// Store the simplified form of an expression
+        void insert(const sym &expression, const sym &simplified);
+
+        /// Number of expressions in the memo
+        [[nodiscard]] size_t size() const;
+
+        /// Number of times we looked for an expression in the memo
+        [[nodiscard]] size_t lookups() const;
+
+        /// Number of times we found an identical expression in the memo
+        [[nodiscard]] size_t hits() const;
+
+        /// Remove all expressions from the memo and reset the counters
+        void clear();
+
+      private:
+        /// Expressions and their simplified form indexed by hash
+        std::unordered_multimap<size_t, std::pair<sym, sym>> table_;
+
+        /// Counters
+        size_t lookups_{0};
+        size_t hits_{0};
+
+        /// Memo we should restore when this memo is destroyed
+        simplify_memo *previous_;
+
+        /// Innermost memo in this thread
+        static thread_local simplify_memo *current_;
+    };
+} // namespace sympp
+
+#endif // SYMPP_SIMPLIFY_MEMO_H
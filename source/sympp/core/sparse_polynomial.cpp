@@ -0,0 +1,764 @@
+// sparse_polynomial.cpp
+
+// C++
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+// Internal
+#include <sympp/core/simplifier.h>
+#include <sympp/core/sparse_polynomial.h>
+#include <sympp/core/sym_builder.h>
+#include <sympp/functions/operators.h>
+#include <sympp/node/function/pow.h>
+#include <sympp/node/terminal/number_interface.h>
+#include <sympp/node/terminal/rational.h>
+#include <sympp/node/terminal/real.h>
+
+namespace sympp {
+
+    /// Bits of each exponent in the packed exponent vectors
+    constexpr unsigned exponent_bits = 16;
+
+    /// Exponents in each 64-bit word
+    constexpr size_t exponents_per_word = 64 / exponent_bits;
+
+    /// Largest exponent we can pack
+    constexpr unsigned exponent_limit = (1U << exponent_bits) - 1;
+
+    sparse_polynomial::coefficient
+    sparse_polynomial::coefficient::from_number(const sym &s) {
+        coefficient c;
+        if (s.kind() == node_kind::rational) {
+            auto r = s.node_as<rational>();
+            c.numerator = r->numerator();
+            c.denominator = r->denominator();
+        } else if (s.kind() == node_kind::real) {
+            c.is_real = true;
+            c.real_value = static_cast<double>(*s.node_as<number_interface>());
+        } else {
+            c.numerator = static_cast<int>(*s.node_as<number_interface>());
+        }
+        return c;
+    }
+
+    sparse_polynomial::coefficient sparse_polynomial::coefficient::one() {
+        coefficient c;
+        c.numerator = 1;
+        return c;
+    }
+
+    sparse_polynomial::coefficient
+    sparse_polynomial::coefficient::power(int n) const {
+        coefficient b = *this;
+        if (n < 0) {
+            if (b.is_real) {
+                b.real_value = 1.0 / b.real_value;
+            } else {
+                std::swap(b.numerator, b.denominator);
+                if (b.denominator < 0) {
+                    b.numerator = -b.numerator;
+                    b.denominator = -b.denominator;
+                }
+            }
+        }
+        coefficient r = one();
+        for (int i = 0; i < std::abs(n); ++i) {
+            r = r * b;
+        }
+        return r;
+    }
+
+    bool sparse_polynomial::coefficient::is_zero() const {
+        return is_real ? real_value == 0.0 : numerator == 0;
+    }
+
+    bool sparse_polynomial::coefficient::is_one() const {
+        return is_real ? real_value == 1.0
+                       : numerator == 1 && denominator == 1;
+    }
+
+    double sparse_polynomial::coefficient::to_double() const {
+        if (is_real) {
+            return real_value;
+        }
+        return static_cast<double>(numerator) /
+               static_cast<double>(denominator);
+    }
+
+    sym sparse_polynomial::coefficient::to_sym() const {
+        constexpr int64_t int_min = std::numeric_limits<int>::min();
+        constexpr int64_t int_max = std::numeric_limits<int>::max();
+        const bool fits_int = numerator >= int_min && numerator <= int_max &&
+                              denominator <= int_max;
+        if (is_real || !fits_int) {
+            return sym(real(to_double()));
+        }
+        if (denominator == 1) {
+            return sym(static_cast<int>(numerator));
+        }
+        return sym(rational(static_cast<int>(numerator),
+                            static_cast<int>(denominator)));
+    }
+
+    sparse_polynomial::coefficient &
+    sparse_polynomial::coefficient::operator+=(const coefficient &rhs) {
+        if (!is_real && !rhs.is_real) {
+            int64_t n;
+            int64_t d = denominator;
+            bool exact;
+            if (denominator == rhs.denominator) {
+                exact = checked_add(numerator, rhs.numerator, n);
+            } else {
+                int64_t a;
+                int64_t b;
+                exact = checked_mul(numerator, rhs.denominator, a) &&
+                        checked_mul(rhs.numerator, denominator, b) &&
+                        checked_add(a, b, n) &&
+                        checked_mul(denominator, rhs.denominator, d);
+            }
+            if (exact && d == 1) {
+                numerator = n;
+                return *this;
+            }
+            if (exact) {
+                const int64_t g = std::gcd(n, d);
+                numerator = g > 1 ? n / g : n;
+                denominator = g > 1 ? d / g : d;
+                return *this;
+            }
+        }
+        real_value = to_double() + rhs.to_double();
+        is_real = true;
+        return *this;
+    }
+
+    sparse_polynomial::coefficient
+    sparse_polynomial::coefficient::operator*(const coefficient &rhs) const {
+        coefficient r;
+        if (!is_real && !rhs.is_real) {
+            int64_t n;
+            int64_t d;
+            if (checked_mul(numerator, rhs.numerator, n) &&
+                checked_mul(denominator, rhs.denominator, d)) {
+                if (d == 1) {
+                    r.numerator = n;
+                    return r;
+                }
+                const int64_t g = std::gcd(n, d);
+                r.numerator = g > 1 ? n / g : n;
+                r.denominator = g > 1 ? d / g : d;
+                return r;
+            }
+        }
+        r.is_real = true;
+        r.real_value = to_double() * rhs.to_double();
+        return r;
+    }
+
+    std::optional<sym> sparse_polynomial::expand(const sym &s) {
+        const bool polynomial_kind = s.kind() == node_kind::summation ||
+                                     s.kind() == node_kind::product ||
+                                     s.kind() == node_kind::pow;
+        if (!polynomial_kind || is_atom(s)) {
+            return std::nullopt;
+        }
+        ring r;
+        if (!find_generators(s, r, true, true)) {
+            return std::nullopt;
+        }
+        r.words = (r.generators.size() + exponents_per_word - 1) /
+                  exponents_per_word;
+        std::optional<sparse_polynomial> p = from_sym(s, r);
+        if (!p) {
+            return std::nullopt;
+        }
+        return p->to_sym();
+    }
+
+    std::optional<sym> sparse_polynomial::collect(const sym &s) {
+        if (s.kind() != node_kind::summation) {
+            return std::nullopt;
+        }
+        ring r;
+        if (!find_generators(s, r, false, true)) {
+            return std::nullopt;
+        }
+        r.words = (r.generators.size() + exponents_per_word - 1) /
+                  exponents_per_word;
+        std::optional<sparse_polynomial> p = from_sym(s, r);
+        if (!p) {
+            return std::nullopt;
+        }
+        return p->to_sym();
+    }
+
+    std::optional<sym> sparse_polynomial::nested(const sym &s, bool estrin) {
+        if (s.kind() != node_kind::summation) {
+            return std::nullopt;
+        }
+        // the terms that are not polynomials, such as sin(x), are
+        // kept as they are
+        ring r;
+        sym_builder polynomial(node_kind::summation);
+        sym_builder others(node_kind::summation);
+        for (const sym &t : s) {
+            if (find_generators(t, r, false, true)) {
+                polynomial.push_back(t);
+            } else {
+                others.push_back(t);
+            }
+        }
+        if (polynomial.size() < 2) {
+            return std::nullopt;
+        }
+        r.words = (r.generators.size() + exponents_per_word - 1) /
+                  exponents_per_word;
+        std::optional<sparse_polynomial> p = from_sym(polynomial.build(), r);
+        if (!p || p->size() < 2 || p->max_exponent() < 2) {
+            return std::nullopt;
+        }
+        std::vector<nested_term> terms(p->size());
+        for (size_t t = 0; t < p->size(); ++t) {
+            for (size_t g = 0; g < r.generators.size(); ++g) {
+                if (const unsigned k = p->exponent(t, g); k != 0) {
+                    terms[t].powers.emplace_back(g, k);
+                }
+            }
+            terms[t].c = p->coefficients_[t];
+        }
+        if (others.size() == 0) {
+            return nested(terms, r, estrin);
+        }
+        others.push_back(nested(terms, r, estrin));
+        return others.build();
+    }
+
+    sym sparse_polynomial::nested(std::vector<nested_term> &terms,
+                                  const ring &r, bool estrin) {
+        auto power = [&r](size_t g, size_t k) {
+            const sym &x = r.generators[g];
+            return k == 1 ? x : sym(pow(x, sym(static_cast<int>(k))));
+        };
+        // lo + x^k hi, where either part might be missing
+        auto combine = [&power](std::optional<sym> lo, std::optional<sym> hi,
+                                size_t g, size_t k) {
+            if (!hi) {
+                return lo;
+            }
+            sym_builder term(node_kind::product);
+            term.push_back(power(g, k));
+            if (!hi->is_number() || hi->compare(sym(1)) != 0) {
+                term.push_back(std::move(*hi));
+            }
+            if (!lo) {
+                return std::optional<sym>(term.build());
+            }
+            sym_builder sum(node_kind::summation);
+            sum.push_back(std::move(*lo));
+            sum.push_back(term.build());
+            return std::optional<sym>(sum.build());
+        };
+
+        sym_builder result(node_kind::summation);
+        std::vector<size_t> count(r.generators.size(), 0);
+        while (!terms.empty()) {
+            // factor out the generator in the most terms
+            for (const nested_term &t : terms) {
+                for (const auto &[g, k] : t.powers) {
+                    ++count[g];
+                }
+            }
+            size_t g = 0;
+            for (const nested_term &t : terms) {
+                for (const auto &[h, k] : t.powers) {
+                    if (count[h] > count[g] ||
+                        (count[h] == count[g] && h < g)) {
+                        g = h;
+                    }
+                }
+            }
+            const size_t best = count[g];
+            for (const nested_term &t : terms) {
+                for (const auto &[h, k] : t.powers) {
+                    count[h] = 0;
+                }
+            }
+            if (best < 2) {
+                // no generator is shared, so the terms are monomials
+                for (const nested_term &t : terms) {
+                    sym_builder m(node_kind::product);
+                    sym c = t.c.to_sym();
+                    if (!c.is_number() || c.compare(sym(1)) != 0 ||
+                        t.powers.empty()) {
+                        m.push_back(std::move(c));
+                    }
+                    for (const auto &[h, k] : t.powers) {
+                        m.push_back(power(h, k));
+                    }
+                    result.push_back(m.build());
+                }
+                break;
+            }
+
+            // coefficient of each power of the generator, where the
+            // terms without it are left for the next generators
+            std::vector<std::vector<nested_term>> groups;
+            std::vector<nested_term> rest;
+            for (nested_term &t : terms) {
+                auto it = std::find_if(
+                    t.powers.begin(), t.powers.end(),
+                    [g](const auto &p) { return p.first == g; });
+                if (it == t.powers.end()) {
+                    rest.emplace_back(std::move(t));
+                    continue;
+                }
+                const unsigned k = it->second;
+                t.powers.erase(it);
+                if (groups.size() <= k) {
+                    groups.resize(k + 1);
+                }
+                groups[k].emplace_back(std::move(t));
+            }
+            terms = std::move(rest);
+            std::vector<std::optional<sym>> a(groups.size());
+            for (size_t k = 0; k < groups.size(); ++k) {
+                if (!groups[k].empty()) {
+                    a[k] = nested(groups[k], r, estrin);
+                }
+            }
+
+            if (estrin) {
+                // combine pairs of coefficients with x, then pairs of
+                // pairs with x^2, x^4, and so on
+                size_t k = 1;
+                while (a.size() > 1) {
+                    std::vector<std::optional<sym>> next((a.size() + 1) / 2);
+                    for (size_t i = 0; i < next.size(); ++i) {
+                        next[i] = 2 * i + 1 < a.size()
+                                      ? combine(a[2 * i], a[2 * i + 1], g, k)
+                                      : a[2 * i];
+                    }
+                    a = std::move(next);
+                    k *= 2;
+                }
+                result.push_back(*a[0]);
+                continue;
+            }
+
+            // x^(k_1) (a_(k_1) + x^(k_2-k_1) (...))
+            std::optional<sym> nested_sum;
+            size_t previous = groups.size() - 1;
+            for (size_t k = groups.size(); k-- > 1;) {
+                if (!a[k]) {
+                    continue;
+                }
+                nested_sum = nested_sum ? combine(a[k], nested_sum, g,
+                                                  previous - k)
+                                        : a[k];
+                previous = k;
+            }
+            result.push_back(*combine(std::nullopt, nested_sum, g, previous));
+        }
+        return result.build();
+    }
+
+    sparse_polynomial::sparse_polynomial(const ring &r) : ring_(&r) {}
+
+    sparse_polynomial::sparse_polynomial(const ring &r, const coefficient &c)
+        : ring_(&r) {
+        if (!c.is_zero()) {
+            exponents_.resize(ring_->words, 0);
+            coefficients_.emplace_back(c);
+        }
+    }
+
+    sparse_polynomial::sparse_polynomial(const ring &r, size_t generator,
+                                         unsigned exponent)
+        : ring_(&r), max_exponent_(exponent) {
+        exponents_.resize(ring_->words, 0);
+        exponents_[generator / exponents_per_word] =
+            static_cast<uint64_t>(exponent)
+            << (exponent_bits * (generator % exponents_per_word));
+        coefficients_.emplace_back(coefficient::one());
+    }
+
+    size_t sparse_polynomial::size() const { return coefficients_.size(); }
+
+    unsigned sparse_polynomial::max_exponent() const { return max_exponent_; }
+
+    sparse_polynomial &
+    sparse_polynomial::operator+=(const sparse_polynomial &rhs) {
+        if (&rhs == this) {
+            const sparse_polynomial copy = rhs;
+            return *this += copy;
+        }
+        add(rhs);
+        compact();
+        return *this;
+    }
+
+    sparse_polynomial
+    sparse_polynomial::operator*(const sparse_polynomial &rhs) const {
+        const size_t words = ring_->words;
+        sparse_polynomial r(*ring_);
+        r.rehash(size() + rhs.size());
+        std::vector<uint64_t> e(words);
+        for (size_t i = 0; i < size(); ++i) {
+            // long products stop when a simplifier runs out of budget
+            simplifier::check_budget(rhs.size());
+            const uint64_t *a = exponents_.data() + i * words;
+            for (size_t j = 0; j < rhs.size(); ++j) {
+                const uint64_t *b = rhs.exponents_.data() + j * words;
+                // the exponents do not overflow, so there are no
+                // carries between the packed exponents
+                for (size_t w = 0; w < words; ++w) {
+                    e[w] = a[w] + b[w];
+                }
+                r.accumulate(e.data(), coefficients_[i] * rhs.coefficients_[j]);
+            }
+        }
+        r.compact();
+        return r;
+    }
+
+    sym sparse_polynomial::to_sym() const {
+        const size_t n_generators = ring_->generators.size();
+        sym_builder terms;
+        terms.reserve(size());
+        for (size_t i = 0; i < size(); ++i) {
+            sym_builder factors(node_kind::product);
+            const coefficient &c = coefficients_[i];
+            if (!c.is_one()) {
+                factors.push_back(c.to_sym());
+            }
+            for (size_t g = 0; g < n_generators; ++g) {
+                const unsigned e = exponent(i, g);
+                if (e == 1) {
+                    factors.push_back(ring_->generators[g]);
+                } else if (e != 0) {
+                    factors.push_back(sym(pow(ring_->generators[g],
+                                              sym(static_cast<int>(e)))));
+                }
+            }
+            terms.push_back(factors.build());
+        }
+        return terms.build();
+    }
+
+    bool sparse_polynomial::find_generators(const sym &s, ring &r,
+                                            bool expand, bool allow_sum) {
+        if (s.is_number()) {
+            return true;
+        }
+        if (!is_atom(s)) {
+            if (s.kind() == node_kind::summation) {
+                if (!allow_sum) {
+                    return false;
+                }
+                return std::all_of(s.begin(), s.end(), [&](const sym &t) {
+                    return find_generators(t, r, expand, true);
+                });
+            }
+            if (s.kind() == node_kind::product) {
+                return std::all_of(s.begin(), s.end(), [&](const sym &f) {
+                    return find_generators(f, r, expand, expand);
+                });
+            }
+            // integer power
+            const sym &base = *s.begin();
+            const int n = exponent_of(s);
+            if (static_cast<unsigned>(std::abs(n)) > exponent_limit) {
+                return false;
+            }
+            if (base.is_number()) {
+                return n >= 0 || !base.is_zero();
+            }
+            return find_generators(base, r, expand, expand);
+        }
+        if (r.atoms.count(s) != 0) {
+            return true;
+        }
+        // powers commute if their bases commute
+        const sym &base = s.is<pow>() ? *s.begin() : s;
+        if (!base.is_commutative()) {
+            return false;
+        }
+        sym generator = s;
+        if (expand) {
+            generator.expand();
+        }
+        auto [it, inserted] =
+            r.index.try_emplace(generator, r.generators.size());
+        if (inserted) {
+            r.generators.emplace_back(std::move(generator));
+        }
+        r.atoms.emplace(s, it->second);
+        return true;
+    }
+
+    std::optional<sparse_polynomial>
+    sparse_polynomial::from_sym(const sym &s, const ring &r) {
+        // most terms are monomials, which need no polynomial products
+        std::vector<uint64_t> e(r.words, 0);
+        coefficient c = coefficient::one();
+        if (monomial(s, r, e.data(), c)) {
+            sparse_polynomial result(r);
+            result.accumulate(e.data(), c);
+            result.compact();
+            return result;
+        }
+        if (s.kind() == node_kind::summation) {
+            // compact the terms only once
+            sparse_polynomial result(r);
+            for (const auto &t : s) {
+                std::fill(e.begin(), e.end(), 0);
+                c = coefficient::one();
+                if (monomial(t, r, e.data(), c)) {
+                    result.accumulate(e.data(), c);
+                    continue;
+                }
+                std::optional<sparse_polynomial> p = from_sym(t, r);
+                if (!p) {
+                    return std::nullopt;
+                }
+                result.add(*p);
+            }
+            result.compact();
+            return result;
+        }
+        if (s.kind() == node_kind::product) {
+            sparse_polynomial result(r, coefficient::one());
+            for (const auto &f : s) {
+                std::optional<sparse_polynomial> p = from_sym(f, r);
+                if (!p) {
+                    return std::nullopt;
+                }
+                if (result.max_exponent_ + p->max_exponent_ > exponent_limit) {
+                    return std::nullopt;
+                }
+                result = result * *p;
+            }
+            return result;
+        }
+        if (s.kind() != node_kind::pow) {
+            return std::nullopt;
+        }
+        // integer power of a polynomial
+        const sym &base = *s.begin();
+        const auto n = static_cast<unsigned>(exponent_of(s));
+        std::optional<sparse_polynomial> p = from_sym(base, r);
+        if (!p) {
+            return std::nullopt;
+        }
+        if (static_cast<uint64_t>(p->max_exponent_) * n > exponent_limit) {
+            return std::nullopt;
+        }
+        // multiply by the base, which is usually much smaller than
+        // the partial result
+        sparse_polynomial result(r, coefficient::one());
+        for (unsigned i = 0; i < n; ++i) {
+            result = result * *p;
+        }
+        return result;
+    }
+
+    bool sparse_polynomial::monomial(const sym &s, const ring &r, uint64_t *e,
+                                     coefficient &c) {
+        if (s.is_number()) {
+            c = c * coefficient::from_number(s);
+            return true;
+        }
+        if (is_atom(s)) {
+            return multiply_generator(e, r.atoms.at(s), 1);
+        }
+        if (s.kind() == node_kind::product) {
+            return std::all_of(s.begin(), s.end(), [&](const sym &f) {
+                return monomial(f, r, e, c);
+            });
+        }
+        if (s.kind() != node_kind::pow) {
+            return false;
+        }
+        const sym &base = *s.begin();
+        const int n = exponent_of(s);
+        if (base.is_number()) {
+            c = c * coefficient::from_number(base).power(n);
+            return true;
+        }
+        if (!is_atom(base)) {
+            return false;
+        }
+        return multiply_generator(e, r.atoms.at(base),
+                                  static_cast<unsigned>(n));
+    }
+
+    bool sparse_polynomial::multiply_generator(uint64_t *e, size_t generator,
+                                               unsigned exponent) {
+        const size_t w = generator / exponents_per_word;
+        const unsigned shift =
+            exponent_bits * static_cast<unsigned>(generator % exponents_per_word);
+        const auto current =
+            static_cast<unsigned>((e[w] >> shift) & exponent_limit);
+        if (current + exponent > exponent_limit) {
+            return false;
+        }
+        e[w] += static_cast<uint64_t>(exponent) << shift;
+        return true;
+    }
+
+    int sparse_polynomial::exponent_of(const sym &s) {
+        return static_cast<int>(
+            *std::prev(s.end())->node_as<number_interface>());
+    }
+
+    bool sparse_polynomial::is_atom(const sym &s) {
+        switch (s.kind()) {
+        case node_kind::summation:
+        case node_kind::product:
+            return false;
+        case node_kind::pow: {
+            const sym &base = *s.begin();
+            const sym &n = *std::prev(s.end());
+            if (n.kind() != node_kind::integer) {
+                return true;
+            }
+            // negative powers of non-numbers are generators
+            return !base.is_number() && exponent_of(s) < 0;
+        }
+        default:
+            return !s.is_number();
+        }
+    }
+
+    unsigned sparse_polynomial::exponent(size_t term, size_t generator) const {
+        const uint64_t w =
+            exponents_[term * ring_->words + generator / exponents_per_word];
+        return static_cast<unsigned>(
+            (w >> (exponent_bits * (generator % exponents_per_word))) &
+            exponent_limit);
+    }
+
+    void sparse_polynomial::add(const sparse_polynomial &rhs) {
+        const size_t words = ring_->words;
+        rehash(size() + rhs.size());
+        for (size_t i = 0; i < rhs.size(); ++i) {
+            accumulate(rhs.exponents_.data() + i * words,
+                       rhs.coefficients_[i]);
+        }
+    }
+
+    void sparse_polynomial::accumulate(const uint64_t *e,
+                                       const coefficient &c) {
+        if (table_.size() < 2 * (size() + 1)) {
+            rehash(2 * size() + 2);
+        }
+        const size_t words = ring_->words;
+        const size_t mask = table_.size() - 1;
+        size_t i = hash_exponents(e, words) & mask;
+        while (table_[i] != 0) {
+            const size_t term = table_[i] - 1;
+            if (std::equal(e, e + words,
+                           exponents_.begin() +
+                               static_cast<std::ptrdiff_t>(term * words))) {
+                coefficients_[term] += c;
+                return;
+            }
+            i = (i + 1) & mask;
+        }
+        exponents_.insert(exponents_.end(), e, e + words);
+        coefficients_.emplace_back(c);
+        table_[i] = static_cast<uint32_t>(coefficients_.size());
+    }
+
+    void sparse_polynomial::rehash(size_t n) {
+        size_t capacity = 16;
+        while (capacity < 2 * n) {
+            capacity *= 2;
+        }
+        if (capacity <= table_.size()) {
+            return;
+        }
+        table_.assign(capacity, 0);
+        const size_t words = ring_->words;
+        const size_t mask = capacity - 1;
+        for (size_t term = 0; term < size(); ++term) {
+            size_t i = hash_exponents(exponents_.data() + term * words,
+                                      words) &
+                       mask;
+            while (table_[i] != 0) {
+                i = (i + 1) & mask;
+            }
+            table_[i] = static_cast<uint32_t>(term + 1);
+        }
+    }
+
+    void sparse_polynomial::compact() {
+        const size_t words = ring_->words;
+        const size_t n_generators = ring_->generators.size();
+        size_t kept = 0;
+        max_exponent_ = 0;
+        for (size_t term = 0; term < size(); ++term) {
+            if (coefficients_[term].is_zero()) {
+                continue;
+            }
+            if (kept != term) {
+                std::copy_n(exponents_.begin() +
+                                static_cast<std::ptrdiff_t>(term * words),
+                            words,
+                            exponents_.begin() +
+                                static_cast<std::ptrdiff_t>(kept * words));
+                coefficients_[kept] = coefficients_[term];
+            }
+            for (size_t g = 0; g < n_generators; ++g) {
+                max_exponent_ = std::max(max_exponent_, exponent(kept, g));
+            }
+            ++kept;
+        }
+        exponents_.resize(kept * words);
+        coefficients_.resize(kept);
+        std::vector<uint32_t>().swap(table_);
+    }
+
+    uint64_t sparse_polynomial::hash_exponents(const uint64_t *e,
+                                               size_t words) {
+        uint64_t h = 0x9e3779b97f4a7c15ULL;
+        for (size_t w = 0; w < words; ++w) {
+            h ^= e[w] + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+        }
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    bool sparse_polynomial::checked_add(int64_t a, int64_t b, int64_t &r) {
+        constexpr int64_t max = std::numeric_limits<int64_t>::max();
+        constexpr int64_t min = std::numeric_limits<int64_t>::min();
+        if ((b > 0 && a > max - b) || (b < 0 && a < min - b)) {
+            return false;
+        }
+        r = a + b;
+        return true;
+    }
+
+    bool sparse_polynomial::checked_mul(int64_t a, int64_t b, int64_t &r) {
+        constexpr int64_t max = std::numeric_limits<int64_t>::max();
+        if (a == 0 || b == 0) {
+            r = 0;
+            return true;
+        }
+        // keep away from int64 min so the absolute values are valid
+        if (a < -max || b < -max) {
+            return false;
+        }
+        if (std::abs(a) > max / std::abs(b)) {
+            return false;
+        }
+        r = a * b;
+        return true;
+    }
+
+} // namespace sympp
@@ -0,0 +1,209 @@
+// sparse_polynomial.h
+
+#ifndef SYMPP_SPARSE_POLYNOMIAL_H
+#define SYMPP_SPARSE_POLYNOMIAL_H
+
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Internal
+#include <sympp/core/sym.h>
+
+namespace sympp {
+    /// \class Sparse multivariate polynomial
+    /// Internal kernel for expanding and collecting polynomials.
+    /// The generators of the polynomial are the subexpressions that are
+    /// not numbers, sums, products or integer powers, such as variables
+    /// or functions. Each term is an exponent vector packed with 16 bits
+    /// per generator and a numeric coefficient, so multiplying two
+    /// monomials is a word-wise addition. Sums and products accumulate
+    /// their terms in a hash table, so no intermediate trees are created.
+    class sparse_polynomial {
+      public:
+        /// Numeric coefficient of a term
+        /// Coefficients are exact rationals while they fit in 64 bits.
+        /// They become doubles when they overflow or meet a real number.
+        struct coefficient {
+            int64_t numerator{0};
+            int64_t denominator{1};
+            bool is_real{false};
+            double real_value{0.0};
+
+            /// Coefficient of a number node
+            static coefficient from_number(const sym &);
+
+            /// The coefficient 1
+            static coefficient one();
+
+            /// Integer power of this coefficient
+            [[nodiscard]] coefficient power(int) const;
+
+            [[nodiscard]] bool is_zero() const;
+
+            [[nodiscard]] bool is_one() const;
+
+            [[nodiscard]] double to_double() const;
+
+            /// Number node with the value of this coefficient
+            [[nodiscard]] sym to_sym() const;
+
+            coefficient &operator+=(const coefficient &);
+
+            coefficient operator*(const coefficient &) const;
+        };
+
+        /// Generators shared by the polynomials of one expression
+        struct ring {
+            /// Generators in the order we found them
+            std::vector<sym> generators;
+
+            /// Index of each generator
+            std::unordered_map<sym, size_t> index;
+
+            /// Generator of each atom in the original expression
+            /// When expanding, the generator is the expanded atom.
+            std::unordered_map<sym, size_t> atoms;
+
+            /// 64-bit words in an exponent vector
+            size_t words{0};
+        };
+
+      public /* kernel */:
+        /// Expand a sum, product or power into a canonical sum
+        /// Returns nullopt if the kernel cannot represent the expression,
+        /// because it has non-commutative factors or exponents that do
+        /// not fit in 16 bits.
+        static std::optional<sym> expand(const sym &);
+
+        /// Collect the like terms and powers of a sum of monomials
+        /// Returns nullopt if some term is not a monomial.
+        static std::optional<sym> collect(const sym &);
+
+        /// Rewrite a sum of monomials in Horner form
+        /// The generator in the most terms is factored out of them
+        /// and its coefficients are rewritten in the same form, until
+        /// no generator is in more than one term, so
+        /// 3x^3+2x^2+1 becomes 1+x^2(2+3x). With estrin, the powers of
+        /// the outer generator are grouped in pairs instead, as in
+        /// (1+0x)+x^2(2+3x), so the pairs can be evaluated in parallel.
+        /// Returns nullopt if the expression is not a polynomial or if
+        /// no generator has a degree above 1.
+        static std::optional<sym> nested(const sym &, bool estrin);
+
+      public /* polynomial arithmetic */:
+        /// Zero polynomial
+        explicit sparse_polynomial(const ring &);
+
+        /// Constant polynomial
+        sparse_polynomial(const ring &, const coefficient &);
+
+        /// Generator raised to a power
+        sparse_polynomial(const ring &, size_t generator, unsigned exponent);
+
+        /// Number of terms
+        [[nodiscard]] size_t size() const;
+
+        /// Largest exponent of any generator
+        [[nodiscard]] unsigned max_exponent() const;
+
+        /// Add another polynomial in the same ring
+        sparse_polynomial &operator+=(const sparse_polynomial &);
+
+        /// Product of two polynomials in the same ring
+        /// The caller checks the exponents do not overflow.
+        sparse_polynomial operator*(const sparse_polynomial &) const;
+
+        /// Convert to a sum of monomials
+        [[nodiscard]] sym to_sym() const;
+
+      public /* checked arithmetic */:
+        /// a + b, or false if it overflows
+        static bool checked_add(int64_t a, int64_t b, int64_t &r);
+
+        /// a * b, or false if it overflows
+        static bool checked_mul(int64_t a, int64_t b, int64_t &r);
+
+      private:
+        /// Term of a polynomial with the generators it has
+        struct nested_term {
+            /// Generators and their exponents
+            std::vector<std::pair<size_t, unsigned>> powers;
+
+            /// Coefficient
+            coefficient c;
+        };
+
+        /// Nested form of a list of terms
+        static sym nested(std::vector<nested_term> &terms, const ring &,
+                          bool estrin);
+
+        /// Find the generators of an expression
+        /// Returns false if the expression is not a polynomial the
+        /// kernel can represent. Sums are only allowed inside products
+        /// and powers when we expand the expression.
+        static bool find_generators(const sym &, ring &, bool expand,
+                                    bool allow_sum);
+
+        /// Convert an expression whose generators are in the ring
+        static std::optional<sparse_polynomial> from_sym(const sym &,
+                                                         const ring &);
+
+        /// Multiply the monomial e, c by a monomial expression
+        /// Returns false if the expression is not a monomial or its
+        /// exponents overflow
+        static bool monomial(const sym &, const ring &, uint64_t *e,
+                             coefficient &c);
+
+        /// Multiply the monomial e by a generator raised to a power
+        /// Returns false if the exponent overflows
+        static bool multiply_generator(uint64_t *e, size_t generator,
+                                       unsigned exponent);
+
+        /// True if the kernel treats the expression as a generator
+        static bool is_atom(const sym &);
+
+        /// Integer exponent of a power
+        static int exponent_of(const sym &);
+
+        /// Exponent of a generator in a term
+        [[nodiscard]] unsigned exponent(size_t term, size_t generator) const;
+
+        /// Add the terms of another polynomial without compacting
+        void add(const sparse_polynomial &);
+
+        /// Add c * x^e to the terms through the hash table
+        void accumulate(const uint64_t *e, const coefficient &c);
+
+        /// Resize the hash table for n terms
+        void rehash(size_t n);
+
+        /// Remove the terms with a zero coefficient and the hash table
+        void compact();
+
+        /// Hash of an exponent vector
+        [[nodiscard]] static uint64_t hash_exponents(const uint64_t *e,
+                                                     size_t words);
+
+      private:
+        /// Generators of this polynomial
+        const ring *ring_;
+
+        /// Exponent vectors of the terms, ring_->words per term
+        std::vector<uint64_t> exponents_;
+
+        /// Coefficients of the terms
+        std::vector<coefficient> coefficients_;
+
+        /// Largest exponent of any generator
+        unsigned max_exponent_{0};
+
+        /// Open addressing table with term index + 1 while accumulating
+        std::vector<uint32_t> table_;
+    };
+} // namespace sympp
+
+#endif // SYMPP_SPARSE_POLYNOMIAL_H
@@ -1,17 +1,29 @@
 // C++
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <string_view>
 #include <typeinfo>
+#include <utility>
 
 // TinyCC
 #include <tcc/libtcc_ext.h>
 
 // Internal
+#include <sympp/core/arena.h>
+#include <sympp/core/bytecode.h>
+#include <sympp/core/cse.h>
 #include <sympp/core/node_interface.h>
+#include <sympp/core/rewrite_rule.h>
+#include <sympp/core/simplifier.h>
+#include <sympp/core/simplify_memo.h>
+#include <sympp/core/sparse_polynomial.h>
 #include <sympp/core/sym.h>
+#include <sympp/core/sym_builder.h>
 #include <sympp/core/sym_error.h>
+#include <sympp/core/tape.h>
+#include <sympp/core/unique_table.h>
 #include <sympp/node/function/abs.h>
 #include <sympp/node/function/cos.h>
 #include <sympp/node/function/cosh.h>
@@ -31,97 +43,361 @@
 
 namespace sympp {
 
+    namespace {
+        /// Number of times simplify replaces a root node before it
+        /// gives up on reaching a normal form
+        constexpr size_t max_simplify_replacements = 64;
+
+        /// A terminal of an expression that is not a number
+        /// \return nullptr if all terminals are numbers
+        const sym *key_terminal(const sym &s) {
+            if (s.is_terminal()) {
+                return s.is_number() ? nullptr : &s;
+            }
+            for (const sym &child : s) {
+                if (const sym *k = key_terminal(child)) {
+                    return k;
+                }
+            }
+            return nullptr;
+        }
+
+        /// True if a node of an expression compares equal to t
+        bool has_subtree(const sym &s, const sym &t) {
+            if (s.compare(t) == 0) {
+                return true;
+            }
+            return std::any_of(s.begin(), s.end(), [&t](const sym &child) {
+                return has_subtree(child, t);
+            });
+        }
+
+        /// Rewrite the polynomial subtrees of an expression bottom-up
+        /// \return True if we changed the expression
+        bool nest_polynomials(sym &s, bool estrin) {
+            if (s.is_terminal()) {
+                return false;
+            }
+            bool changed = false;
+            for (size_t i = 0; i < s.size(); ++i) {
+                // only detach the nodes we rewrite
+                sym child = std::as_const(s)[i];
+                if (nest_polynomials(child, estrin)) {
+                    s[i] = std::move(child);
+                    changed = true;
+                }
+            }
+            if (std::optional<sym> r = sparse_polynomial::nested(s, estrin)) {
+                s = std::move(*r);
+                return true;
+            }
+            return changed;
+        }
+
+        /// True if we fold a node whose children are all numbers
+        bool is_foldable(node_kind k) {
+            switch (k) {
+            case node_kind::summation:
+            case node_kind::product:
+            case node_kind::pow:
+            case node_kind::log:
+            case node_kind::sin:
+            case node_kind::cos:
+            case node_kind::sinh:
+            case node_kind::cosh:
+            case node_kind::abs:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        /// Replace s by its value if the value is finite
+        bool fold_value(sym &s) {
+            const double v = s.evaluate({}, {}, {});
+            if (!std::isfinite(v)) {
+                return false;
+            }
+            s = sym(v);
+            return true;
+        }
+
+        /// Fold the constant subtrees of an expression bottom-up
+        /// Constants are only folded with their parents, so e^x is
+        /// still lowered to exp.
+        /// \return True if the expression has a value after folding
+        bool fold_constants(sym &s, bool &changed) {
+            if (s.is_number()) {
+                return true;
+            }
+            if (s.kind() == node_kind::constant) {
+                // constants such as i have no real value
+                return s.node_as<constant>()->value().is_number() &&
+                       std::isfinite(s.evaluate({}, {}, {}));
+            }
+            if (s.is_terminal()) {
+                return false;
+            }
+            // work on copies of the children, so s is only detached
+            // once if any of them changes
+            std::vector<sym> children(std::as_const(s).begin(),
+                                      std::as_const(s).end());
+            std::vector<bool> folded(children.size());
+            std::vector<bool> modified(children.size());
+            size_t numbers = 0;
+            for (size_t i = 0; i < children.size(); ++i) {
+                bool child_changed = false;
+                folded[i] = fold_constants(children[i], child_changed);
+                modified[i] = child_changed;
+                numbers += folded[i] ? 1 : 0;
+            }
+            // only detach the nodes we fold
+            if (std::find(modified.begin(), modified.end(), true) !=
+                modified.end()) {
+                auto it = s.begin();
+                for (size_t i = 0; i < children.size(); ++i) {
+                    if (modified[i]) {
+                        it[i] = children[i];
+                    }
+                }
+                changed = true;
+            }
+            if (numbers == children.size() && is_foldable(s.kind()) &&
+                fold_value(s)) {
+                changed = true;
+                return true;
+            }
+            const bool is_sum = s.kind() == node_kind::summation;
+            if (numbers < 2 || (!is_sum && s.kind() != node_kind::product)) {
+                return false;
+            }
+            // sums and products keep one term with their numbers
+            double value = is_sum ? 0. : 1.;
+            sym_builder rest(s.kind());
+            for (size_t i = 0; i < children.size(); ++i) {
+                if (!folded[i]) {
+                    rest.push_back(std::move(children[i]));
+                } else if (is_sum) {
+                    value += children[i].evaluate({}, {}, {});
+                } else {
+                    value *= children[i].evaluate({}, {}, {});
+                }
+            }
+            if (!std::isfinite(value)) {
+                return false;
+            }
+            rest.push_back(sym(value));
+            s = rest.build();
+            changed = true;
+            return false;
+        }
+    } // namespace
+
     sym::sym() : sym(integer(0)) {}
 
-    sym::sym(const sym &s) : root_node_(s.root_node_->clone()) {}
+    sym::sym(const sym &s) {
+        if (s.is_inline()) {
+            copy_node(*s.root_node_);
+        } else {
+            root_node_ = s.root_node_;
+        }
+    }
 
-    sym::sym(sym &&s) noexcept : root_node_(std::move(s.root_node_)) {}
+    sym::sym(sym &&s) noexcept {
+        if (s.is_inline()) {
+            copy_node(*s.root_node_);
+        } else {
+            root_node_ = std::move(s.root_node_);
+        }
+    }
 
-    sym::sym(const node_interface &s) : root_node_(s.clone()) {}
+    sym::sym(const node_interface &s) { copy_node(s); }
 
-    sym::sym(boolean &&s) : root_node_(new boolean(std::move(s))) {}
+    sym::sym(boolean &&s) { emplace_node<boolean>(std::move(s)); }
 
-    sym::sym(integer &&s) : root_node_(new integer(std::move(s))) {}
+    sym::sym(integer &&s) { emplace_node<integer>(std::move(s)); }
 
-    sym::sym(real &&s) : root_node_(new real(std::move(s))) {}
+    sym::sym(real &&s) { emplace_node<real>(std::move(s)); }
 
-    sym::sym(rational &&s) : root_node_(new rational(std::move(s))) {}
+    sym::sym(rational &&s) { emplace_node<rational>(std::move(s)); }
 
-    sym::sym(variable &&s) : root_node_(new variable(std::move(s))) {}
+    sym::sym(variable &&s) { emplace_node<variable>(std::move(s)); }
 
-    sym::sym(constant &&s) : root_node_(new constant(std::move(s))) {}
+    sym::sym(constant &&s) { emplace_node<constant>(std::move(s)); }
 
-    sym::sym(summation &&s) : root_node_(new summation(std::move(s))) {}
+    sym::sym(summation &&s) { emplace_node<summation>(std::move(s)); }
 
-    sym::sym(product &&s) : root_node_(new product(std::move(s))) {}
+    sym::sym(product &&s) { emplace_node<product>(std::move(s)); }
 
-    sym::sym(abs &&s) : root_node_(new abs(std::move(s))) {}
+    sym::sym(abs &&s) { emplace_node<abs>(std::move(s)); }
 
-    sym::sym(cos &&s) : root_node_(new cos(std::move(s))) {}
+    sym::sym(cos &&s) { emplace_node<cos>(std::move(s)); }
 
-    sym::sym(cosh &&s) : root_node_(new cosh(std::move(s))) {}
+    sym::sym(cosh &&s) { emplace_node<cosh>(std::move(s)); }
 
-    sym::sym(log &&s) : root_node_(new log(std::move(s))) {}
+    sym::sym(log &&s) { emplace_node<log>(std::move(s)); }
 
-    sym::sym(pow &&s) : root_node_(new pow(std::move(s))) {}
+    sym::sym(pow &&s) { emplace_node<pow>(std::move(s)); }
 
-    sym::sym(sin &&s) : root_node_(new sin(std::move(s))) {}
+    sym::sym(sin &&s) { emplace_node<sin>(std::move(s)); }
 
-    sym::sym(sinh &&s) : root_node_(new sinh(std::move(s))) {}
+    sym::sym(sinh &&s) { emplace_node<sinh>(std::move(s)); }
 
-    sym::sym(statement &&s) : root_node_(new statement(std::move(s))) {}
+    sym::sym(statement &&s) { emplace_node<statement>(std::move(s)); }
 
-    sym::sym(bool b) : root_node_(new boolean(b)) {}
+    sym::sym(bool b) { emplace_node<boolean>(b); }
 
-    sym::sym(int i) : root_node_(new integer(i)) {}
+    sym::sym(int i) { emplace_node<integer>(i); }
 
-    sym::sym(double d) : root_node_(new real(d)) {}
+    sym::sym(double d) { emplace_node<real>(d); }
 
-    sym::sym(std::string_view s, const number_interface &v)
-        : root_node_(new constant(s, sym(v))) {}
-    sym::sym(std::string_view s, bool v) : root_node_(new constant(s, v)) {}
-    sym::sym(std::string_view s, int v) : root_node_(new constant(s, v)) {}
-    sym::sym(std::string_view s, double v) : root_node_(new constant(s, v)) {}
-    sym::sym(std::string_view s, const sym &v)
-        : root_node_(new constant(s, v)) {}
+    sym::sym(std::string_view s, const number_interface &v) {
+        emplace_node<constant>(s, sym(v));
+    }
+    sym::sym(std::string_view s, bool v) { emplace_node<constant>(s, v); }
+    sym::sym(std::string_view s, int v) { emplace_node<constant>(s, v); }
+    sym::sym(std::string_view s, double v) { emplace_node<constant>(s, v); }
+    sym::sym(std::string_view s, const sym &v) { emplace_node<constant>(s, v); }
 
-    sym::sym(std::string_view s)
-        : root_node_(new variable(s, numeric_type::var_real)) {}
+    sym::sym(std::string_view s) {
+        emplace_node<variable>(s, numeric_type::var_real);
+    }
 
-    sym::sym(std::string_view s, numeric_type n)
-        : root_node_(new variable(s, n)) {}
+    sym::sym(std::string_view s, numeric_type n) {
+        emplace_node<variable>(s, n);
+    }
 
-    sym::sym(numeric_type n, std::string_view s)
-        : root_node_(new variable(n, s)) {}
+    sym::sym(numeric_type n, std::string_view s) {
+        emplace_node<variable>(n, s);
+    }
 
-    sym::~sym() = default;
+    sym::~sym() { destroy_inline_node(); }
 
     sym &sym::simplify() {
-        this->root_node_->simplify();
-        return *this;
+        return simplify_root([](node_interface &n) { return n.simplify(); },
+                             true);
     }
 
     sym &sym::simplify(double ratio) {
-        this->root_node_->simplify(ratio);
-        return *this;
+        const bool default_options = ratio == node_interface::default_ratio;
+        if (!default_options && !simplifier::running()) {
+            *this = simplifier(ratio)(*this);
+            return *this;
+        }
+        return simplify_root(
+            [ratio](node_interface &n) { return n.simplify(ratio); },
+            default_options);
     }
 
     sym &sym::simplify(double ratio, complexity_lambda func) {
-        this->root_node_->simplify(ratio, func);
+        const bool default_options =
+            node_interface::is_default_simplify(ratio, func);
+        // The node rewrites never make the expression more complex, so
+        // the ratio and the measure only matter for the driver, which
+        // also tries the rewrites that might. Inside the driver, this
+        // is the normal form its passes (and the nodes simplifying
+        // their children) are built on.
+        if (!default_options && !simplifier::running()) {
+            *this = simplifier(ratio, std::move(func))(*this);
+            return *this;
+        }
+        return simplify_root(
+            [ratio, &func](node_interface &n) {
+                return n.simplify(ratio, func);
+            },
+            default_options);
+    }
+
+    sym &sym::simplify(const execution::parallel_policy &) {
+        if (parallel_scope::current()) {
+            return simplify();
+        }
+        parallel_scope scope;
+        return simplify();
+    }
+
+    sym &sym::simplify_root(
+        const std::function<std::optional<sym>(node_interface &)> &f,
+        bool default_options) {
+        // Nodes in normal form are not simplified again
+        if (default_options && root_node_->is_simplified()) {
+            return *this;
+        }
+        simplify_memo *memo =
+            root_node_->is_terminal() ? nullptr : simplify_memo::current();
+        std::optional<sym> original;
+        if (memo) {
+            if (std::optional<sym> r = memo->find(*this); r) {
+                *this = std::move(*r);
+                return *this;
+            }
+            original = *this;
+        }
+        // The replacement might not be in normal form yet, so we
+        // simplify it again, up to a fixed number of replacements
+        for (size_t i = 0; i < max_simplify_replacements; ++i) {
+            detach();
+            std::optional<sym> r = f(*root_node_);
+            if (!r) {
+                if (default_options) {
+                    root_node_->mark_simplified();
+                }
+                break;
+            }
+            *this = std::move(*r);
+            if (default_options && root_node_->is_simplified()) {
+                break;
+            }
+        }
+        if (memo) {
+            memo->insert(*original, *this);
+        }
         return *this;
     }
 
     /// Put polynomial into a canonical form of a sum of monomials
     sym &sym::expand() {
-        std::optional<sym> r = this->root_node_->expand();
+        // Polynomials are expanded without rewriting the tree
+        // The kernel does not modify the tree, so there is no need to
+        // detach it first
+        std::optional<sym> p = sparse_polynomial::expand(*this);
+        if (p) {
+            *this = std::move(*p);
+            return *this;
+        }
+        if (!is_shared()) {
+            detach();
+            std::optional<sym> r = this->root_node_->expand();
+            if (r) {
+                *this = std::move(*r);
+            }
+            return *this;
+        }
+        // Expand a copy and keep it only if something changed, so the
+        // subtrees expand leaves alone stay shared
+        sym e = *this;
+        e.detach();
+        std::optional<sym> r = e.root_node_->expand();
         if (r) {
-            *this = std::move(*r);
+            e = std::move(*r);
+        }
+        if (!unique_table::identical(*e.root_node_, *root_node_)) {
+            *this = std::move(e);
         }
         return *this;
     }
 
+    sym &sym::expand(const execution::parallel_policy &) {
+        if (parallel_scope::current()) {
+            return expand();
+        }
+        parallel_scope scope;
+        return expand();
+    }
+
     /// Takes a polynomial and factors it into irreducible factors
     sym &sym::factor() {
+        detach();
         std::optional<sym> r = this->root_node_->factor();
         if (r) {
             *this = std::move(*r);
@@ -131,6 +407,15 @@ namespace sympp {
 
     /// Collects common powers of a term in an expression
     sym &sym::collect() {
+        // Sums of monomials are collected without rewriting the tree
+        // The kernel does not modify the tree, so there is no need to
+        // detach it first
+        std::optional<sym> p = sparse_polynomial::collect(*this);
+        if (p) {
+            *this = std::move(*p);
+            return *this;
+        }
+        detach();
         std::optional<sym> r = this->root_node_->collect();
         if (r) {
             *this = std::move(*r);
@@ -141,6 +426,7 @@ namespace sympp {
     /// Take any rational function and put it into the standard canonical
     /// form
     sym &sym::cancel() {
+        detach();
         std::optional<sym> r = this->root_node_->cancel();
         if (r) {
             *this = std::move(*r);
@@ -150,6 +436,7 @@ namespace sympp {
 
     /// Performs a partial fraction decomposition on a rational function
     sym &sym::appart() {
+        detach();
         std::optional<sym> r = this->root_node_->appart();
         if (r) {
             *this = std::move(*r);
@@ -159,16 +446,19 @@ namespace sympp {
 
     /// Simplify expressions using trigonometric identities
     sym &sym::trigsimp() {
+        detach();
         std::optional<sym> r = this->root_node_->trigsimp();
         if (r) {
             *this = std::move(*r);
         }
+        rule_set::trigsimp().rewrite(*this);
         return *this;
     }
 
     /// Expand trigonometric functions, that is, apply the sum or double
     /// angle identities
     sym &sym::expand_trig() {
+        detach();
         std::optional<sym> r = this->root_node_->expand_trig();
         if (r) {
             *this = std::move(*r);
@@ -180,15 +470,18 @@ namespace sympp {
     /// right Identity x^ay^a=(xy)^a is true if at least x and y are
     /// non-negative and a is real.
     sym &sym::powsimp() {
+        detach();
         std::optional<sym> r = this->root_node_->powsimp();
         if (r) {
             *this = std::move(*r);
         }
+        rule_set::powsimp().rewrite(*this);
         return *this;
     }
 
     /// Applies identity x^ax^b=x^{a+b} from right to left
     sym &sym::expand_power_exp() {
+        detach();
         std::optional<sym> r = this->root_node_->expand_power_exp();
         if (r) {
             *this = std::move(*r);
@@ -200,6 +493,7 @@ namespace sympp {
     /// Identity x^ay^a=(xy)^a is true if at least x and y are non-negative
     /// and a is real.
     sym &sym::expand_power_base() {
+        detach();
         std::optional<sym> r = this->root_node_->expand_power_base();
         if (r) {
             *this = std::move(*r);
@@ -210,6 +504,7 @@ namespace sympp {
     /// Applies identity x^a^b=x^{ab} from left to right
     /// Identity x^a^b=x^{ab} is true if b is an integer
     sym &sym::powdenest() {
+        detach();
         std::optional<sym> r = this->root_node_->powdenest();
         if (r) {
             *this = std::move(*r);
@@ -220,6 +515,7 @@ namespace sympp {
     /// Apply identities log(xy)=log(x)+log(y) and log(x^n)=nlog(x) from
     /// left to right Only if x and y are positive and n is real.
     sym &sym::expand_log() {
+        detach();
         std::optional<sym> r = this->root_node_->expand_log();
         if (r) {
             *this = std::move(*r);
@@ -230,10 +526,30 @@ namespace sympp {
     /// Apply identities log(xy)=log(x)+log(y) and log(x^n)=nlog(x) from
     /// right to left Only if x and y are positive and n is real.
     sym &sym::logcombine() {
+        detach();
         std::optional<sym> r = this->root_node_->logcombine();
         if (r) {
             *this = std::move(*r);
         }
+        rule_set::logcombine().rewrite(*this);
+        return *this;
+    }
+
+    sym &sym::horner() {
+        nest_polynomials(*this, false);
+        return *this;
+    }
+
+    sym &sym::estrin() {
+        nest_polynomials(*this, true);
+        return *this;
+    }
+
+    sym &sym::fold_constants() {
+        bool changed = false;
+        if (sympp::fold_constants(*this, changed) && !is_number()) {
+            fold_value(*this);
+        }
         return *this;
     }
 
@@ -242,6 +558,13 @@ namespace sympp {
     }
 
     sym &sym::subs(const sym &x, const sym &y) {
+        // Every match of x contains its terminals, so we only detach
+        // the nodes that have one of them
+        if (const sym *k = key_terminal(x);
+            k && !has_subtree(std::as_const(*this), *k)) {
+            return *this;
+        }
+        detach();
         std::optional<sym> r = this->root_node_->subs(x, y);
         if (r) {
             *this = std::move(*r);
@@ -272,10 +595,17 @@ namespace sympp {
     }
 
     int sym::compare(const sym &s) const {
-        return this->compare(*s.root_node());
+        // shared (and hash-consed) nodes are equal
+        if (this->root_node_ == s.root_node_) {
+            return 0;
+        }
+        return this->root_node_->compare(*s.root_node_);
     }
 
     int sym::compare(const node_interface &s) const {
+        if (this->root_node_.get() == &s) {
+            return 0;
+        }
         return this->root_node_->compare(s);
     }
 
@@ -302,7 +632,7 @@ namespace sympp {
 
     size_t sym::count_ops() const { return this->root_node_->count_ops(); }
 
-    function_type sym::calculate_function_type() {
+    function_type sym::calculate_function_type() const {
         if (is_number() || is_variable() || is_constant()) {
             return function_type::linear;
         }
@@ -350,9 +680,15 @@ namespace sympp {
         return function_type::unknown;
     }
 
-    std::vector<sym>::iterator sym::begin() { return root_node_->begin(); }
+    std::vector<sym>::iterator sym::begin() {
+        detach();
+        return root_node_->begin();
+    }
 
-    std::vector<sym>::iterator sym::end() { return root_node_->end(); }
+    std::vector<sym>::iterator sym::end() {
+        detach();
+        return root_node_->end();
+    }
 
     std::vector<sym>::const_iterator sym::begin() const {
         return root_node_->begin();
@@ -366,9 +702,17 @@ namespace sympp {
         std::unordered_map<int, sym> bool_symbols_vars;
         std::unordered_map<int, sym> int_symbols_vars;
         std::unordered_map<int, sym> real_symbols_vars;
-        std::unordered_map<std::string, int> bool_symbols_names;
-        std::unordered_map<std::string, int> int_symbols_names;
-        std::unordered_map<std::string, int> real_symbols_names;
+        std::unordered_map<symbol_id, int> bool_symbols_names;
+        std::unordered_map<symbol_id, int> int_symbols_names;
+        std::unordered_map<symbol_id, int> real_symbols_names;
+        // Only detach the nodes whose indexes change
+        if (!node_interface::indexes_changed(
+                std::as_const(*this), bool_symbols_vars, int_symbols_vars,
+                real_symbols_vars, bool_symbols_names, int_symbols_names,
+                real_symbols_names)) {
+            return;
+        }
+        detach();
         this->root_node_->put_indexes(bool_symbols_vars, int_symbols_vars,
                                       real_symbols_vars, bool_symbols_names,
                                       int_symbols_names, real_symbols_names);
@@ -388,9 +732,51 @@ namespace sympp {
                                               double_values);
     }
 
-    node_lambda sym::lambdify() const { return this->root_node_->lambdify(); }
+    void sym::evaluate_batch(size_t n,
+                             const std::vector<const uint8_t *> &bool_columns,
+                             const std::vector<const int *> &int_columns,
+                             const std::vector<const double *> &double_columns,
+                             double *out) const {
+        cse(*this).evaluate_batch(n, bool_columns, int_columns,
+                                  double_columns, out);
+    }
+
+    void sym::evaluate_batch(const execution::simd_policy &policy, size_t n,
+                             const std::vector<const uint8_t *> &bool_columns,
+                             const std::vector<const int *> &int_columns,
+                             const std::vector<const double *> &double_columns,
+                             double *out) const {
+        cse(*this).evaluate_batch(policy, n, bool_columns, int_columns,
+                                  double_columns, out);
+    }
+
+    node_lambda sym::lambdify() const {
+        // Repeated subexpressions are evaluated once
+        return cse(*this).lambdify();
+    }
+
+    batch_lambda sym::lambdify_batch() const {
+        return cse(*this).lambdify_batch();
+    }
+
+    batch_lambda
+    sym::lambdify_batch(const execution::simd_policy &policy) const {
+        return cse(*this).lambdify_batch(policy);
+    }
+
+    node_lambda sym::compile_bytecode() const {
+        return bytecode(*this).lambdify();
+    }
+
+    tape sym::to_tape() const { return tape(*this); }
+
+    sym sym::from_tape(const tape &t) { return t.to_sym(); }
 
     std::string sym::c_code() const {
+        // Repeated subexpressions are assigned to temporaries
+        if (std::optional<std::string> code = cse(*this).c_code(); code) {
+            return *code;
+        }
         std::string code;
         int sum_level = -1;
         int prod_level = -1;
@@ -457,176 +843,263 @@ namespace sympp {
     /// Function wrapper mycos for TinyCC
     double mycos(double a) { return std::cos(a); }
 
+    /// Function wrapper mysinh for TinyCC
+    double mysinh(double a) { return std::sinh(a); }
+
+    /// Function wrapper mycosh for TinyCC
+    double mycosh(double a) { return std::cosh(a); }
+
+    /// Function wrapper mylog for TinyCC
+    double mylog(double a) { return std::log(a); }
+
+    /// Function wrapper mysqrt for TinyCC
+    double mysqrt(double a) { return std::sqrt(a); }
+
+    /// Function wrapper myexp for TinyCC
+    double myexp(double a) { return std::exp(a); }
+
     /// Function wrapper mypow for TinyCC
     double mypow(double a, double b) { return std::pow(a, b); }
 
     /// Function wrapper add for TinyCC
     int add(int a, int b) { return a + b; }
 
-    node_lambda sym::compile() const {
-        std::string code = this->c_code();
+    namespace {
+        /// Compile C code with TinyCC
+        /// The state owns the compiled code, so the functions we get
+        /// from it are valid while the state is alive.
+        std::shared_ptr<TCCState> compile_c_code(const std::string &code) {
+            TCCState *s = atcc_new();
+            if (!s || tcc_get_error_func(s) != nullptr ||
+                tcc_get_error_opaque(s) != nullptr) {
+                throw std::runtime_error("Could not create tcc state");
+            }
+            std::shared_ptr<TCCState> state(s, tcc_delete);
 
-        TCCState *s = atcc_new();
-        if (!s || tcc_get_error_func(s) != nullptr ||
-            tcc_get_error_opaque(s) != nullptr) {
-            throw std::runtime_error("Could not create tcc state");
-        }
+            tcc_set_error_func(s, stderr, handle_error);
+            if (tcc_get_error_func(s) != handle_error &&
+                tcc_get_error_opaque(s) != stderr) {
+                throw std::runtime_error("Could not set tcc error function");
+            }
 
-        tcc_set_error_func(s, stderr, handle_error);
-        if (tcc_get_error_func(s) != handle_error &&
-            tcc_get_error_opaque(s) != stderr) {
-            throw std::runtime_error("Could not set tcc error function");
-        }
+            /* MUST BE CALLED before any compilation */
+            tcc_set_output_type(s, TCC_OUTPUT_MEMORY);
+            if (tcc_compile_string(s, code.c_str()) == -1) {
+                throw std::runtime_error("Could not compile C code string");
+            }
 
-        /* MUST BE CALLED before any compilation */
-        tcc_set_output_type(s, TCC_OUTPUT_MEMORY);
-        if (tcc_compile_string(s, code.c_str()) == -1) {
-            throw std::runtime_error("Could not compile C code string");
-        }
+            /* Add symbols that the compiled program can use. */
+            auto sin_pointer = &mysin;
+            void *sin_void = reinterpret_cast<void *&>(sin_pointer);
+            tcc_add_symbol(s, "sin", sin_void);
+
+            auto cos_pointer = &mycos;
+            void *cos_void = reinterpret_cast<void *&>(cos_pointer);
+            tcc_add_symbol(s, "cos", cos_void);
+
+            auto sinh_pointer = &mysinh;
+            void *sinh_void = reinterpret_cast<void *&>(sinh_pointer);
+            tcc_add_symbol(s, "sinh", sinh_void);
+
+            auto cosh_pointer = &mycosh;
+            void *cosh_void = reinterpret_cast<void *&>(cosh_pointer);
+            tcc_add_symbol(s, "cosh", cosh_void);
+
+            auto log_pointer = &mylog;
+            void *log_void = reinterpret_cast<void *&>(log_pointer);
+            tcc_add_symbol(s, "log", log_void);
 
-        /* Add symbols that the compiled program can use. */
-        auto sin_pointer = &mysin;
-        void *sin_void = reinterpret_cast<void *&>(sin_pointer);
-        tcc_add_symbol(s, "sin", sin_void);
+            auto sqrt_pointer = &mysqrt;
+            void *sqrt_void = reinterpret_cast<void *&>(sqrt_pointer);
+            tcc_add_symbol(s, "sqrt", sqrt_void);
 
-        auto cos_pointer = &mycos;
-        void *cos_void = reinterpret_cast<void *&>(cos_pointer);
-        tcc_add_symbol(s, "cos", cos_void);
+            auto exp_pointer = &myexp;
+            void *exp_void = reinterpret_cast<void *&>(exp_pointer);
+            tcc_add_symbol(s, "exp", exp_void);
 
-        auto pow_pointer = &mypow;
-        void *pow_void = reinterpret_cast<void *&>(pow_pointer);
-        tcc_add_symbol(s, "pow", pow_void);
+            auto pow_pointer = &mypow;
+            void *pow_void = reinterpret_cast<void *&>(pow_pointer);
+            tcc_add_symbol(s, "pow", pow_void);
 
-        auto abs_pointer = &myabs;
-        void *abs_void = reinterpret_cast<void *&>(abs_pointer);
-        tcc_add_symbol(s, "abs", abs_void);
+            auto abs_pointer = &myabs;
+            void *abs_void = reinterpret_cast<void *&>(abs_pointer);
+            tcc_add_symbol(s, "abs", abs_void);
 
-        /* relocate the code */
-        if (tcc_relocate(s, TCC_RELOCATE_AUTO) < 0) {
-            throw std::runtime_error("Could not relocate C code");
+            /* relocate the code */
+            if (tcc_relocate(s, TCC_RELOCATE_AUTO) < 0) {
+                throw std::runtime_error("Could not relocate C code");
+            }
+            return state;
         }
+    } // namespace
+
+    node_lambda sym::compile() const {
+        std::shared_ptr<TCCState> state = compile_c_code(this->c_code());
 
         /* get entry symbol */
         double (*func)(const uint8_t[], const int[], const double[]);
         func = reinterpret_cast<double (*)(const uint8_t *, const int *,
                                            const double *)>(
-            tcc_get_symbol(s, "evaluate"));
+            tcc_get_symbol(state.get(), "evaluate"));
 
         if (!func) {
             throw std::runtime_error(
                 "Could not get the evaluation symbol from C code");
         }
 
-        /* delete the state */
-        tcc_delete(s);
-        return [func](const std::vector<uint8_t> &bools,
-                      const std::vector<int> &ints,
-                      const std::vector<double> &doubles) -> double {
+        return [state, func](const std::vector<uint8_t> &bools,
+                             const std::vector<int> &ints,
+                             const std::vector<double> &doubles) -> double {
             return func(bools.data(), ints.data(), doubles.data());
         };
     }
 
+    batch_lambda sym::compile_batch() const {
+        const cse program(*this);
+        std::optional<std::string> code = program.c_batch_code();
+        if (!code) {
+            // user functions are evaluated by the interpreter
+            return program.lambdify_batch();
+        }
+        std::shared_ptr<TCCState> state = compile_c_code(*code);
+
+        /* get entry symbol */
+        void (*func)(unsigned long, const uint8_t *const[], const int *const[],
+                     const double *const[], double[]);
+        func = reinterpret_cast<void (*)(
+            unsigned long, const uint8_t *const *, const int *const *,
+            const double *const *, double *)>(
+            tcc_get_symbol(state.get(), "evaluate_batch"));
+
+        if (!func) {
+            throw std::runtime_error(
+                "Could not get the evaluation symbol from C code");
+        }
+
+        return [state, func](size_t n,
+                             const std::vector<const uint8_t *> &bool_columns,
+                             const std::vector<const int *> &int_columns,
+                             const std::vector<const double *> &double_columns,
+                             double *out) {
+            func(n, bool_columns.data(), int_columns.data(),
+                 double_columns.data(), out);
+        };
+    }
+
     sym &sym::operator=(const node_interface &s) {
-        root_node_.reset(s.clone());
+        copy_node(s);
         return *this;
     }
 
     sym &sym::operator=(boolean &&s) {
-        root_node_ = std::make_shared<boolean>((std::move(s)));
+        emplace_node<boolean>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(integer &&s) {
-        root_node_ = std::make_shared<integer>((std::move(s)));
+        emplace_node<integer>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(real &&s) {
-        root_node_ = std::make_shared<real>((std::move(s)));
+        emplace_node<real>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(rational &&s) {
-        root_node_ = std::make_shared<rational>((std::move(s)));
+        emplace_node<rational>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(variable &&s) {
-        root_node_ = std::make_shared<variable>((std::move(s)));
+        emplace_node<variable>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(constant &&s) {
-        root_node_ = std::make_shared<constant>((std::move(s)));
+        emplace_node<constant>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(summation &&s) {
-        root_node_ = std::make_shared<summation>((std::move(s)));
+        emplace_node<summation>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(product &&s) {
-        root_node_ = std::make_shared<product>((std::move(s)));
+        emplace_node<product>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(abs &&s) {
-        root_node_ = std::make_shared<abs>((std::move(s)));
+        emplace_node<abs>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(cos &&s) {
-        root_node_ = std::make_shared<cos>((std::move(s)));
+        emplace_node<cos>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(cosh &&s) {
-        root_node_ = std::make_shared<cosh>((std::move(s)));
+        emplace_node<cosh>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(log &&s) {
-        root_node_ = std::make_shared<log>((std::move(s)));
+        emplace_node<log>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(pow &&s) {
-        root_node_ = std::make_shared<pow>((std::move(s)));
+        emplace_node<pow>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(sin &&s) {
-        root_node_ = std::make_shared<sin>((std::move(s)));
+        emplace_node<sin>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(sinh &&s) {
-        root_node_ = std::make_shared<sinh>((std::move(s)));
+        emplace_node<sinh>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(statement &&s) {
-        root_node_ = std::make_shared<statement>((std::move(s)));
+        emplace_node<statement>(std::move(s));
         return *this;
     }
 
     sym &sym::operator=(const sym &s) {
         if (&s != this) {
-            root_node_.reset(s.root_node_->clone());
+            if (s.is_inline()) {
+                copy_node(*s.root_node_);
+            } else {
+                // s might be a child of the node we are releasing
+                std::shared_ptr<node_interface> n = s.root_node_;
+                destroy_inline_node();
+                root_node_ = std::move(n);
+            }
         }
         return *this;
     }
 
     sym &sym::operator=(sym &&s) noexcept {
         if (&s != this) {
-            root_node_ = std::move(s.root_node_);
+            if (s.is_inline()) {
+                copy_node(*s.root_node_);
+            } else {
+                std::shared_ptr<node_interface> n = std::move(s.root_node_);
+                destroy_inline_node();
+                root_node_ = std::move(n);
+            }
         }
         return *this;
     }
 
     sym &sym::operator=(const number_interface &s) {
-        root_node_.reset(s.clone());
+        copy_node(s);
         return *this;
     }
 
@@ -658,7 +1131,7 @@ namespace sympp {
 
     sym::operator bool() const {
         if (is_number() || is_constant()) {
-            auto f = root_node_as<number_interface>();
+            auto f = node_as<number_interface>();
             f->operator bool();
         }
         throw sym_error(sym_error::NotNumeric);
@@ -666,40 +1139,44 @@ namespace sympp {
 
     sym::operator int() const {
         if (is_number() || is_constant()) {
-            auto f = root_node_as<number_interface>();
+            auto f = node_as<number_interface>();
             f->operator int();
         }
         throw sym_error(sym_error::NotNumeric);
     }
 
     sym::operator double() const {
-        if (is_number() || is_constant()) {
-            auto f = root_node_as<number_interface>();
-            f->operator double();
+        if (is_number()) {
+            return static_cast<double>(*node_as<number_interface>());
+        }
+        if (is_constant()) {
+            return static_cast<double>(*node_as<constant>());
         }
         throw sym_error(sym_error::NotNumeric);
     }
 
     const std::type_info &sym::type() const { return this->root_node_->type(); }
 
+    node_kind sym::kind() const { return this->root_node_->kind(); }
+
     bool sym::is_terminal() const { return this->root_node_->is_terminal(); }
 
     bool sym::is_internal() const { return !this->root_node_->is_terminal(); }
 
-    bool sym::is_number() const { return inherits_from<number_interface>(); }
+    bool sym::is_number() const { return is_number_kind(kind()); }
 
-    bool sym::is_boolean_number() const { return type() == typeid(boolean); }
+    bool sym::is_boolean_number() const { return kind() == node_kind::boolean; }
 
-    bool sym::is_integer_number() const { return type() == typeid(integer); }
+    bool sym::is_integer_number() const { return kind() == node_kind::integer; }
 
-    bool sym::is_real_number() const { return type() == typeid(real); }
+    bool sym::is_real_number() const { return kind() == node_kind::real; }
 
     bool sym::is_zero() const {
         if (is_number()) {
-            auto n = root_node_as<number_interface>();
+            auto n = node_as<number_interface>();
             return n->is_zero();
         } else if (is_constant()) {
-            auto c = root_node_as<constant>();
+            auto c = node_as<constant>();
             return c->is_zero();
         }
         throw sym_error(sym_error::NotNumeric);
@@ -707,20 +1184,20 @@ namespace sympp {
 
     bool sym::is_one() const {
         if (is_number()) {
-            auto n = root_node_as<number_interface>();
+            auto n = node_as<number_interface>();
             return n->is_one();
         } else if (is_constant()) {
-            auto c = root_node_as<constant>();
+            auto c = node_as<constant>();
             return c->is_one();
         }
         throw sym_error(sym_error::NotNumeric);
     }
 
-    bool sym::is_variable() const { return type() == typeid(variable); }
+    bool sym::is_variable() const { return kind() == node_kind::variable; }
 
     bool sym::is_boolean_variable() const {
         if (is_variable()) {
-            auto n = root_node_as<variable>();
+            auto n = node_as<variable>();
             return n->num_type() == numeric_type::var_boolean;
         }
         return false;
@@ -728,7 +1205,7 @@ namespace sympp {
 
     bool sym::is_integer_variable() const {
         if (is_variable()) {
-            auto n = root_node_as<variable>();
+            auto n = node_as<variable>();
             return n->num_type() == numeric_type::var_integer;
         }
         return false;
@@ -736,27 +1213,25 @@ namespace sympp {
 
     bool sym::is_real_variable() const {
         if (is_variable()) {
-            auto n = root_node_as<variable>();
+            auto n = node_as<variable>();
             return n->num_type() == numeric_type::var_real;
         }
         return false;
     }
 
-    bool sym::is_constant() const { return type() == typeid(constant); }
+    bool sym::is_constant() const { return kind() == node_kind::constant; }
 
-    bool sym::is_summation() const { return type() == typeid(summation); }
+    bool sym::is_summation() const { return kind() == node_kind::summation; }
 
-    bool sym::is_product() const { return type() == typeid(product); }
+    bool sym::is_product() const { return kind() == node_kind::product; }
 
-    bool sym::is_function() const {
-        return inherits_from<function_interface>();
-    }
+    bool sym::is_function() const { return is_function_kind(kind()); }
 
-    bool sym::is_statement() const { return type() == typeid(statement); }
+    bool sym::is_statement() const { return kind() == node_kind::statement; }
 
     bool sym::is_equation() const {
         if (is_statement()) {
-            auto s = root_node_as<statement>();
+            auto s = node_as<statement>();
             return s->statement_enum_type() ==
                    statement::statement_type::equality;
         }
@@ -765,7 +1240,7 @@ namespace sympp {
 
     bool sym::is_inequality() const {
         if (is_statement()) {
-            auto s = root_node_as<statement>();
+            auto s = node_as<statement>();
             return s->statement_enum_type() !=
                    statement::statement_type::equality;
         }
@@ -776,6 +1251,86 @@ namespace sympp {
         return root_node_;
     }
 
-    std::shared_ptr<node_interface> sym::root_node() { return root_node_; }
+    std::shared_ptr<node_interface> sym::root_node() {
+        detach();
+        return root_node_;
+    }
+
+    bool sym::is_shared() const { return root_node_.use_count() > 1; }
+
+    std::shared_ptr<node_interface> sym::adopt(node_interface *n) {
+        // the control block goes to the same arena as the node
+        if (std::pmr::memory_resource *r = arena::current()) {
+            return std::shared_ptr<node_interface>(
+                n, std::default_delete<node_interface>(),
+                std::pmr::polymorphic_allocator<node_interface>(r));
+        }
+        return std::shared_ptr<node_interface>(n);
+    }
+
+    size_t sym::hash() const { return root_node_->hash(); }
+
+    bool sym::is_inline() const {
+        return static_cast<const void *>(root_node_.get()) ==
+               static_cast<const void *>(inline_node_);
+    }
+
+    void sym::place_inline_node(node_interface *n) {
+        // alias an empty shared_ptr: root_node_ points to the
+        // inline node but does not own it
+        root_node_ = std::shared_ptr<node_interface>(
+            std::shared_ptr<node_interface>(), n);
+    }
+
+    void sym::destroy_inline_node() {
+        if (is_inline()) {
+            root_node_->~node_interface();
+            root_node_.reset();
+        }
+    }
+
+    void sym::copy_node(const node_interface &n) {
+        switch (n.kind()) {
+        case node_kind::boolean:
+            emplace_node<boolean>(static_cast<const boolean &>(n));
+            break;
+        case node_kind::integer:
+            emplace_node<integer>(static_cast<const integer &>(n));
+            break;
+        case node_kind::rational:
+            emplace_node<rational>(static_cast<const rational &>(n));
+            break;
+        case node_kind::real:
+            emplace_node<real>(static_cast<const real &>(n));
+            break;
+        case node_kind::variable:
+            emplace_node<variable>(static_cast<const variable &>(n));
+            break;
+        default:
+            // clone first: n might be owned by the current node
+            std::shared_ptr<node_interface> c = adopt(n.clone());
+            destroy_inline_node();
+            root_node_ = std::move(c);
+            intern();
+        }
+    }
+
+    void sym::intern() {
+        if (unique_table::enabled() && !is_inline()) {
+            root_node_ = unique_table::intern(root_node_);
+        }
+    }
+
+    void sym::detach() {
+        // Nodes are only cloned one level at a time: the clone
+        // shares its children with the original node, and each
+        // child is detached later only if it gets modified too
+        if (root_node_.use_count() > 1) {
+            root_node_ = adopt(root_node_->clone());
+        }
+        // the parent of this sym has already been invalidated when
+        // we got a modifiable reference to this sym
+        root_node_->invalidate_hash();
+    }
 
 } // namespace sympp
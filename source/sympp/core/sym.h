@@ -8,6 +8,9 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <memory_resource>
+#include <new>
+#include <optional>
 #include <type_traits>
 #include <typeinfo>
 #include <unordered_map>
@@ -17,6 +20,10 @@
 // You can't include node_interface here
 // because that would create dependency
 // cycles. Forward-declare node_interface.
+#include <sympp/core/arena.h>
+#include <sympp/core/node_kind.h>
+#include <sympp/core/simd_math.h>
+#include <sympp/core/thread_pool.h>
 
 namespace sympp {
     /// Forward declare partial definitions
@@ -62,6 +69,8 @@ namespace sympp {
 
     class statement;
 
+    class tape;
+
     /// Type of a tiny c compiler function
     typedef double (*tcc_function)(bool *, int *, double *);
 
@@ -70,6 +79,15 @@ namespace sympp {
                                              const std::vector<int> &,
                                              const std::vector<double> &)>;
 
+    /// Function evaluating an expression at many points
+    /// The arguments are the number of points, the columns of bool,
+    /// int and double values with one value per point, and the output
+    /// with room for one value per point.
+    using batch_lambda = std::function<void(
+        size_t, const std::vector<const uint8_t *> &,
+        const std::vector<const int *> &,
+        const std::vector<const double *> &, double *)>;
+
     /// Function measuring the complexity of a symbol
     using complexity_lambda = std::function<double(const node_interface &)>;
 
@@ -89,12 +107,19 @@ namespace sympp {
     ///    case the calls are forwarded to the parent node
     /// 2) some extra functions to manipulate and lambdify
     ///    the symbols more conveniently.
+    /// Copies of a sym share the same nodes. A node is only
+    /// cloned (copy-on-write) when a sym that shares it calls
+    /// a function that might modify the tree.
+    /// Numbers and variables are small enough to be stored inside
+    /// the sym itself, so they need no allocation and are copied
+    /// instead of shared.
     class sym {
       public /* constructors */:
         /// Construct an empty sym
         sym();
 
         /// Construct a sym from another sym
+        /// The nodes are shared until one of the syms is modified
         sym(const sym &);
 
         /// Construct a sym from another sym
@@ -138,9 +163,9 @@ namespace sympp {
 
         /// Construct a sym of an specific type
         template <class NODE_TYPE, class... Args>
-        explicit sym(Args &&... args)
-            : root_node_(dynamic_cast<node_interface *>(
-                  new NODE_TYPE(std::forward<Args>(args)...))) {}
+        explicit sym(Args &&... args) {
+            emplace_node<NODE_TYPE>(std::forward<Args>(args)...);
+        }
 
         /// Construct a number from a bool
         explicit sym(bool);
@@ -188,16 +213,26 @@ namespace sympp {
         sym &simplify();
 
         /// Don't allow the expresion to grow more than ration
+        /// Other than the default ratio runs the simplifier driver.
         sym &simplify(double ratio);
 
         /// Don't allow expression to grow more than ratio
         /// and use function as a complexity measure of the
         /// expression for ratio
+        /// Other than the default options run the simplifier driver.
         sym &simplify(double ratio, complexity_lambda func);
 
+        /// Simplify independent subtrees concurrently on a thread pool
+        /// The result is the same as the sequential simplify. Outside a
+        /// parallel_scope, this uses the global pool.
+        sym &simplify(const execution::parallel_policy &);
+
         /// Put polynomial into a canonical form of a sum of monomials
         sym &expand();
 
+        /// Expand independent subtrees concurrently on a thread pool
+        sym &expand(const execution::parallel_policy &);
+
         /// Takes a polynomial and factors it into irreducible factors
         sym &factor();
 
@@ -243,6 +278,23 @@ namespace sympp {
         /// right to left Only if x and y are positive and n is real.
         sym &logcombine();
 
+        /// Rewrite the polynomial subtrees in Horner form
+        /// 3x^3+2x^2+1 becomes 1+x^2(2+3x), which needs fewer
+        /// operations and no pow calls to evaluate.
+        sym &horner();
+
+        /// Rewrite the polynomial subtrees in Estrin form
+        /// Like Horner form, but the powers are grouped in pairs, so
+        /// the pairs are independent and can be evaluated in parallel.
+        sym &estrin();
+
+        /// Replace the subtrees without variables by their values
+        /// Subtrees such as 2*pi become reals, and sums and products
+        /// keep one term with the value of their numbers and
+        /// constants. The cse pass does this before evaluate, lambdify
+        /// and compile.
+        sym &fold_constants();
+
       public /* manipulate symbol */:
         /// Stream the node to ostream
         void stream(std::ostream &, bool print_format_symbolic) const;
@@ -292,15 +344,18 @@ namespace sympp {
         [[nodiscard]] size_t count_ops() const;
 
         /// Identify function category
-        function_type calculate_function_type();
+        [[nodiscard]] function_type calculate_function_type() const;
 
         /// Iterate the terms of a symbol
+        /// This detaches the node, so loops that only read the terms
+        /// should iterate a const sym
         std::vector<sym>::iterator begin();
 
         /// Iterate the terms of a symbol
         std::vector<sym>::iterator end();
 
         /// Iterate the terms of a symbol
+        /// The terms of sums and products are in canonical order
         [[nodiscard]] std::vector<sym>::const_iterator begin() const;
 
         /// Iterate the terms of a symbol
@@ -325,10 +380,52 @@ namespace sympp {
                      const std::vector<int> &int_values,
                      const std::vector<double> &double_values) const;
 
+        /// Evaluate expression at n points
+        /// The value of variable k at point j is columns[k][j], and
+        /// out needs room for n values. The tree is walked once per
+        /// block of points (see cse::evaluate_batch).
+        void evaluate_batch(size_t n,
+                            const std::vector<const uint8_t *> &bool_columns,
+                            const std::vector<const int *> &int_columns,
+                            const std::vector<const double *> &double_columns,
+                            double *out) const;
+
+        /// Evaluate expression at n points with the SIMD kernels
+        /// The results can differ from evaluate_batch by the errors of
+        /// the kernels (see simd::exp).
+        void evaluate_batch(const execution::simd_policy &, size_t n,
+                            const std::vector<const uint8_t *> &bool_columns,
+                            const std::vector<const int *> &int_columns,
+                            const std::vector<const double *> &double_columns,
+                            double *out) const;
+
         /// Compile expression to a function pointer
+        /// Repeated subexpressions are only evaluated once (see cse)
         [[nodiscard]] node_lambda lambdify() const;
 
+        /// Compile expression to a function evaluating many points
+        [[nodiscard]] batch_lambda lambdify_batch() const;
+
+        /// Compile expression to a function evaluating many points
+        /// with the SIMD kernels
+        [[nodiscard]] batch_lambda
+        lambdify_batch(const execution::simd_policy &) const;
+
+        /// Compile expression to bytecode for a register machine
+        /// Compiling takes microseconds, so this is the fastest way to
+        /// evaluate expressions that change often (see bytecode).
+        [[nodiscard]] node_lambda compile_bytecode() const;
+
+        /// Flatten expression into a tape
+        /// The tape has the nodes in post-order in contiguous arrays
+        /// (see tape).
+        [[nodiscard]] tape to_tape() const;
+
+        /// Expression tree of a tape
+        [[nodiscard]] static sym from_tape(const tape &);
+
         /// Compile expression to a string with C code
+        /// Repeated subexpressions are assigned to temporaries
         [[nodiscard]] std::string c_code() const;
 
         /// Save expression as code to a file
@@ -338,6 +435,10 @@ namespace sympp {
         /// pointer
         [[nodiscard]] node_lambda compile() const;
 
+        /// Compile the expression with a C compiler and return a function
+        /// evaluating many points, like evaluate_batch
+        [[nodiscard]] batch_lambda compile_batch() const;
+
       public /* operators */:
         /*
          * Most other operators are defined in
@@ -380,6 +481,7 @@ namespace sympp {
         sym &operator=(statement &&);
 
         /// Attribution operator from sym
+        /// The nodes are shared until one of the syms is modified
         sym &operator=(const sym &);
 
         /// Attribution operator from rvalue sym
@@ -428,6 +530,10 @@ namespace sympp {
         /// Return type of this symbolic variable
         [[nodiscard]] const std::type_info &type() const;
 
+        /// Return the kind of the root node
+        /// This is cheaper than comparing type_info objects
+        [[nodiscard]] node_kind kind() const;
+
         /// Return true if this is a terminal node
         bool is_terminal() const;
 
@@ -488,40 +594,179 @@ namespace sympp {
 
         /// Check if symbol is of a given type
         template <class NODE_TYPE> [[nodiscard]] bool is() const {
-            return this->type() == typeid(NODE_TYPE);
+            if constexpr (has_kind_value<NODE_TYPE>::value) {
+                return kind() == NODE_TYPE::kind_value;
+            } else {
+                return this->type() == typeid(NODE_TYPE);
+            }
         }
 
         /// Check if symbol inherits from a given type
         template <class NODE_TYPE> [[nodiscard]] bool inherits_from() const {
-            auto p = root_node_as<NODE_TYPE>();
-            return p != nullptr;
+            if constexpr (is_kind_checkable_v<NODE_TYPE>) {
+                return is_kind_of<NODE_TYPE>(kind());
+            } else {
+                return dynamic_cast<const NODE_TYPE *>(root_node_.get()) !=
+                       nullptr;
+            }
         }
 
       public /* non-modifying functions */:
         /// Get a shared pointer to the root node
         [[nodiscard]] std::shared_ptr<const node_interface> root_node() const;
 
+        /// Get a shared pointer to the root node we can modify
+        /// The root node is cloned first if it is shared
         std::shared_ptr<node_interface> root_node();
 
+        /// True if the root node is shared with other syms
+        [[nodiscard]] bool is_shared() const;
+
+        /// Structural hash of the expression tree
+        /// The hash is cached in the nodes. Syms that compare equal
+        /// have the same hash.
+        [[nodiscard]] size_t hash() const;
+
         /// Get a shared pointer to the root node as another pointer type
+        /// The pointer is null if the node is not a DERIVED_NODE_TYPE
         template <class DERIVED_NODE_TYPE>
         [[nodiscard]] std::shared_ptr<const DERIVED_NODE_TYPE>
         root_node_as() const {
-            return std::dynamic_pointer_cast<const DERIVED_NODE_TYPE>(
-                this->root_node());
+            if constexpr (is_kind_checkable_v<DERIVED_NODE_TYPE>) {
+                if (!inherits_from<DERIVED_NODE_TYPE>()) {
+                    return nullptr;
+                }
+                return std::static_pointer_cast<const DERIVED_NODE_TYPE>(
+                    root_node_);
+            } else {
+                return std::dynamic_pointer_cast<const DERIVED_NODE_TYPE>(
+                    root_node_);
+            }
         }
 
         template <class DERIVED_NODE_TYPE>
         std::shared_ptr<DERIVED_NODE_TYPE> root_node_as() {
-            return std::dynamic_pointer_cast<DERIVED_NODE_TYPE>(
-                this->root_node());
+            if constexpr (is_kind_checkable_v<DERIVED_NODE_TYPE>) {
+                if (!inherits_from<DERIVED_NODE_TYPE>()) {
+                    return nullptr;
+                }
+                return std::static_pointer_cast<DERIVED_NODE_TYPE>(
+                    this->root_node());
+            } else {
+                return std::dynamic_pointer_cast<DERIVED_NODE_TYPE>(
+                    this->root_node());
+            }
+        }
+
+        /// Get a raw pointer to the root node as another pointer type
+        /// Unlike root_node_as, this does not touch the reference count.
+        /// The pointer is null if the node is not a DERIVED_NODE_TYPE.
+        template <class DERIVED_NODE_TYPE>
+        [[nodiscard]] const DERIVED_NODE_TYPE *node_as() const {
+            if constexpr (is_kind_checkable_v<DERIVED_NODE_TYPE>) {
+                if (!inherits_from<DERIVED_NODE_TYPE>()) {
+                    return nullptr;
+                }
+                return static_cast<const DERIVED_NODE_TYPE *>(root_node_.get());
+            } else {
+                return dynamic_cast<const DERIVED_NODE_TYPE *>(
+                    root_node_.get());
+            }
         }
 
       private:
+        /// Create a node in the current arena (or in the heap)
+        /// The node and the control block share a single allocation
+        template <class NODE_TYPE, class... Args>
+        static std::shared_ptr<node_interface> make_node(Args &&... args) {
+            if (std::pmr::memory_resource *r = arena::current()) {
+                return std::allocate_shared<NODE_TYPE>(
+                    std::pmr::polymorphic_allocator<NODE_TYPE>(r),
+                    std::forward<Args>(args)...);
+            }
+            return std::make_shared<NODE_TYPE>(std::forward<Args>(args)...);
+        }
+
+        /// Take ownership of a node allocated with new, such as a clone
+        static std::shared_ptr<node_interface> adopt(node_interface *);
+
+        /// Check if nodes of a given type are stored inside the sym
+        template <class NODE_TYPE> static constexpr bool is_inline_node() {
+            if constexpr (has_kind_value<NODE_TYPE>::value) {
+                return is_number_kind(NODE_TYPE::kind_value) ||
+                       NODE_TYPE::kind_value == node_kind::variable;
+            } else {
+                return false;
+            }
+        }
+
+        /// Replace the root node with a new node of a given type
+        template <class NODE_TYPE, class... Args>
+        void emplace_node(Args &&... args) {
+            if constexpr (is_inline_node<NODE_TYPE>()) {
+                static_assert(sizeof(NODE_TYPE) <= inline_node_size);
+                static_assert(alignof(NODE_TYPE) <= alignof(double));
+                // construct it first: args might refer to the current node
+                NODE_TYPE n(std::forward<Args>(args)...);
+                destroy_inline_node();
+                // nodes overload operator new, so use the global one
+                place_inline_node(::new (static_cast<void *>(inline_node_))
+                                      NODE_TYPE(std::move(n)));
+            } else {
+                std::shared_ptr<node_interface> n =
+                    make_node<NODE_TYPE>(std::forward<Args>(args)...);
+                destroy_inline_node();
+                root_node_ = std::move(n);
+                intern();
+            }
+        }
+
+        /// Replace the root node with a copy of another node
+        void copy_node(const node_interface &);
+
+        /// True if the root node is stored inside the sym
+        [[nodiscard]] bool is_inline() const;
+
+        /// Point the root node to a node in the inline storage
+        void place_inline_node(node_interface *);
+
+        /// Destroy the root node if it is stored inside the sym
+        void destroy_inline_node();
+
+        /// Replace the root node with an identical node from
+        /// the unique_table if hash-consing is enabled
+        void intern();
+
+        /// Simplify the root node with one of the node simplify functions
+        /// and replace it with the result, unless it is in normal form
+        /// The normal form flag is only used with the default options.
+        sym &simplify_root(
+            const std::function<std::optional<sym>(node_interface &)> &,
+            bool default_options);
+
+        /// Clone the root node if it is shared with other syms
+        /// and invalidate its hash before it gets modified
+        void detach();
+
+      private:
+        /// Bytes available to store a node inside the sym
+        static constexpr size_t inline_node_size = 32;
+
         /// Parent node
+        /// If the node is stored inline, this pointer does not own it
         std::shared_ptr<node_interface> root_node_;
+
+        /// Storage for small nodes
+        alignas(double) std::byte inline_node_[inline_node_size];
     };
 
 } // namespace sympp
 
+namespace std {
+    /// Hash syms by their expression tree
+    template <> struct hash<sympp::sym> {
+        size_t operator()(const sympp::sym &s) const { return s.hash(); }
+    };
+} // namespace std
+
 #endif
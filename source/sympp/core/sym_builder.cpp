@@ -0,0 +1,49 @@
+// sym_builder.cpp
+
+// C++
+#include <utility>
+
+// Internal
+#include <sympp/core/sym_builder.h>
+#include <sympp/core/sym_error.h>
+#include <sympp/node/operation/product.h>
+#include <sympp/node/operation/summation.h>
+
+namespace sympp {
+
+    sym_builder::sym_builder(node_kind k) : kind_(k) {
+        if (k != node_kind::summation && k != node_kind::product) {
+            throw sym_error(sym_error::NoMatch);
+        }
+    }
+
+    void sym_builder::reserve(size_t n) { terms_.reserve(n); }
+
+    sym_builder &sym_builder::push_back(const sym &s) {
+        terms_.emplace_back(s);
+        return *this;
+    }
+
+    sym_builder &sym_builder::push_back(sym &&s) {
+        terms_.emplace_back(std::move(s));
+        return *this;
+    }
+
+    size_t sym_builder::size() const { return terms_.size(); }
+
+    sym sym_builder::build() {
+        std::vector<sym> terms = std::move(terms_);
+        terms_.clear();
+        if (terms.empty()) {
+            return kind_ == node_kind::summation ? sym(0) : sym(1);
+        }
+        if (terms.size() == 1) {
+            return std::move(terms.front());
+        }
+        if (kind_ == node_kind::summation) {
+            return sym(summation(std::move(terms)));
+        }
+        return sym(product(std::move(terms)));
+    }
+
+} // namespace sympp
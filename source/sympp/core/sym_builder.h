@@ -0,0 +1,52 @@
+// sym_builder.h
+
+#ifndef SYMPP_SYM_BUILDER_H
+#define SYMPP_SYM_BUILDER_H
+
+// C++
+#include <cstddef>
+#include <vector>
+
+// Internal
+#include <sympp/core/node_kind.h>
+#include <sympp/core/sym.h>
+
+namespace sympp {
+    /// \class Accumulator for n-ary sums and products
+    /// Building a sum with `s = s + t` in a loop creates a new
+    /// summation for each term, and each new summation copies the
+    /// terms of the previous one. The builder only appends the terms
+    /// to a vector and creates a single node when we call build(),
+    /// so building an expression with n terms is O(n).
+    class sym_builder {
+      public:
+        /// Accumulate the terms of a summation or the factors of a product
+        explicit sym_builder(node_kind k = node_kind::summation);
+
+        /// Reserve memory for a number of terms
+        void reserve(size_t);
+
+        /// Append a term
+        sym_builder &push_back(const sym &);
+
+        /// Append a term
+        sym_builder &push_back(sym &&);
+
+        /// Number of terms appended since the last build
+        [[nodiscard]] size_t size() const;
+
+        /// Create the node with the terms and reset the builder
+        /// An empty sum is 0 and an empty product is 1. A single
+        /// term is returned as it is.
+        sym build();
+
+      private:
+        /// Kind of node we are building
+        node_kind kind_;
+
+        /// Terms of the node
+        std::vector<sym> terms_;
+    };
+} // namespace sympp
+
+#endif // SYMPP_SYM_BUILDER_H
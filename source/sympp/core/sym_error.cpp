@@ -39,6 +39,10 @@ namespace sympp {
             return "sympp::sym_error: The data type is not supprted by "
                    "numeric. (error code " +
                    std::to_string(code()) + ")";
+        case error::BudgetExhausted:
+            return "sympp::sym_error: The simplification budget is "
+                   "exhausted. (error code " +
+                   std::to_string(code()) + ")";
         default:
             return "sympp::sym_error: Unknown error. (error code " +
                    std::to_string(code()) + ")";
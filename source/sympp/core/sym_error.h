@@ -20,7 +20,8 @@ namespace sympp {
             NotVector,
             Unsupportednumeric,
             DivideByZero,
-            AbstractClass
+            AbstractClass,
+            BudgetExhausted
         };
 
       public:
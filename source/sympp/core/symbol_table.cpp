@@ -0,0 +1,47 @@
+// symbol_table.cpp
+
+// Internal
+#include <sympp/core/symbol_table.h>
+
+namespace sympp {
+
+    symbol_id symbol_table::intern(std::string_view s) {
+        std::lock_guard<std::mutex> lock(mutex());
+        auto it = ids().find(s);
+        if (it != ids().end()) {
+            return it->second;
+        }
+        const auto id = static_cast<symbol_id>(names().size());
+        const std::string &n = names().emplace_back(s);
+        ids().emplace(n, id);
+        return id;
+    }
+
+    const std::string &symbol_table::name(symbol_id id) {
+        std::lock_guard<std::mutex> lock(mutex());
+        return names()[id];
+    }
+
+    size_t symbol_table::size() {
+        std::lock_guard<std::mutex> lock(mutex());
+        return names().size();
+    }
+
+    std::deque<std::string> &symbol_table::names() {
+        // function-local statics, so global syms can
+        // intern their names during static initialization
+        static std::deque<std::string> names_;
+        return names_;
+    }
+
+    std::unordered_map<std::string_view, symbol_id> &symbol_table::ids() {
+        static std::unordered_map<std::string_view, symbol_id> ids_;
+        return ids_;
+    }
+
+    std::mutex &symbol_table::mutex() {
+        static std::mutex mutex_;
+        return mutex_;
+    }
+
+} // namespace sympp
@@ -0,0 +1,51 @@
+// symbol_table.h
+
+#ifndef SYMPP_SYMBOL_TABLE_H
+#define SYMPP_SYMBOL_TABLE_H
+
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace sympp {
+    /// Id of a name in the symbol table
+    using symbol_id = uint32_t;
+
+    /// \class Symbol table
+    /// Process-wide table of the names of variables and constants.
+    /// Each distinct name is stored only once and nodes keep the
+    /// 32-bit id of their name, so copying, comparing and hashing
+    /// names are integer operations.
+    /// Ids are given in the order names are first seen and names
+    /// are never removed from the table.
+    class symbol_table {
+      public:
+        /// Id of a name, which is inserted in the table if needed
+        static symbol_id intern(std::string_view);
+
+        /// Name with a given id
+        [[nodiscard]] static const std::string &name(symbol_id);
+
+        /// Number of names in the table
+        [[nodiscard]] static size_t size();
+
+      private:
+        /// Names indexed by their ids
+        /// A deque never moves its elements, so the views
+        /// in the index remain valid
+        static std::deque<std::string> &names();
+
+        /// Ids indexed by their names
+        static std::unordered_map<std::string_view, symbol_id> &ids();
+
+        /// Protect the table
+        static std::mutex &mutex();
+    };
+} // namespace sympp
+
+#endif // SYMPP_SYMBOL_TABLE_H
@@ -0,0 +1,307 @@
+// tape.cpp
+
+// C++
+#include <cmath>
+#include <limits>
+
+// Internal
+#include <sympp/core/node_interface.h>
+#include <sympp/core/sym_builder.h>
+#include <sympp/core/tape.h>
+#include <sympp/core/unique_table.h>
+#include <sympp/node/function/abs.h>
+#include <sympp/node/function/cos.h>
+#include <sympp/node/function/cosh.h>
+#include <sympp/node/function/log.h>
+#include <sympp/node/function/sin.h>
+#include <sympp/node/function/sinh.h>
+#include <sympp/node/terminal/constant.h>
+#include <sympp/node/terminal/number_interface.h>
+#include <sympp/node/terminal/variable.h>
+
+namespace sympp {
+
+    namespace {
+        // the free functions sympp::sinh and sympp::cosh hide the classes
+        using sinh_node = class sinh;
+        using cosh_node = class cosh;
+    } // namespace
+
+    tape::tape(const sym &s) {
+        visited_nodes visited;
+        subtree_index index;
+        add(s, visited, index);
+    }
+
+    size_t tape::size() const { return instructions_.size(); }
+
+    bool tape::empty() const { return instructions_.empty(); }
+
+    const std::vector<tape::instruction> &tape::instructions() const {
+        return instructions_;
+    }
+
+    const std::vector<uint32_t> &tape::operands() const { return operands_; }
+
+    const std::vector<sym> &tape::leaves() const { return leaves_; }
+
+    const std::vector<double> &tape::values() const { return values_; }
+
+    bool tape::is_leaf(node_kind k) {
+        switch (k) {
+        case node_kind::summation:
+        case node_kind::product:
+        case node_kind::pow:
+        case node_kind::log:
+        case node_kind::sin:
+        case node_kind::cos:
+        case node_kind::sinh:
+        case node_kind::cosh:
+        case node_kind::abs:
+            return false;
+        default:
+            return true;
+        }
+    }
+
+    pow::lowering tape::power(size_t i) const {
+        const instruction &p = instructions_[i];
+        const instruction &base = instructions_[operands_[p.first]];
+        const instruction &exponent = instructions_[operands_[p.first + 1]];
+        if (is_leaf(base.kind) && constant::is_e(leaves_[base.first])) {
+            return {pow::lowering::exp, 0};
+        }
+        if (!is_number_kind(exponent.kind)) {
+            return {};
+        }
+        const double n = values_[exponent.first];
+        if (n == std::floor(n) && std::abs(n) <= pow::max_integer_exponent) {
+            return {pow::lowering::integer, static_cast<int>(n)};
+        }
+        if (std::abs(n) == 0.5) {
+            return {pow::lowering::square_root, n > 0 ? 1 : -1};
+        }
+        return {};
+    }
+
+    double tape::evaluate(const std::vector<uint8_t> &bool_values,
+                          const std::vector<int> &int_values,
+                          const std::vector<double> &double_values) const {
+        std::vector<double> r(instructions_.size());
+        for (size_t i = 0; i < instructions_.size(); ++i) {
+            const instruction &in = instructions_[i];
+            const uint32_t *args = operands_.data() + in.first;
+            switch (in.kind) {
+            case node_kind::summation: {
+                double v = 0.;
+                for (uint32_t k = 0; k < in.arity; ++k) {
+                    v += r[args[k]];
+                }
+                r[i] = v;
+                break;
+            }
+            case node_kind::product: {
+                double v = 1.;
+                for (uint32_t k = 0; k < in.arity; ++k) {
+                    v *= r[args[k]];
+                }
+                r[i] = v;
+                break;
+            }
+            case node_kind::pow:
+                r[i] = pow::evaluate(power(i), r[args[0]], r[args[1]]);
+                break;
+            case node_kind::log: {
+                // natural logarithms do not divide by log(e)
+                const instruction &base = instructions_[args[1]];
+                if (is_leaf(base.kind) &&
+                    constant::is_e(leaves_[base.first])) {
+                    r[i] = std::log(r[args[0]]);
+                } else {
+                    r[i] = std::log(r[args[0]]) / std::log(r[args[1]]);
+                }
+                break;
+            }
+            case node_kind::sin:
+                r[i] = std::sin(r[args[0]]);
+                break;
+            case node_kind::cos:
+                r[i] = std::cos(r[args[0]]);
+                break;
+            case node_kind::sinh:
+                r[i] = std::sinh(r[args[0]]);
+                break;
+            case node_kind::cosh:
+                r[i] = std::cosh(r[args[0]]);
+                break;
+            case node_kind::abs:
+                r[i] = std::abs(r[args[0]]);
+                break;
+            case node_kind::variable: {
+                const auto *v = leaves_[in.first].node_as<variable>();
+                switch (v->num_type()) {
+                case numeric_type::var_boolean:
+                    r[i] = static_cast<double>(bool_values[v->index()]);
+                    break;
+                case numeric_type::var_integer:
+                    r[i] = static_cast<double>(int_values[v->index()]);
+                    break;
+                default:
+                    r[i] = double_values[v->index()];
+                    break;
+                }
+                break;
+            }
+            default:
+                if (is_number_kind(in.kind) ||
+                    in.kind == node_kind::constant) {
+                    r[i] = values_[in.first];
+                } else {
+                    // opaque nodes evaluate their whole subtree
+                    r[i] = leaves_[in.first].evaluate(bool_values, int_values,
+                                                      double_values);
+                }
+                break;
+            }
+        }
+        return r.empty() ? 0. : r.back();
+    }
+
+    sym tape::to_sym() const {
+        if (instructions_.empty()) {
+            return sym();
+        }
+        std::vector<sym> nodes;
+        nodes.reserve(instructions_.size());
+        for (const instruction &in : instructions_) {
+            const uint32_t *args = operands_.data() + in.first;
+            switch (in.kind) {
+            case node_kind::summation:
+            case node_kind::product: {
+                sym_builder b(in.kind);
+                b.reserve(in.arity);
+                for (uint32_t k = 0; k < in.arity; ++k) {
+                    b.push_back(nodes[args[k]]);
+                }
+                nodes.emplace_back(b.build());
+                break;
+            }
+            case node_kind::pow:
+                nodes.emplace_back(pow(nodes[args[0]], nodes[args[1]]));
+                break;
+            case node_kind::log:
+                nodes.emplace_back(log(nodes[args[0]], nodes[args[1]]));
+                break;
+            case node_kind::sin:
+                nodes.emplace_back(sin(nodes[args[0]]));
+                break;
+            case node_kind::cos:
+                nodes.emplace_back(cos(nodes[args[0]]));
+                break;
+            case node_kind::sinh:
+                nodes.emplace_back(sinh_node(nodes[args[0]]));
+                break;
+            case node_kind::cosh:
+                nodes.emplace_back(cosh_node(nodes[args[0]]));
+                break;
+            case node_kind::abs:
+                nodes.emplace_back(abs(nodes[args[0]]));
+                break;
+            default:
+                nodes.emplace_back(leaves_[in.first]);
+                break;
+            }
+        }
+        return nodes.back();
+    }
+
+    size_t tape::hash() const {
+        size_t h = std::hash<size_t>()(instructions_.size());
+        for (const instruction &in : instructions_) {
+            h = hash_combine(h, static_cast<size_t>(in.kind));
+            if (is_leaf(in.kind)) {
+                h = hash_combine(h, leaves_[in.first].hash());
+            } else {
+                for (uint32_t k = 0; k < in.arity; ++k) {
+                    h = hash_combine(h, operands_[in.first + k]);
+                }
+            }
+        }
+        return h;
+    }
+
+    bool tape::operator==(const tape &rhs) const {
+        if (instructions_.size() != rhs.instructions_.size() ||
+            operands_ != rhs.operands_ ||
+            leaves_.size() != rhs.leaves_.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < instructions_.size(); ++i) {
+            const instruction &a = instructions_[i];
+            const instruction &b = rhs.instructions_[i];
+            if (a.kind != b.kind || a.arity != b.arity || a.first != b.first) {
+                return false;
+            }
+        }
+        // compare treats numbers of different kinds as equal
+        for (size_t i = 0; i < leaves_.size(); ++i) {
+            if (!unique_table::identical(
+                    *leaves_[i].node_as<node_interface>(),
+                    *rhs.leaves_[i].node_as<node_interface>())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool tape::operator!=(const tape &rhs) const { return !(*this == rhs); }
+
+    uint32_t tape::add(const sym &s, visited_nodes &visited,
+                       subtree_index &index) {
+        const node_interface *n = s.node_as<node_interface>();
+        if (auto it = visited.find(n); it != visited.end()) {
+            return it->second;
+        }
+        // identical subtrees in different nodes are stored once
+        // compare would also merge numbers of different kinds
+        const size_t h = s.hash();
+        auto [first, last] = index.equal_range(h);
+        for (auto it = first; it != last; ++it) {
+            if (unique_table::identical(
+                    *it->second.second.node_as<node_interface>(), *n)) {
+                visited.emplace(n, it->second.first);
+                return it->second.first;
+            }
+        }
+        instruction in{s.kind(), 0, 0};
+        if (is_leaf(in.kind)) {
+            in.first = static_cast<uint32_t>(leaves_.size());
+            double value = std::numeric_limits<double>::quiet_NaN();
+            if (is_number_kind(in.kind)) {
+                value = s.evaluate({}, {}, {});
+            } else if (in.kind == node_kind::constant &&
+                       s.node_as<constant>()->value().is_number()) {
+                // constants such as i have no real value
+                value = s.evaluate({}, {}, {});
+            }
+            leaves_.emplace_back(s);
+            values_.emplace_back(value);
+        } else {
+            // operands first, so the tape is in post-order
+            std::vector<uint32_t> args;
+            args.reserve(s.size());
+            for (const sym &child : s) {
+                args.emplace_back(add(child, visited, index));
+            }
+            in.arity = static_cast<uint32_t>(args.size());
+            in.first = static_cast<uint32_t>(operands_.size());
+            operands_.insert(operands_.end(), args.begin(), args.end());
+        }
+        const auto i = static_cast<uint32_t>(instructions_.size());
+        instructions_.emplace_back(in);
+        visited.emplace(n, i);
+        index.emplace(h, std::make_pair(i, s));
+        return i;
+    }
+
+} // namespace sympp
@@ -0,0 +1,128 @@
+// tape.h
+
+#ifndef SYMPP_TAPE_H
+#define SYMPP_TAPE_H
+
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Internal
+#include <sympp/core/node_kind.h>
+#include <sympp/core/sym.h>
+#include <sympp/node/function/pow.h>
+
+namespace sympp {
+    /// \class Flat representation of an expression
+    /// The tape stores the nodes of an expression as instructions in
+    /// a contiguous array in post-order, so the operands of an
+    /// instruction always come before it and the last instruction is
+    /// the root. Operations refer to their operands by position in
+    /// the tape, so a subtree that appears in many parents is stored
+    /// once.
+    /// Terminals, and the nodes we cannot decompose, such as user
+    /// functions and statements, are leaves kept in a separate array
+    /// with their numeric values.
+    /// Passes over the tape are plain loops over arrays, so they do
+    /// not depend on where the nodes of the tree are in the heap. The
+    /// tape is immutable: sym::from_tape converts it back to a tree.
+    class tape {
+      public:
+        /// \class One node of the expression
+        struct instruction {
+            /// Kind of the node
+            node_kind kind{node_kind::undefined};
+
+            /// Number of operands, or 0 for leaves
+            uint32_t arity{0};
+
+            /// Position of the first operand in operands(), or
+            /// position of the leaf in leaves()
+            uint32_t first{0};
+        };
+
+        /// Create an empty tape
+        tape() = default;
+
+        /// Flatten an expression
+        explicit tape(const sym &);
+
+        /// Number of instructions
+        [[nodiscard]] size_t size() const;
+
+        /// True if the tape has no instructions
+        [[nodiscard]] bool empty() const;
+
+        /// Instructions in post-order
+        [[nodiscard]] const std::vector<instruction> &instructions() const;
+
+        /// Positions of the operands of all instructions
+        /// The operands of instruction i are
+        /// operands()[first, first + arity), and each one is the
+        /// position of an instruction before i.
+        [[nodiscard]] const std::vector<uint32_t> &operands() const;
+
+        /// Terminals and opaque nodes
+        [[nodiscard]] const std::vector<sym> &leaves() const;
+
+        /// Values of numbers and constants, in the order of leaves()
+        /// Other leaves have the value NaN.
+        [[nodiscard]] const std::vector<double> &values() const;
+
+        /// True if nodes of this kind are leaves of the tape
+        [[nodiscard]] static bool is_leaf(node_kind);
+
+        /// Operation that evaluates the power in instruction i
+        /// This is pow::lower for the node of the instruction.
+        [[nodiscard]] pow::lowering power(size_t i) const;
+
+        /// Evaluate the expression in a single pass over the tape
+        [[nodiscard]] double
+        evaluate(const std::vector<uint8_t> &bool_values,
+                 const std::vector<int> &int_values,
+                 const std::vector<double> &double_values) const;
+
+        /// Expression tree of the tape
+        /// Nodes shared in the tape are shared in the tree.
+        [[nodiscard]] sym to_sym() const;
+
+        /// Hash of the tape from its instructions and leaves
+        /// Tapes of the same expression have the same hash.
+        [[nodiscard]] size_t hash() const;
+
+        /// True if two tapes have the same instructions and leaves
+        bool operator==(const tape &) const;
+
+        bool operator!=(const tape &) const;
+
+      private:
+        /// Positions of the nodes we have already added
+        using visited_nodes =
+            std::unordered_map<const node_interface *, uint32_t>;
+
+        /// Positions of the subtrees we have already added, by hash
+        using subtree_index =
+            std::unordered_multimap<size_t, std::pair<uint32_t, sym>>;
+
+        /// Append a subtree and return the position of its root
+        uint32_t add(const sym &, visited_nodes &, subtree_index &);
+
+      private:
+        /// Instructions in post-order
+        std::vector<instruction> instructions_;
+
+        /// Operands of all instructions
+        std::vector<uint32_t> operands_;
+
+        /// Leaves of the expression
+        std::vector<sym> leaves_;
+
+        /// Numeric values of the leaves
+        std::vector<double> values_;
+    };
+} // namespace sympp
+
+#endif // SYMPP_TAPE_H
@@ -75,6 +75,16 @@ namespace sympp {
             }
         }
 
+        /// Get the kind declared by the derived class
+        /// If your class is abstract, it won't inherit this function
+        [[nodiscard]] node_kind calculate_kind() const override {
+            if constexpr (has_kind_value<DERIVED>::value) {
+                return DERIVED::kind_value;
+            } else {
+                throw sym_error(sym_error::AbstractClass);
+            }
+        }
+
         /// Return true if this is a terminal node
         [[nodiscard]] bool is_terminal() const override { return true; }
     };
@@ -0,0 +1,216 @@
+// thread_pool.cpp
+
+// C++
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+// Internal
+#include <sympp/core/arena.h>
+#include <sympp/core/simplifier.h>
+#include <sympp/core/simplify_memo.h>
+#include <sympp/core/sym.h>
+#include <sympp/core/thread_pool.h>
+
+namespace sympp {
+
+    thread_local thread_pool::worker_queue *thread_pool::local_{nullptr};
+
+    thread_pool::thread_pool(size_t workers) {
+        // the last queue is shared by the threads outside the pool
+        queues_.reserve(workers + 1);
+        for (size_t i = 0; i < workers + 1; ++i) {
+            queues_.emplace_back(std::make_unique<worker_queue>(this));
+        }
+        workers_.reserve(workers);
+        for (size_t i = 0; i < workers; ++i) {
+            workers_.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    thread_pool::~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        ready_.notify_all();
+        for (std::thread &worker : workers_) {
+            worker.join();
+        }
+    }
+
+    size_t thread_pool::size() const { return workers_.size(); }
+
+    void thread_pool::for_each(size_t n, const std::function<void(size_t)> &f) {
+        std::atomic<size_t> remaining{n};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+        auto run = [&](size_t i) {
+            try {
+                f(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            remaining.fetch_sub(1, std::memory_order_acq_rel);
+        };
+        if (workers_.empty() || n < 2) {
+            for (size_t i = 0; i < n; ++i) {
+                run(i);
+            }
+        } else {
+            for (size_t i = 1; i < n; ++i) {
+                push([&run, i] { run(i); });
+            }
+            run(0);
+            // help with the other tasks while ours are running
+            while (remaining.load(std::memory_order_acquire) != 0) {
+                if (!run_one()) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    thread_pool &thread_pool::global() {
+        static thread_pool pool(
+            std::max(std::thread::hardware_concurrency(), 1U) - 1);
+        return pool;
+    }
+
+    thread_pool::worker_queue *thread_pool::local_queue() const {
+        return local_ && local_->owner == this ? local_ : nullptr;
+    }
+
+    void thread_pool::push(task t) {
+        worker_queue *local = local_queue();
+        worker_queue *q = local ? local : queues_.back().get();
+        {
+            std::lock_guard<std::mutex> lock(q->mutex);
+            q->tasks.emplace_back(std::move(t));
+        }
+        pending_.fetch_add(1, std::memory_order_release);
+        {
+            // the workers check pending_ while holding the mutex
+            std::lock_guard<std::mutex> lock(mutex_);
+        }
+        ready_.notify_one();
+    }
+
+    bool thread_pool::run_one() {
+        task t;
+        // our own tasks are the most recent ones, so they are still
+        // in the cache
+        worker_queue *local = local_queue();
+        if (local) {
+            std::lock_guard<std::mutex> lock(local->mutex);
+            if (!local->tasks.empty()) {
+                t = std::move(local->tasks.back());
+                local->tasks.pop_back();
+            }
+        }
+        // steal the oldest tasks from the other queues
+        for (size_t i = 0; !t && i < queues_.size(); ++i) {
+            worker_queue &q = *queues_[i];
+            if (&q == local) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tasks.empty()) {
+                t = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+        }
+        if (!t) {
+            return false;
+        }
+        pending_.fetch_sub(1, std::memory_order_acq_rel);
+        t();
+        return true;
+    }
+
+    void thread_pool::work(size_t index) {
+        local_ = queues_[index].get();
+        for (;;) {
+            if (run_one()) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this] {
+                return stop_ || pending_.load(std::memory_order_acquire) != 0;
+            });
+            if (stop_ && pending_.load(std::memory_order_acquire) == 0) {
+                return;
+            }
+        }
+    }
+
+    thread_local const parallel_scope *parallel_scope::current_{nullptr};
+
+    parallel_scope::parallel_scope(size_t threshold)
+        : parallel_scope(thread_pool::global(), threshold) {}
+
+    parallel_scope::parallel_scope(thread_pool &pool, size_t threshold)
+        : pool_(pool), threshold_(std::max<size_t>(threshold, 1)),
+          previous_(current_) {
+        current_ = this;
+    }
+
+    parallel_scope::~parallel_scope() { current_ = previous_; }
+
+    const parallel_scope *parallel_scope::current() { return current_; }
+
+    void parallel_scope::for_each_child(std::vector<sym> &children,
+                                        const std::function<void(sym &)> &f) {
+        const parallel_scope *scope = current_;
+        // The budget of a driver, the simplify memo and the arena
+        // belong to this thread and are not thread-safe, so the
+        // children run here while any of them is active
+        const bool thread_context = simplifier::running() ||
+                                    simplify_memo::current() ||
+                                    arena::current();
+        if (!scope || scope->pool_.size() == 0 || children.size() < 2 ||
+            thread_context) {
+            for (sym &child : children) {
+                f(child);
+            }
+            return;
+        }
+        // split the children into batches of about threshold operations
+        std::vector<size_t> bounds{0};
+        size_t ops = 0;
+        for (size_t i = 0; i < children.size(); ++i) {
+            ops += std::as_const(children[i]).count_ops();
+            if (ops >= scope->threshold_) {
+                bounds.emplace_back(i + 1);
+                ops = 0;
+            }
+        }
+        if (bounds.back() != children.size()) {
+            bounds.emplace_back(children.size());
+        }
+        if (bounds.size() < 3) {
+            for (sym &child : children) {
+                f(child);
+            }
+            return;
+        }
+        scope->pool_.for_each(bounds.size() - 1, [&](size_t b) {
+            // the children of the children run on the pool too
+            struct restore {
+                const parallel_scope *previous{current_};
+                ~restore() { current_ = previous; }
+            } r;
+            current_ = scope;
+            for (size_t i = bounds[b]; i < bounds[b + 1]; ++i) {
+                f(children[i]);
+            }
+        });
+    }
+
+} // namespace sympp
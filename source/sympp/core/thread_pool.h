@@ -0,0 +1,156 @@
+// thread_pool.h
+
+#ifndef SYMPP_THREAD_POOL_H
+#define SYMPP_THREAD_POOL_H
+
+// C++
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sympp {
+    class sym;
+
+    namespace execution {
+        /// \class Execution policy for the parallel transforms
+        /// We use our own tag rather than std::execution::par because
+        /// <execution> requires linking TBB on some standard libraries.
+        struct parallel_policy {};
+
+        /// Run a transform on the thread pool
+        inline constexpr parallel_policy par{};
+    } // namespace execution
+
+    /// \class Work-stealing thread pool
+    /// Each worker has its own queue of tasks. Workers push and pop
+    /// the tasks they create at the back of their own queue and steal
+    /// from the front of the other queues when theirs is empty.
+    /// A thread waiting for its tasks runs other tasks in the meantime,
+    /// so nested parallel loops do not deadlock.
+    class thread_pool {
+      public:
+        /// Task
+        using task = std::function<void()>;
+
+        /// Pool with a number of workers
+        /// The thread calling for_each also runs tasks, so a pool with
+        /// no workers runs everything in the calling thread.
+        explicit thread_pool(size_t workers);
+
+        thread_pool(const thread_pool &) = delete;
+
+        thread_pool &operator=(const thread_pool &) = delete;
+
+        /// Wait for the workers to finish their tasks and join them
+        ~thread_pool();
+
+        /// Number of workers
+        [[nodiscard]] size_t size() const;
+
+        /// Run f(0), ..., f(n-1) on the pool and wait for them
+        /// If any call throws, the first exception is rethrown after
+        /// all calls have finished.
+        void for_each(size_t n, const std::function<void(size_t)> &f);
+
+        /// Pool with one worker per hardware thread besides the caller
+        static thread_pool &global();
+
+      private:
+        /// Queue of a worker
+        struct worker_queue {
+            explicit worker_queue(const thread_pool *p) : owner(p) {}
+            const thread_pool *owner;
+            std::mutex mutex;
+            std::deque<task> tasks;
+        };
+
+        /// Queue of this thread if it is a worker of this pool
+        /// A worker of another pool can run a loop on this pool, and
+        /// its queue is not one the workers of this pool look at.
+        [[nodiscard]] worker_queue *local_queue() const;
+
+        /// Push a task to the queue of this thread
+        void push(task);
+
+        /// Pop a task from this thread's queue or steal one
+        /// \return True if we ran a task
+        bool run_one();
+
+        /// Loop of a worker
+        void work(size_t index);
+
+      private:
+        /// One queue per worker and one for the other threads
+        std::vector<std::unique_ptr<worker_queue>> queues_;
+
+        /// Workers
+        std::vector<std::thread> workers_;
+
+        /// Number of tasks in the queues
+        std::atomic<size_t> pending_{0};
+
+        /// Wake up the workers when there are tasks
+        std::mutex mutex_;
+        std::condition_variable ready_;
+        bool stop_{false};
+
+        /// Queue of the worker running in this thread, of any pool
+        static thread_local worker_queue *local_;
+    };
+
+    /// \class Scope of a parallel transform
+    /// While a scope is alive, the transforms that walk the children
+    /// of a node run the children on a thread pool. The children are
+    /// split into batches of about threshold operations, so small
+    /// subtrees are not worth a task of their own. Each child is only
+    /// transformed by one task, so the result does not depend on the
+    /// order the tasks run.
+    /// While a simplify driver, a simplify memo or an arena is active
+    /// in the calling thread, the children run sequentially in that
+    /// thread, because the other threads cannot share them.
+    class parallel_scope {
+      public:
+        /// Run the children on the global pool
+        explicit parallel_scope(size_t threshold = 512);
+
+        /// Run the children on a pool supplied by the caller
+        parallel_scope(thread_pool &, size_t threshold = 512);
+
+        parallel_scope(const parallel_scope &) = delete;
+
+        parallel_scope &operator=(const parallel_scope &) = delete;
+
+        /// Restore the previous scope
+        ~parallel_scope();
+
+        /// Innermost scope in this thread
+        /// This is nullptr if there is no scope
+        [[nodiscard]] static const parallel_scope *current();
+
+        /// Apply a function to each child of a node
+        /// Outside a parallel scope, this is a sequential loop.
+        static void for_each_child(std::vector<sym> &,
+                                   const std::function<void(sym &)> &);
+
+      private:
+        /// Pool running the tasks
+        thread_pool &pool_;
+
+        /// Number of operations in a batch of children
+        size_t threshold_;
+
+        /// Scope we should restore when this scope is destroyed
+        const parallel_scope *previous_;
+
+        /// Innermost scope in this thread
+        static thread_local const parallel_scope *current_;
+    };
+} // namespace sympp
+
+#endif // SYMPP_THREAD_POOL_H
@@ -0,0 +1,129 @@
+// C++
+#include <algorithm>
+
+// Internal
+#include <sympp/core/node_interface.h>
+#include <sympp/core/sym.h>
+#include <sympp/core/unique_table.h>
+#include <sympp/node/terminal/constant.h>
+
+namespace sympp {
+
+    std::atomic<bool> unique_table::enabled_{false};
+
+    std::unordered_multimap<size_t, std::weak_ptr<node_interface>>
+        unique_table::table_;
+
+    std::atomic<size_t> unique_table::lookups_{0};
+
+    std::atomic<size_t> unique_table::hits_{0};
+
+    std::mutex unique_table::mutex_;
+
+    void unique_table::enable(bool v) {
+        enabled_.store(v, std::memory_order_relaxed);
+    }
+
+    bool unique_table::enabled() {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    std::shared_ptr<node_interface>
+    unique_table::intern(const std::shared_ptr<node_interface> &n) {
+        const size_t h = n->hash();
+        std::lock_guard<std::mutex> lock(mutex_);
+        lookups_.fetch_add(1, std::memory_order_relaxed);
+        auto [first, last] = table_.equal_range(h);
+        for (auto it = first; it != last;) {
+            std::shared_ptr<node_interface> candidate = it->second.lock();
+            if (!candidate) {
+                it = table_.erase(it);
+                continue;
+            }
+            if (candidate == n || identical(*candidate, *n)) {
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return candidate;
+            }
+            ++it;
+        }
+        table_.emplace(h, n);
+        return n;
+    }
+
+    size_t unique_table::size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        remove_expired();
+        return table_.size();
+    }
+
+    void unique_table::purge() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        remove_expired();
+    }
+
+    size_t unique_table::lookups() {
+        return lookups_.load(std::memory_order_relaxed);
+    }
+
+    size_t unique_table::hits() {
+        return hits_.load(std::memory_order_relaxed);
+    }
+
+    double unique_table::hit_rate() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const size_t lookups = lookups_.load(std::memory_order_relaxed);
+        if (lookups == 0) {
+            return 0.;
+        }
+        return static_cast<double>(hits_.load(std::memory_order_relaxed)) /
+               static_cast<double>(lookups);
+    }
+
+    void unique_table::clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        table_.clear();
+        lookups_.store(0, std::memory_order_relaxed);
+        hits_.store(0, std::memory_order_relaxed);
+    }
+
+    bool unique_table::identical(const node_interface &a,
+                                 const node_interface &b) {
+        if (&a == &b) {
+            return true;
+        }
+        if (a.type() != b.type() ||
+            a.is_commutative() != b.is_commutative() || a.compare(b) != 0) {
+            return false;
+        }
+        if (a.is_terminal()) {
+            // constants with the same value compare equal
+            // but we still need to keep their names
+            if (a.kind() == node_kind::constant) {
+                return static_cast<const constant &>(a).name_id() ==
+                       static_cast<const constant &>(b).name_id();
+            }
+            return true;
+        }
+        // compare ignores the order of commutative children
+        // but identical nodes need the children in the same order
+        if (a.size() != b.size()) {
+            return false;
+        }
+        return std::equal(a.begin(), a.end(), b.begin(),
+                          [](const sym &x, const sym &y) {
+                              return identical(*x.root_node(),
+                                               *y.root_node());
+                          });
+    }
+
+    void unique_table::remove_expired() {
+        for (auto it = table_.begin(); it != table_.end();) {
+            if (it->second.expired()) {
+                it = table_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+} // namespace sympp
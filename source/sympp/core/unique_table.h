@@ -0,0 +1,88 @@
+// unique_table.h
+
+#ifndef SYMPP_UNIQUE_TABLE_H
+#define SYMPP_UNIQUE_TABLE_H
+
+// C++
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace sympp {
+    // forward declarations
+    class node_interface;
+
+    /// \class Unique node table
+    /// Table of nodes for hash-consing.
+    /// When the table is enabled, every sym constructed from a
+    /// node looks for an identical node in the table before
+    /// keeping its own copy. Identical subexpressions are then
+    /// stored only once and comparing them is a pointer check.
+    /// Shared nodes are never modified in place because syms
+    /// clone shared nodes before modifying them.
+    /// The table only keeps weak references, so nodes are still
+    /// destroyed when no sym uses them anymore.
+    class unique_table {
+      public:
+        /// Enable or disable hash-consing for new nodes
+        /// This is disabled by default
+        static void enable(bool);
+
+        /// True if new nodes are being hash-consed
+        [[nodiscard]] static bool enabled();
+
+        /// Return a node identical to the argument from the table
+        /// If there is no such node, the argument is inserted and returned
+        static std::shared_ptr<node_interface>
+        intern(const std::shared_ptr<node_interface> &);
+
+        /// Number of nodes alive in the table
+        [[nodiscard]] static size_t size();
+
+        /// Number of times we looked for a node in the table
+        [[nodiscard]] static size_t lookups();
+
+        /// Number of times we found an identical node in the table
+        [[nodiscard]] static size_t hits();
+
+        /// Ratio between hits and lookups
+        [[nodiscard]] static double hit_rate();
+
+        /// Remove all nodes from the table and reset the counters
+        static void clear();
+
+        /// Remove the nodes that have already been destroyed
+        static void purge();
+
+        /// True if two nodes represent exactly the same tree
+        /// This is stricter than compare, which considers
+        /// numbers of different types and commutative
+        /// children in different orders to be equal.
+        static bool identical(const node_interface &, const node_interface &);
+
+      private:
+        /// Remove the nodes that have been destroyed
+        static void remove_expired();
+
+      private:
+        /// Hash-consing state
+        /// The flag and the counters are atomic so they can be read
+        /// without the lock while other threads intern nodes
+        static std::atomic<bool> enabled_;
+
+        /// Nodes indexed by their hash
+        static std::unordered_multimap<size_t, std::weak_ptr<node_interface>>
+            table_;
+
+        /// Counters
+        static std::atomic<size_t> lookups_;
+        static std::atomic<size_t> hits_;
+
+        /// Protect the table
+        static std::mutex mutex_;
+    };
+} // namespace sympp
+
+#endif // SYMPP_UNIQUE_TABLE_H
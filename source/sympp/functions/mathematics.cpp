@@ -4,6 +4,7 @@
 
 #include "mathematics.h"
 #include <sympp/core/sym.h>
+#include <sympp/core/sym_builder.h>
 #include <sympp/functions/operators.h>
 #include <sympp/node/function/cos.h>
 #include <sympp/node/function/log.h>
@@ -27,4 +28,26 @@ namespace sympp {
 
     sym sqrt(const sym &s) { return sym(sympp::pow(s, sym(0.5))); }
 
+    sym sum(const std::vector<sym> &v) { return sum(std::vector<sym>(v)); }
+
+    sym sum(std::vector<sym> &&v) {
+        sym_builder b(node_kind::summation);
+        b.reserve(v.size());
+        for (auto &s : v) {
+            b.push_back(std::move(s));
+        }
+        return b.build();
+    }
+
+    sym prod(const std::vector<sym> &v) { return prod(std::vector<sym>(v)); }
+
+    sym prod(std::vector<sym> &&v) {
+        sym_builder b(node_kind::product);
+        b.reserve(v.size());
+        for (auto &s : v) {
+            b.push_back(std::move(s));
+        }
+        return b.build();
+    }
+
 } // namespace sympp
\ No newline at end of file
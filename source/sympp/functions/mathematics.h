@@ -7,6 +7,8 @@
 
 // C++
 #include <iostream>
+#include <iterator>
+#include <vector>
 
 // Internal
 #include <sympp/core/sym.h>
@@ -42,6 +44,28 @@ namespace sympp {
 
     sym expand(const node_interface &);
 
+    /// Sum of all terms in a single summation node
+    sym sum(const std::vector<sym> &);
+
+    /// Sum of all terms, stealing their nodes
+    sym sum(std::vector<sym> &&);
+
+    /// Sum of all elements in a range
+    template <class RANGE> sym sum(const RANGE &r) {
+        return sum(std::vector<sym>(std::begin(r), std::end(r)));
+    }
+
+    /// Product of all factors in a single product node
+    sym prod(const std::vector<sym> &);
+
+    /// Product of all factors, stealing their nodes
+    sym prod(std::vector<sym> &&);
+
+    /// Product of all elements in a range
+    template <class RANGE> sym prod(const RANGE &r) {
+        return prod(std::vector<sym>(std::begin(r), std::end(r)));
+    }
+
 } // namespace sympp
 
 #endif // SYMPP_MATHEMATICS_H
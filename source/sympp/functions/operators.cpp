@@ -11,6 +11,7 @@
 #include <sympp/node/function/sin.h>
 #include <sympp/node/operation/summation.h>
 #include <sympp/node/terminal/constant.h>
+#include <utility>
 
 namespace sympp {
     std::ostream &operator<<(std::ostream &o, const sym &s) {
@@ -29,6 +30,18 @@ namespace sympp {
         return sym(summation(s1, s2));
     }
 
+    sym operator+(sym &&s1, sym &&s2) {
+        return sym(summation(std::move(s1), std::move(s2)));
+    }
+
+    sym operator+(sym &&s1, const sym &s2) {
+        return sym(summation(std::move(s1), sym(s2)));
+    }
+
+    sym operator+(const sym &s1, sym &&s2) {
+        return sym(summation(sym(s1), std::move(s2)));
+    }
+
     sym operator+(const node_interface &s1, const sym &s2) {
         return sym(summation(sym(s1), s2));
     }
@@ -57,17 +70,18 @@ namespace sympp {
     }
 
     sym &operator+=(sym &s1, const sym &s2) {
-        s1 = s1 + s2;
+        // steal the terms of s1 if no other sym shares them
+        s1 = std::move(s1) + s2;
         return s1;
     }
 
     sym &operator+=(sym &s1, const int &s2) {
-        s1 = s1 + s2;
+        s1 = std::move(s1) + sym(s2);
         return s1;
     }
 
     sym &operator+=(sym &s1, const double &s2) {
-        s1 = s1 + s2;
+        s1 = std::move(s1) + sym(s2);
         return s1;
     }
 
@@ -77,6 +91,10 @@ namespace sympp {
         return sym(summation(s1, -s2));
     }
 
+    sym operator-(sym &&s1, const sym &s2) {
+        return sym(summation(std::move(s1), -s2));
+    }
+
     sym operator-(const node_interface &s1, const sym &s2) {
         return sym(summation(sym(s1), -s2));
     }
@@ -105,22 +123,34 @@ namespace sympp {
     }
 
     sym &operator-=(sym &s1, const sym &s2) {
-        s1 = s1 - s2;
+        s1 = std::move(s1) - s2;
         return s1;
     }
 
     sym &operator-=(sym &s1, const int &s2) {
-        s1 = s1 - s2;
+        s1 = std::move(s1) - sym(s2);
         return s1;
     }
 
     sym &operator-=(sym &s1, const double &s2) {
-        s1 = s1 - s2;
+        s1 = std::move(s1) - sym(s2);
         return s1;
     }
 
     sym operator*(const sym &s1, const sym &s2) { return sym(product(s1, s2)); }
 
+    sym operator*(sym &&s1, sym &&s2) {
+        return sym(product(std::move(s1), std::move(s2)));
+    }
+
+    sym operator*(sym &&s1, const sym &s2) {
+        return sym(product(std::move(s1), sym(s2)));
+    }
+
+    sym operator*(const sym &s1, sym &&s2) {
+        return sym(product(sym(s1), std::move(s2)));
+    }
+
     sym operator*(const node_interface &s1, const sym &s2) {
         return sym(product(sym(s1), s2));
     }
@@ -138,17 +168,17 @@ namespace sympp {
     sym operator*(const sym &s1, const double &s2) { return s1 * sym(s2); }
 
     sym &operator*=(sym &s1, const sym &s2) {
-        s1 = s1 * s2;
+        s1 = std::move(s1) * s2;
         return s1;
     }
 
     sym &operator*=(sym &s1, const int &s2) {
-        s1 = s1 * s2;
+        s1 = std::move(s1) * sym(s2);
         return s1;
     }
 
     sym &operator*=(sym &s1, const double &s2) {
-        s1 = s1 * s2;
+        s1 = std::move(s1) * sym(s2);
         return s1;
     }
 
@@ -188,7 +218,8 @@ namespace sympp {
     }
 
     bool operator==(const sym &s1, const sym &s2) {
-        return s1.compare(s2) == 0;
+        // different hashes cannot be equal
+        return s1.hash() == s2.hash() && s1.compare(s2) == 0;
     }
 
     bool operator==(const node_interface &s1, const sym &s2) {
@@ -210,7 +241,7 @@ namespace sympp {
     }
 
     bool operator!=(const sym &s1, const sym &s2) {
-        return s1.compare(s2) != 0;
+        return !(s1 == s2);
     }
 
     bool operator!=(const node_interface &s1, const sym &s2) {
@@ -23,6 +23,12 @@ namespace sympp {
 
     sym operator+(const sym &, const sym &);
 
+    sym operator+(sym &&, sym &&);
+
+    sym operator+(sym &&, const sym &);
+
+    sym operator+(const sym &, sym &&);
+
     sym operator+(const node_interface &, const sym &);
 
     sym operator+(const sym &, const node_interface &);
@@ -61,6 +67,8 @@ namespace sympp {
 
     sym operator-(const sym &, const sym &);
 
+    sym operator-(sym &&, const sym &);
+
     sym operator-(const node_interface &, const sym &);
 
     sym operator-(const sym &, const node_interface &);
@@ -85,6 +93,12 @@ namespace sympp {
 
     sym operator*(const sym &, const sym &);
 
+    sym operator*(sym &&, sym &&);
+
+    sym operator*(sym &&, const sym &);
+
+    sym operator*(const sym &, sym &&);
+
     sym operator*(const node_interface &, const sym &);
 
     sym operator*(const sym &, const node_interface &);
@@ -131,7 +131,7 @@ namespace sympp {
         }
 
         if (s.is_number()) {
-            auto p = s.root_node_as<number_interface>();
+            auto p = s.node_as<number_interface>();
             if (p->is_negative()) {
                 return -1 * s;
             } else {
@@ -145,4 +145,6 @@ namespace sympp {
         return dynamic_cast<node_interface *>(new abs(*this));
     }
 
+    node_kind abs::calculate_kind() const { return kind_value; }
+
 } // namespace sympp
\ No newline at end of file
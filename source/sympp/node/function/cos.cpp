@@ -117,7 +117,7 @@ namespace sympp {
                 return sym(integer(1));
             }
             if (s.is_real_number()) {
-                auto p = s.root_node_as<number_interface>();
+                auto p = s.node_as<number_interface>();
                 return sym(real(std::cos(p->operator double())));
             }
         }
@@ -137,4 +137,6 @@ namespace sympp {
         return dynamic_cast<node_interface *>(new cos(*this));
     }
 
+    node_kind cos::calculate_kind() const { return kind_value; }
+
 } // namespace sympp
\ No newline at end of file
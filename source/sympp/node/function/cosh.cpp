@@ -117,7 +117,7 @@ namespace sympp {
                 return sym(integer(1));
             }
             if (s.is_real_number()) {
-                auto p = s.root_node_as<number_interface>();
+                auto p = s.node_as<number_interface>();
                 return sym(real(std::cosh(p->operator double())));
             }
         }
@@ -139,4 +139,6 @@ namespace sympp {
         return dynamic_cast<node_interface *>(new cosh(*this));
     }
 
+    node_kind cosh::calculate_kind() const { return kind_value; }
+
 } // namespace sympp
\ No newline at end of file
@@ -53,6 +53,17 @@ namespace sympp {
 
     function_interface::~function_interface() = default;
 
+    int function_interface::compare(const node_interface &s) const {
+        // functions without their own kind are ordered by name
+        if (kind() == node_kind::function && s.kind() == node_kind::function) {
+            const auto &rhs = static_cast<const function_interface &>(s);
+            if (name_ != rhs.name_) {
+                return (name_ < rhs.name_) ? -1 : +1;
+            }
+        }
+        return internal_node_interface<function_interface>::compare(s);
+    }
+
     sym function_interface::coeff(const node_interface &term) const {
         if (this->compare(term)) {
             return sym(1);
@@ -101,7 +112,7 @@ namespace sympp {
             }
         }
         if (!child_nodes_.empty()) {
-            const bool is_variable = type() == typeid(variable);
+            const bool is_variable = kind() == node_kind::variable;
             os << ((is_variable) ? "[" : "(");
             child_nodes_.front().stream(os, symbolic_format);
             for (i = ++child_nodes_.begin(); i != child_nodes_.end(); ++i) {
@@ -114,6 +125,11 @@ namespace sympp {
 
     bool function_interface::is_commutative() const { return is_commutative_; }
 
+    node_kind function_interface::calculate_kind() const {
+        // functions that don't declare their own kind
+        return node_kind::function;
+    }
+
     std::optional<sym> function_interface::subs(const sym &x, const int &y) {
         auto r = this->subs(x, sym(y));
         if (r) {
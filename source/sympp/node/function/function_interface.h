@@ -38,6 +38,7 @@ namespace sympp {
         ~function_interface() override;
 
       public /* implement node interface */:
+        [[nodiscard]] int compare(const node_interface &s) const override;
         [[nodiscard]] sym coeff(const node_interface &term) const override;
         [[nodiscard]] std::optional<sym> subs(const sym &x,
                                               const sym &y) override;
@@ -45,6 +46,7 @@ namespace sympp {
       public /* override internal node interface */:
         void stream(std::ostream &os, bool symbolic_format) const override;
         [[nodiscard]] bool is_commutative() const override;
+        [[nodiscard]] node_kind calculate_kind() const override;
       public /* specific to function_node */:
         std::optional<sym> subs(const sym &x, const int &y);
         std::optional<sym> subs(const sym &x, const double &y);
@@ -31,7 +31,7 @@ namespace sympp {
     double log::evaluate(const std::vector<uint8_t> &bool_values,
                          const std::vector<int> &int_values,
                          const std::vector<double> &double_values) const {
-        if (child_nodes_.back().compare(constant::e()) != 0) {
+        if (!constant::is_e(child_nodes_.back())) {
             return std::log(child_nodes_.front().evaluate(
                        bool_values, int_values, double_values)) /
                    std::log(child_nodes_.back().evaluate(
@@ -57,7 +57,7 @@ namespace sympp {
     node_lambda log::lambdify() const {
         node_lambda x_lambda =
             this->child_nodes_.front().root_node()->lambdify();
-        if (child_nodes_.back().compare(constant::e()) != 0) {
+        if (!constant::is_e(child_nodes_.back())) {
             node_lambda b_lambda =
                 this->child_nodes_.back().root_node()->lambdify();
             return [x_lambda, b_lambda](
@@ -281,7 +281,7 @@ namespace sympp {
         }
 
         // log_a(a^c) -> c
-        if (b.type() == typeid(pow)) {
+        if (b.kind() == node_kind::pow) {
             auto p = b.root_node_as<pow>();
             if (p->child_nodes_.front().compare(a) == 0) {
                 return p->child_nodes_.back();
@@ -297,7 +297,7 @@ namespace sympp {
         }
 
         // log_e(b) -> log(b) * ln(a)^-1
-        if (a.compare(constant::e()) == 0 && b.is_number()) {
+        if (constant::is_e(a) && b.is_number()) {
             product p(sym(real(std::log(b.operator double()))),
                       sym(pow(ln(a), sym(-1))));
             auto s = p.simplify(ratio, func);
@@ -321,9 +321,11 @@ namespace sympp {
         return dynamic_cast<node_interface *>(new log(*this));
     }
 
+    node_kind log::calculate_kind() const { return kind_value; }
+
     void log::stream(std::ostream &os, bool symbolic_format) const {
         if (child_nodes_.size() == 2 &&
-            child_nodes_.back().compare(constant::e()) == 0) {
+            constant::is_e(child_nodes_.back())) {
             os << "ln(";
             child_nodes_.front().stream(os, symbolic_format);
             os << ")";
@@ -12,6 +12,9 @@ namespace sympp {
     class product;
     class log : public function_interface {
       public:
+        /// Kind of this node type
+        static constexpr node_kind kind_value = node_kind::log;
+
         friend class product;
 
       public:
@@ -39,6 +42,7 @@ namespace sympp {
       public /* override internal node interface */:
         [[nodiscard]] const std::type_info &type() const override;
         [[nodiscard]] node_interface *clone() const override;
+        [[nodiscard]] node_kind calculate_kind() const override;
       public /* override function interface */:
         std::optional<sym> simplify(double ratio,
                                     complexity_lambda func) override;
@@ -4,9 +4,11 @@
 
 // C++
 #include <cmath>
+#include <utility>
 
 // Internal
 #include "pow.h"
+#include <sympp/core/sparse_polynomial.h>
 #include <sympp/core/sym.h>
 #include <sympp/functions/operators.h>
 #include <sympp/functions/symbolic.h>
@@ -34,26 +36,24 @@ namespace sympp {
     double pow::evaluate(const std::vector<uint8_t> &bool_values,
                          const std::vector<int> &int_values,
                          const std::vector<double> &double_values) const {
-        if (this->child_nodes_.front().compare(constant::e()) == 0) {
-            double e = 2.71828182845;
-            auto exponent = this->child_nodes_.back().root_node();
-            return std::pow(
-                e, exponent->evaluate(bool_values, int_values, double_values));
-        } else {
-            auto base_node = this->child_nodes_.front().root_node();
-            auto exponent_node = this->child_nodes_.back().root_node();
-            double base =
-                base_node->evaluate(bool_values, int_values, double_values);
-            double exponent =
-                exponent_node->evaluate(bool_values, int_values, double_values);
-            return std::pow(base, exponent);
-        }
+        const lowering l = lower();
+        const double exponent =
+            l.op == lowering::general || l.op == lowering::exp
+                ? this->child_nodes_.back().root_node()->evaluate(
+                      bool_values, int_values, double_values)
+                : 0.;
+        const double base =
+            l.op != lowering::exp
+                ? this->child_nodes_.front().root_node()->evaluate(
+                      bool_values, int_values, double_values)
+                : 0.;
+        return evaluate(l, base, exponent);
     }
 
     sym pow::evaluate_sym(const std::vector<uint8_t> &bool_values,
                           const std::vector<int> &int_values,
                           const std::vector<double> &double_values) const {
-        if (this->child_nodes_.front().compare(constant::e()) == 0) {
+        if (constant::is_e(this->child_nodes_.front())) {
             return sym(pow(constant::e(),
                            this->child_nodes_.back().root_node()->evaluate_sym(
                                bool_values, int_values, double_values)));
@@ -66,26 +66,85 @@ namespace sympp {
     }
 
     node_lambda pow::lambdify() const {
-        node_lambda base_fn;
-        node_lambda exponent_fn;
+        const lowering l = lower();
+        node_lambda base_fn = child_nodes_.front().root_node()->lambdify();
+        node_lambda exponent_fn =
+            this->child_nodes_.back().root_node()->lambdify();
+        switch (l.op) {
+        case lowering::integer:
+        case lowering::square_root:
+            return [l, base_fn](const std::vector<uint8_t> &bool_values,
+                                const std::vector<int> &int_values,
+                                const std::vector<double> &double_values) {
+                return evaluate(
+                    l, base_fn(bool_values, int_values, double_values), 0.);
+            };
+        case lowering::exp:
+            return [exponent_fn](const std::vector<uint8_t> &bool_values,
+                                 const std::vector<int> &int_values,
+                                 const std::vector<double> &double_values) {
+                return std::exp(
+                    exponent_fn(bool_values, int_values, double_values));
+            };
+        default:
+            return [base_fn, exponent_fn](
+                       const std::vector<uint8_t> &bool_values,
+                       const std::vector<int> &int_values,
+                       const std::vector<double> &double_values) -> double {
+                return std::pow(
+                    base_fn(bool_values, int_values, double_values),
+                    exponent_fn(bool_values, int_values, double_values));
+            };
+        }
+    }
 
-        if (this->child_nodes_.front().compare(constant::e()) == 0) {
-            real e_val(2.71828182845);
-            base_fn = e_val.lambdify();
-        } else {
-            base_fn = child_nodes_.front().root_node()->lambdify();
+    pow::lowering pow::lower() const {
+        const sym &base = this->child_nodes_.front();
+        const sym &exponent = this->child_nodes_.back();
+        if (constant::is_e(base)) {
+            return {lowering::exp, 0};
         }
+        if (!exponent.is_number()) {
+            return {};
+        }
+        const auto n =
+            static_cast<double>(*exponent.node_as<number_interface>());
+        if (n == std::floor(n) && std::abs(n) <= max_integer_exponent) {
+            return {lowering::integer, static_cast<int>(n)};
+        }
+        if (std::abs(n) == 0.5) {
+            return {lowering::square_root, n > 0 ? 1 : -1};
+        }
+        return {};
+    }
 
-        exponent_fn = this->child_nodes_.back().root_node()->lambdify();
+    double pow::integer_power(double x, int n) {
+        unsigned k = n < 0 ? -static_cast<unsigned>(n) : n;
+        double r = 1.;
+        // square x for each bit of the exponent
+        while (k != 0) {
+            if (k & 1U) {
+                r *= x;
+            }
+            k >>= 1U;
+            if (k != 0) {
+                x *= x;
+            }
+        }
+        return n < 0 ? 1. / r : r;
+    }
 
-        return [base_fn, exponent_fn](
-                   const std::vector<uint8_t> &bool_values,
-                   const std::vector<int> &int_values,
-                   const std::vector<double> &double_values) -> double {
-            return std::pow(
-                base_fn(bool_values, int_values, double_values),
-                exponent_fn(bool_values, int_values, double_values));
-        };
+    double pow::evaluate(const lowering &l, double base, double exponent) {
+        switch (l.op) {
+        case lowering::integer:
+            return integer_power(base, l.exponent);
+        case lowering::square_root:
+            return l.exponent > 0 ? std::sqrt(base) : 1. / std::sqrt(base);
+        case lowering::exp:
+            return std::exp(exponent);
+        default:
+            return std::pow(base, exponent);
+        }
     }
 
     void pow::c_code(int &function_level, int &sum_level, int &prod_level,
@@ -301,7 +360,7 @@ namespace sympp {
             // c^n -> c*c*c*c
             // c^{-n} -> 1/(c*c*c*c)
             if (n.is_integer_number()) {
-                int n_as_int = n.root_node_as<integer>()->operator int();
+                int n_as_int = n.node_as<integer>()->operator int();
                 bool invert = n_as_int < 0;
                 auto positive_n =
                     static_cast<unsigned int>(invert ? -n_as_int : n_as_int);
@@ -315,6 +374,15 @@ namespace sympp {
                     positive_n >>= 1U;
                 }
                 if (invert) {
+                    // 1/c would be the power c^{-1} again, so we
+                    // calculate the reciprocal of the number here
+                    result.simplify();
+                    if (result.is_number()) {
+                        return sparse_polynomial::coefficient::from_number(
+                                   result)
+                            .power(-1)
+                            .to_sym();
+                    }
                     return (sym(integer(1)) / result);
                 } else {
                     return result;
@@ -324,8 +392,8 @@ namespace sympp {
 
         // b^{log_x(b)} -> x
         if (n.is<log>()) {
-            if (n.begin()->compare(b) == 0) {
-                return *std::prev(n.end());
+            if (std::as_const(n).begin()->compare(b) == 0) {
+                return *std::prev(std::as_const(n).end());
             }
         }
 
@@ -347,6 +415,8 @@ namespace sympp {
         return dynamic_cast<node_interface *>(new pow(*this));
     }
 
+    node_kind pow::calculate_kind() const { return kind_value; }
+
     void pow::stream(std::ostream &os, bool symbolic_format) const {
         if (*this == constant::i()) {
             os << "i";
@@ -385,7 +455,7 @@ namespace sympp {
                 os << ")";
             }
         } else {
-            if (child_nodes_.front().compare(constant::e()) == 0) {
+            if (constant::is_e(child_nodes_.front())) {
                 os << "std::exp(";
                 child_nodes_.front().stream(os, symbolic_format);
                 child_nodes_.back().stream(os, symbolic_format);
@@ -441,27 +511,29 @@ namespace sympp {
     std::optional<sym> pow::expand_power_exp() {
         // a^(b+c) == a^b a^c  when b and c is_commutative
         const sym &b = child_nodes_.front();
-        sym &n = child_nodes_.back();
+        const sym &n = child_nodes_.back();
         if (n.is_summation()) {
-            product p;
-            for (auto &&t : n) {
-                p.child_nodes_.emplace_back(pow(b, t));
+            std::vector<sym> factors;
+            factors.reserve(n.size());
+            for (const sym &t : n) {
+                factors.emplace_back(pow(b, t));
             }
-            return sym(std::move(p));
+            return sym(product(std::move(factors)));
         }
         return std::nullopt;
     }
 
     std::optional<sym> pow::expand_power_base() {
         // (a*b)^c == a^c b^c  when a and b is_commutative
-        sym &b = child_nodes_.front();
+        const sym &b = child_nodes_.front();
         const sym &n = child_nodes_.back();
         if (b.is_product()) {
-            product r;
-            for (auto &&t : b) {
-                r.child_nodes_.emplace_back(pow(t, n));
+            std::vector<sym> factors;
+            factors.reserve(b.size());
+            for (const sym &t : b) {
+                factors.emplace_back(pow(t, n));
             }
-            return sym(std::move(r));
+            return sym(product(std::move(factors)));
         }
         return std::nullopt;
     }
@@ -17,6 +17,9 @@ namespace sympp {
 
     class pow : public function_interface {
       public:
+        /// Kind of this node type
+        static constexpr node_kind kind_value = node_kind::pow;
+
         friend class product;
         friend class log;
 
@@ -40,6 +43,34 @@ namespace sympp {
         void c_code(int &function_level, int &sum_level, int &prod_level,
                     bool &leaf, std::stack<std::string> &code_aux,
                     std::string &code) const override;
+      public /* lowering */:
+        /// \class Operation that evaluates a power
+        /// Powers are lowered to cheaper operations when the exponent
+        /// allows it, so std::pow is only called for general exponents.
+        struct lowering {
+            enum operation { general, integer, square_root, exp };
+
+            /// Operation
+            operation op{general};
+
+            /// Integer exponent, or the sign of the exponent of a
+            /// square root
+            int exponent{0};
+        };
+
+        /// Largest integer exponent we evaluate with multiplications
+        static constexpr int max_integer_exponent = 64;
+
+        /// Operation that evaluates this power
+        [[nodiscard]] lowering lower() const;
+
+        /// x^n by repeated squaring
+        static double integer_power(double x, int n);
+
+        /// Evaluate a power with its lowered operation
+        static double evaluate(const lowering &, double base,
+                               double exponent);
+
       public /* override node interface */:
         std::optional<sym> powdenest() override;
         std::optional<sym> expand() override;
@@ -48,6 +79,7 @@ namespace sympp {
       public /* override internal node interface */:
         [[nodiscard]] const std::type_info &type() const override;
         [[nodiscard]] node_interface *clone() const override;
+        [[nodiscard]] node_kind calculate_kind() const override;
       public /* override function interface */:
         std::optional<sym> simplify(double ratio,
                                     complexity_lambda func) override;
@@ -118,7 +118,7 @@ namespace sympp {
                 return sym(integer(0));
             }
             if (s.is_real_number()) {
-                auto p = s.root_node_as<number_interface>();
+                auto p = s.node_as<number_interface>();
                 return sym(real(std::sinh(p->operator double())));
             }
         }
@@ -146,4 +146,6 @@ namespace sympp {
         return dynamic_cast<node_interface *>(new sinh(*this));
     }
 
+    node_kind sinh::calculate_kind() const { return kind_value; }
+
 } // namespace sympp
\ No newline at end of file
@@ -11,6 +11,9 @@
 namespace sympp {
     class sinh : public function_interface {
       public:
+        /// Kind of this node type
+        static constexpr node_kind kind_value = node_kind::sinh;
+
         sinh(const sinh &);
         /// Move constructor
         sinh(sinh &&) noexcept;
@@ -34,6 +37,7 @@ namespace sympp {
       public /* override internal node interface */:
         [[nodiscard]] const std::type_info &type() const override;
         [[nodiscard]] node_interface *clone() const override;
+        [[nodiscard]] node_kind calculate_kind() const override;
       public /* override function interface */:
         std::optional<sym> simplify(double ratio,
                                     complexity_lambda func) override;
@@ -1,7 +1,13 @@
 #include "product.h"
 #include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <sympp/core/simplifier.h>
+#include <sympp/core/sparse_polynomial.h>
 #include <sympp/core/sym.h>
 #include <sympp/core/sym_error.h>
+#include <sympp/functions/mathematics.h>
 #include <sympp/functions/operators.h>
 #include <sympp/functions/symbolic.h>
 #include <sympp/node/function/cos.h>
@@ -12,6 +18,10 @@
 #include <sympp/node/operation/summation.h>
 #include <sympp/node/terminal/constant.h>
 #include <sympp/node/terminal/integer.h>
+#include <sympp/node/terminal/rational.h>
+#include <sympp/node/terminal/real.h>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace sympp {
@@ -30,30 +40,88 @@ namespace sympp {
     }
 
     product::product(product &&v) noexcept
-        : internal_node_interface<product>(v) {}
+        : internal_node_interface<product>(std::move(v)) {}
 
-    product::product(const sym &a, const sym &b)
-        : product(std::vector<sym>({a, b})) {}
+    product::product(const sym &a, const sym &b) {
+        append(a);
+        append(b);
+    }
+
+    product::product(sym &&a, sym &&b) {
+        append(std::move(a));
+        append(std::move(b));
+    }
 
     product::product(const std::vector<sym> &child_nodes) {
+        child_nodes_.reserve(child_nodes.size());
         for (const auto &s : child_nodes) {
-            if (s.is_product()) {
-                auto p = s.root_node_as<product>();
-                child_nodes_.insert(child_nodes_.end(), p->begin(), p->end());
-            } else {
-                child_nodes_.emplace_back(s);
-            }
+            append(s, false);
         }
+        // sort once instead of merging each factor
+        sort_children();
     }
 
-    product::product(std::vector<sym> &&child_nodes)
-        : internal_node_interface<product>(std::move(child_nodes)) {}
+    product::product(std::vector<sym> &&child_nodes) {
+        for (auto &s : child_nodes) {
+            append(std::move(s), false);
+        }
+        // sort once instead of merging each factor
+        sort_children();
+    }
 
     product::~product() = default;
 
+    void product::append(const sym &s, bool merge) {
+        const size_t n = child_nodes_.size();
+        if (s.is_product()) {
+            // the node might be shared, so we sort our copy of its
+            // factors if needed
+            auto p = s.node_as<product>();
+            child_nodes_.insert(child_nodes_.end(), p->begin(), p->end());
+            if (merge) {
+                merge_children(n, p->children_sorted_);
+            }
+        } else {
+            child_nodes_.emplace_back(s);
+            if (merge) {
+                merge_children(n, true);
+            }
+        }
+    }
+
+    void product::append(sym &&s, bool merge) {
+        if (!s.is_product()) {
+            const size_t n = child_nodes_.size();
+            child_nodes_.emplace_back(std::move(s));
+            if (merge) {
+                merge_children(n, true);
+            }
+            return;
+        }
+        if (s.is_shared()) {
+            append(std::as_const(s), merge);
+            return;
+        }
+        // no other sym uses this node, so we can steal its factors
+        const bool sorted = s.node_as<product>()->children_sorted_;
+        std::vector<sym> &c = s.root_node_as<product>()->child_nodes_;
+        const size_t n = child_nodes_.size();
+        if (child_nodes_.empty()) {
+            child_nodes_ = std::move(c);
+        } else {
+            child_nodes_.insert(child_nodes_.end(),
+                                std::make_move_iterator(c.begin()),
+                                std::make_move_iterator(c.end()));
+        }
+        if (merge) {
+            merge_children(n, sorted);
+        }
+    }
+
     product &product::operator=(const product &rhs) {
         if (child_nodes_ != rhs.child_nodes_) {
             child_nodes_ = rhs.child_nodes_;
+            children_changed();
         }
         return *this;
     }
@@ -183,20 +251,20 @@ namespace sympp {
         auto it = child_nodes_.begin();
         while (it != child_nodes_.end()) {
             // if it's power node
-            if (it->type() == typeid(pow)) {
+            if (it->kind() == node_kind::pow) {
                 // get pointer
                 auto p = it->root_node_as<pow>();
                 // if exponent is integer
                 if (p->child_nodes_.back().is<integer>()) {
                     // get exponent as int
-                    auto e = p->child_nodes_.back().root_node_as<integer>();
+                    auto e = p->child_nodes_.back().node_as<integer>();
                     int n = static_cast<int>(*e);
                     // if exponent is more than 0
                     if (n > 0) {
                         // if base is product
                         if (p->child_nodes_.front().is_product()) {
                             auto b =
-                                p->child_nodes_.front().root_node_as<product>();
+                                p->child_nodes_.front().node_as<product>();
                             for (int m = 0; m < n; ++m) {
                                 expanded_powers.insert(expanded_powers.end(),
                                                        b->child_nodes_.begin(),
@@ -225,6 +293,7 @@ namespace sympp {
                 ++it;
             }
         }
+        children_changed();
     }
 
     std::optional<sym> product::expand() {
@@ -242,12 +311,15 @@ namespace sympp {
                 other_terms.insert(other_terms.end(), std::next(i),
                                    child_nodes_.end());
 
-                summation result;
-                for (const auto &summand : *i) {
-                    product result_summand(other_terms);
-                    result_summand.child_nodes_.emplace_back(summand);
-                    result.child_nodes_.emplace_back(result_summand);
+                std::vector<sym> summands;
+                summands.reserve(i->size());
+                for (const auto &summand : std::as_const(*i)) {
+                    simplifier::check_budget(other_terms.size() + 2);
+                    std::vector<sym> factors(other_terms);
+                    factors.emplace_back(summand);
+                    summands.emplace_back(product(std::move(factors)));
                 }
+                summation result(std::move(summands));
 
                 auto r = result.expand();
                 if (r) {
@@ -257,112 +329,214 @@ namespace sympp {
                 }
             }
         }
+        children_changed();
         return std::nullopt;
     }
 
     std::optional<sym> product::collect() {
         // Absorb product of product
         // eg.: a * (a * a) * a -> a * a * a * a
-        auto i = child_nodes_.begin();
-        while (i != child_nodes_.end()) {
-            sym &s = *i;
-            if (s.is_product()) {
-                auto p = s.root_node_as<product>();
-                child_nodes_.insert(child_nodes_.end(), p->child_nodes_.begin(),
-                                    p->child_nodes_.end());
-                i = child_nodes_.erase(i);
-            } else {
-                ++i;
-            }
+        auto is_not_product = [](const auto &child) {
+            return child.kind() != node_kind::product;
+        };
+        auto p = std::stable_partition(child_nodes_.begin(), child_nodes_.end(),
+                                       is_not_product);
+        std::vector<sym> internal_products(
+            std::make_move_iterator(p),
+            std::make_move_iterator(child_nodes_.end()));
+        child_nodes_.erase(p, child_nodes_.end());
+        for (const auto &internal_product : internal_products) {
+            auto ip = internal_product.node_as<product>();
+            child_nodes_.insert(child_nodes_.end(),
+                                ip->child_nodes_.begin(),
+                                ip->child_nodes_.end());
         }
 
-        // Group common terms
-        // eg.: x*x*x -> x^3
-        for (i = child_nodes_.begin(); i != child_nodes_.end(); ++i) {
-
-            // numbers will be grouped later
-            if (i->is_number()) {
-                continue;
+        // Exponent of a base
+        // Integer and rational exponents are added as native integers
+        // and the other exponents are kept for a summation. Exponents
+        // that would overflow the integers are also kept there, so the
+        // summation adds them symbolically.
+        struct exponent {
+            int64_t numerator{0};
+            int64_t denominator{1};
+            bool has_real{false};
+            double real_value{0.0};
+            std::vector<sym> others;
+
+            /// Add p/q to the rational part of the exponent
+            /// Returns false if the sum overflows
+            bool add_rational(int64_t p, int64_t q) {
+                int64_t a = 0;
+                int64_t b = 0;
+                int64_t n = 0;
+                int64_t d = 0;
+                if (!sparse_polynomial::checked_mul(numerator, q, a) ||
+                    !sparse_polynomial::checked_mul(p, denominator, b) ||
+                    !sparse_polynomial::checked_add(a, b, n) ||
+                    !sparse_polynomial::checked_mul(denominator, q, d)) {
+                    return false;
+                }
+                const int64_t g = std::gcd(n, d);
+                numerator = g > 1 ? n / g : n;
+                denominator = g > 1 ? d / g : d;
+                return true;
             }
 
-            // Total power of this node
-            sym total_power(1);
-
-            // The exponent in products must be ignored in grouping
-            // comparisons. Just consider the base, keep the exponent
-            // and keep going as usual
-            sym *child_node = &(*i);
-            if (child_node->is<pow>()) {
-                auto p = child_node->root_node_as<pow>();
-                total_power = p->child_nodes_.back();
-                child_node = &(p->child_nodes_.front());
+            /// Add an exponent of 1
+            void add_one() {
+                int64_t n = 0;
+                if (sparse_polynomial::checked_add(numerator, denominator,
+                                                   n)) {
+                    numerator = n;
+                } else {
+                    others.emplace_back(1);
+                }
             }
 
-            auto j = i;
-            ++j;
-            while (j != child_nodes_.end() && i->is_commutative()) {
-                // Numbers will be grouped later
-                if (j->is_number()) {
-                    ++j;
-                    continue;
+            void add(const sym &e) {
+                if (e.kind() == node_kind::integer) {
+                    auto n = static_cast<int>(*e.node_as<number_interface>());
+                    int64_t t = 0;
+                    int64_t s = 0;
+                    if (sparse_polynomial::checked_mul(n, denominator, t) &&
+                        sparse_polynomial::checked_add(numerator, t, s)) {
+                        numerator = s;
+                    } else {
+                        others.emplace_back(e);
+                    }
+                } else if (e.kind() == node_kind::rational) {
+                    auto r = e.node_as<rational>();
+                    if (!add_rational(r->numerator(), r->denominator())) {
+                        others.emplace_back(e);
+                    }
+                } else if (e.kind() == node_kind::real) {
+                    has_real = true;
+                    real_value +=
+                        static_cast<double>(*e.node_as<number_interface>());
+                } else {
+                    others.emplace_back(e);
                 }
+            }
 
-                sym *child_node2 = &(*j);
-                sym total_power2(1);
-
-                // The exponent in products must be ignored in grouping
-                // comparisons
-                if (child_node2->is<pow>()) {
-                    auto p = child_node2->root_node_as<pow>();
-                    total_power2 = p->child_nodes_.back();
-                    child_node2 = &(p->child_nodes_.front());
+            [[nodiscard]] sym numeric() const {
+                constexpr int64_t int_max = std::numeric_limits<int>::max();
+                const bool fits_int = std::abs(numerator) <= int_max &&
+                                      denominator <= int_max;
+                if (has_real || !fits_int) {
+                    return sym(real(static_cast<double>(numerator) /
+                                        static_cast<double>(denominator) +
+                                    real_value));
                 }
-
-                // If the same, update the total power
-                if (child_node->compare(*child_node2) == 0) {
-                    total_power = total_power + total_power2;
-                    j = child_nodes_.erase(j);
-                } else {
-                    ++j;
+                if (denominator == 1) {
+                    return sym(static_cast<int>(numerator));
                 }
+                return sym(rational(static_cast<int>(numerator),
+                                    static_cast<int>(denominator)));
             }
 
-            if (total_power == 0) {
-                *i = 1;
-            } else if (total_power == 1) {
-                *i = *child_node;
-            } else {
-                *i = sym(pow(*child_node, total_power));
-                i->simplify();
+            [[nodiscard]] sym value() const {
+                sym n = numeric();
+                if (others.empty()) {
+                    return n;
+                }
+                std::vector<sym> terms;
+                terms.reserve(others.size() + 1);
+                if (!n.node_as<number_interface>()->is_zero()) {
+                    terms.emplace_back(std::move(n));
+                }
+                terms.insert(terms.end(), others.begin(), others.end());
+                return sum(std::move(terms));
             }
-        }
+        };
 
-        // Move numbers to the front (always reduces expression)
-        sym numbers(integer(1));
-        for (auto j = child_nodes_.begin(); j != child_nodes_.end();) {
-            if (j->is_number()) {
-                numbers = numbers * sym(*j);
-                if (numbers.is_number() &&
-                    numbers.root_node_as<number_interface>()->is_zero()) {
+        // Group the factors by base
+        // eg.: x*x^2*y*x -> x^4*y
+        // The bases are kept in the order we first see them
+        sym numbers(1);
+        std::unordered_map<sym, exponent> exponents;
+        exponents.reserve(child_nodes_.size());
+        std::vector<std::pair<const sym, exponent> *> bases;
+        std::vector<sym> non_commutative;
+        for (const auto &child_node : child_nodes_) {
+            if (child_node.is_number()) {
+                numbers = *numbers.node_as<number_interface>() *
+                          *child_node.node_as<number_interface>();
+                if (numbers.node_as<number_interface>()->is_zero()) {
+                    invalidate_hash();
                     return numbers;
                 }
-                j = child_nodes_.erase(j);
+                continue;
+            }
+            // The exponent of a power is not part of its base
+            const sym *base = &child_node;
+            const sym *power = nullptr;
+            if (child_node.is<pow>()) {
+                auto pp = child_node.node_as<pow>();
+                base = &pp->child_nodes_.front();
+                power = &pp->child_nodes_.back();
+            }
+            if (!base->is_commutative()) {
+                non_commutative.emplace_back(child_node);
+                continue;
+            }
+            auto [it, inserted] = exponents.try_emplace(*base);
+            if (inserted) {
+                bases.emplace_back(&*it);
+            }
+            if (power) {
+                it->second.add(*power);
             } else {
-                ++j;
+                it->second.add_one();
             }
         }
 
-        bool not_one = !numbers.is_number() ||
-                       !numbers.root_node_as<number_interface>()->is_one();
-        if (not_one) {
-            numbers.simplify();
-            child_nodes_.insert(child_nodes_.begin(), numbers);
+        // Create the new factors in one pass
+        std::vector<sym> result;
+        result.reserve(bases.size() + non_commutative.size() + 1);
+        if (!numbers.node_as<number_interface>()->is_one()) {
+            result.emplace_back(std::move(numbers));
+        }
+        for (auto *b : bases) {
+            sym e = b->second.value();
+            if (e.is_number()) {
+                const auto *n = e.node_as<number_interface>();
+                if (n->is_zero()) {
+                    continue;
+                }
+                if (n->is_one()) {
+                    result.emplace_back(b->first);
+                    continue;
+                }
+            }
+            sym f(pow(b->first, e));
+            f.simplify();
+            result.emplace_back(std::move(f));
         }
+        result.insert(result.end(),
+                      std::make_move_iterator(non_commutative.begin()),
+                      std::make_move_iterator(non_commutative.end()));
+        child_nodes_ = std::move(result);
+        children_changed();
 
+        if (child_nodes_.empty()) {
+            return sym(1);
+        }
+        if (child_nodes_.size() == 1) {
+            return child_nodes_.front();
+        }
         return std::nullopt;
     }
 
     void product::stream(std::ostream &os, bool symbolic_format) const {
+        // stream the factors in canonical order, without reordering the
+        // factors of a node other threads might be reading
+        if (!children_sorted_) {
+            product sorted(*this);
+            sorted.sort_children();
+            sorted.stream(os, symbolic_format);
+            return;
+        }
         if (child_nodes_.empty()) {
             os << 1;
         } else if (child_nodes_.size() == 1) {
@@ -376,9 +550,11 @@ namespace sympp {
                     os << "-";
                     ++i;
                 }
-                if (i->type() != typeid(product) && i->type() != typeid(pow) &&
-                    i->type() != typeid(sin) && i->type() != typeid(cos) &&
-                    i->type() != typeid(log) && !i->is_variable() &&
+                if (i->kind() != node_kind::product &&
+                    i->kind() != node_kind::pow &&
+                    i->kind() != node_kind::sin &&
+                    i->kind() != node_kind::cos &&
+                    i->kind() != node_kind::log && !i->is_variable() &&
                     !i->is_function() && !i->is_number() && !i->is_constant()) {
                     os << "(";
                     i->stream(os, symbolic_format);
@@ -402,32 +578,19 @@ namespace sympp {
                                          complexity_lambda measure_function) {
         // Collect common powers (always reduces expression)
         // eg.: x*x*x*x -> x^4
-        collect();
-
-        // Treat 1-element sum: (a) -> a (always reduces expression)
-        if (child_nodes_.size() == 1) {
-            child_nodes_.front().simplify(ratio, measure_function);
-            return child_nodes_.front();
+        // Products with one factor or a zero factor are replaced
+        if (std::optional<sym> r = collect(); r) {
+            r->simplify(ratio, measure_function);
+            return r;
         }
 
         // Simplify children (forward the ratio)
         internal_node_interface<product>::simplify(ratio, measure_function);
 
         // Collect common powers (always reduces expression)
-        collect();
-
-        // Treat 1-element sum: (a) -> a (always reduces expression)
-        if (child_nodes_.size() == 1) {
-            child_nodes_.front().simplify(ratio, measure_function);
-            return child_nodes_.front();
-        }
-
-        if (child_nodes_.empty()) {
-            return sym(1);
-        }
-
-        if (child_nodes_.size() == 1) {
-            return child_nodes_.front();
+        if (std::optional<sym> r = collect(); r) {
+            r->simplify(ratio, measure_function);
+            return r;
         }
 
         return std::nullopt;
@@ -437,7 +600,8 @@ namespace sympp {
         // Try to replace the root directly
         if (this->compare(*x.root_node()) == 0) {
             if (y.is<product>()) {
-                child_nodes_ = y.root_node_as<product>()->child_nodes_;
+                child_nodes_ = y.node_as<product>()->child_nodes_;
+                children_changed();
                 return std::nullopt;
             } else {
                 return y;
@@ -542,64 +706,41 @@ namespace sympp {
     }
 
     bool product::children_match(const product &rhs) const {
-        auto hint_it = child_nodes_.begin();
-        for (auto &rhs_child : rhs.child_nodes_) {
-            // search the term in this
-            auto j = std::find(hint_it, child_nodes_.end(), rhs_child);
-            if (j == child_nodes_.end()) {
-                j = std::find(child_nodes_.begin(), child_nodes_.end(),
-                              rhs_child);
-            }
-            // if not found
-            if (j == child_nodes_.end()) {
-                // give up
-                break;
-            } else {
-                ++hint_it;
-            }
-        }
-        return hint_it == child_nodes_.end();
+        return compare(rhs) == 0;
     }
 
     int product::compare(const node_interface &s) const {
-        if (type() != s.type()) {
-            return type().before(s.type()) ? -1 : 1;
+        if (kind() != s.kind()) {
+            return compare_kinds(kind(), s.kind());
         }
-        const auto &rhs = dynamic_cast<const product &>(s);
-
-        // compare the children
-        if (children_match(rhs)) {
-            return 0;
-        } else {
-            // if they don't match
-            // the first inequality tells us who should come before
-            auto i = this->child_nodes_.begin();
-            auto j = rhs.child_nodes_.begin();
-            int c = 0;
-            while (i != child_nodes_.end()) {
-                c = i->compare(*j);
-                if (c != 0) {
-                    return c;
-                } else {
-                    ++i;
-                    ++j;
-                }
-            }
+        const auto &rhs = static_cast<const product &>(s);
+        if (child_nodes_.size() != rhs.child_nodes_.size()) {
+            return child_nodes_.size() < rhs.child_nodes_.size() ? -1 : +1;
         }
-        return 0;
+
+        // in canonical order, the first inequality tells us who comes
+        // before
+        return compare_sorted_children(rhs);
     }
 
     void product::put_indexes(
         std::unordered_map<int, sym> &bool_symbols_vars,
         std::unordered_map<int, sym> &int_symbols_vars,
         std::unordered_map<int, sym> &real_symbols_vars,
-        std::unordered_map<std::string, int> &bool_symbols_names,
-        std::unordered_map<std::string, int> &int_symbols_names,
-        std::unordered_map<std::string, int> &real_symbols_names) {
+        std::unordered_map<symbol_id, int> &bool_symbols_names,
+        std::unordered_map<symbol_id, int> &int_symbols_names,
+        std::unordered_map<symbol_id, int> &real_symbols_names) {
+        // Only detach the factors whose indexes change
         for (auto &factor : this->child_nodes_) {
-            factor.root_node()->put_indexes(
-                bool_symbols_vars, int_symbols_vars, real_symbols_vars,
-                bool_symbols_names, int_symbols_names, real_symbols_names);
+            if (indexes_changed(std::as_const(factor), bool_symbols_vars,
+                                int_symbols_vars, real_symbols_vars,
+                                bool_symbols_names, int_symbols_names,
+                                real_symbols_names)) {
+                factor.root_node()->put_indexes(
+                    bool_symbols_vars, int_symbols_vars, real_symbols_vars,
+                    bool_symbols_names, int_symbols_names,
+                    real_symbols_names);
+            }
         }
     }
 
@@ -619,7 +760,7 @@ namespace sympp {
             return false;
         }
 
-        auto p = child_nodes_.front().root_node_as<number_interface>();
+        auto p = child_nodes_.front().node_as<number_interface>();
         return p->is_negative();
     }
 
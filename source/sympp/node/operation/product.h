@@ -16,6 +16,9 @@ namespace sympp {
 
     class product : public internal_node_interface<product> {
       public:
+        /// Kind of this node type
+        static constexpr node_kind kind_value = node_kind::product;
+
         friend class summation;
         friend class cos;
         friend class cosh;
@@ -30,7 +33,10 @@ namespace sympp {
         /// Move constructor
         product(product &&) noexcept;
         product(const sym &, const sym &);
+        /// Construct from two factors, stealing their nodes
+        product(sym &&, sym &&);
         explicit product(const std::vector<sym> &child_nodes);
+        /// Construct from factors, stealing their nodes
         explicit product(std::vector<sym> &&child_nodes);
         ~product() override;
         product &operator=(const product &);
@@ -78,9 +84,9 @@ namespace sympp {
             std::unordered_map<int, sym> &bool_symbols_vars,
             std::unordered_map<int, sym> &int_symbols_vars,
             std::unordered_map<int, sym> &real_symbols_vars,
-            std::unordered_map<std::string, int> &bool_symbols_names,
-            std::unordered_map<std::string, int> &int_symbols_names,
-            std::unordered_map<std::string, int> &real_symbols_names) override;
+            std::unordered_map<symbol_id, int> &bool_symbols_names,
+            std::unordered_map<symbol_id, int> &int_symbols_names,
+            std::unordered_map<symbol_id, int> &real_symbols_names) override;
 
         [[nodiscard]] bool is_commutative() const override;
 
@@ -89,6 +95,15 @@ namespace sympp {
         [[nodiscard]] bool children_match(const product &rhs) const;
         // expand positive integer powers to match each factor individually
         void expand_powers();
+
+      private:
+        /// Append a factor, or the factors of a nested product
+        /// If merge is false, the caller sorts the factors later
+        void append(const sym &, bool merge = true);
+
+        /// Append a factor, or steal the factors of a nested product
+        /// If merge is false, the caller sorts the factors later
+        void append(sym &&, bool merge = true);
     };
 } // namespace sympp
 
@@ -4,6 +4,8 @@
 #include <sympp/node/operation/product.h>
 #include <sympp/node/terminal/integer.h>
 #include <sympp/node/terminal/number_interface.h>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace sympp {
@@ -22,37 +24,99 @@ namespace sympp {
     }
 
     summation::summation(summation &&v) noexcept
-        : internal_node_interface<summation>(v) {}
+        : internal_node_interface<summation>(std::move(v)) {}
 
-    summation::summation(const sym &a, const sym &b)
-        : summation(std::vector<sym>({a, b})) {}
+    summation::summation(const sym &a, const sym &b) {
+        append(a);
+        append(b);
+    }
+
+    summation::summation(sym &&a, sym &&b) {
+        append(std::move(a));
+        append(std::move(b));
+    }
 
     summation::summation(const std::vector<sym> &child_nodes) {
+        child_nodes_.reserve(child_nodes.size());
         for (const auto &s : child_nodes) {
-            if (s.is_summation()) {
-                auto p = s.root_node_as<summation>();
-                child_nodes_.insert(child_nodes_.end(), p->begin(), p->end());
-            } else {
-                child_nodes_.emplace_back(s);
-            }
+            append(s, false);
         }
+        // sort once instead of merging each term
+        sort_children();
+    }
+
+    summation::summation(std::vector<sym> &&child_nodes) {
+        for (auto &s : child_nodes) {
+            append(std::move(s), false);
+        }
+        // sort once instead of merging each term
+        sort_children();
     }
 
     summation::~summation() = default;
 
+    void summation::append(const sym &s, bool merge) {
+        const size_t n = child_nodes_.size();
+        if (s.is_summation()) {
+            // the node might be shared, so we sort our copy of its
+            // terms if needed
+            auto p = s.node_as<summation>();
+            child_nodes_.insert(child_nodes_.end(), p->begin(), p->end());
+            if (merge) {
+                merge_children(n, p->children_sorted_);
+            }
+        } else {
+            child_nodes_.emplace_back(s);
+            if (merge) {
+                merge_children(n, true);
+            }
+        }
+    }
+
+    void summation::append(sym &&s, bool merge) {
+        if (!s.is_summation()) {
+            const size_t n = child_nodes_.size();
+            child_nodes_.emplace_back(std::move(s));
+            if (merge) {
+                merge_children(n, true);
+            }
+            return;
+        }
+        if (s.is_shared()) {
+            append(std::as_const(s), merge);
+            return;
+        }
+        // no other sym uses this node, so we can steal its terms
+        const bool sorted = s.node_as<summation>()->children_sorted_;
+        std::vector<sym> &c = s.root_node_as<summation>()->child_nodes_;
+        const size_t n = child_nodes_.size();
+        if (child_nodes_.empty()) {
+            child_nodes_ = std::move(c);
+        } else {
+            child_nodes_.insert(child_nodes_.end(),
+                                std::make_move_iterator(c.begin()),
+                                std::make_move_iterator(c.end()));
+        }
+        if (merge) {
+            merge_children(n, sorted);
+        }
+    }
+
     summation &summation::operator=(const summation &rhs) {
         if (this != &rhs) {
             child_nodes_ = rhs.child_nodes_;
+            children_changed();
         }
         return *this;
     }
 
     sym summation::coeff(const node_interface &s) const {
-        summation r;
+        std::vector<sym> terms;
+        terms.reserve(child_nodes_.size());
         for (const auto &child_node : child_nodes_) {
-            r.child_nodes_.emplace_back(child_node.coeff(s));
+            terms.emplace_back(child_node.coeff(s));
         }
-        return sym(r);
+        return sym(summation(std::move(terms)));
     }
 
     double summation::evaluate(const std::vector<uint8_t> &bool_values,
@@ -128,108 +192,112 @@ namespace sympp {
     std::optional<sym> summation::collect() {
         absorb_sum_of_sums();
 
-        // Group common terms
-        for (auto i = child_nodes_.begin(); i != child_nodes_.end(); ++i) {
-            auto &child_node = *i;
+        // Sum of the numbers
+        sym numbers(0);
+        auto add = [](const sym &a, const sym &b) {
+            return *a.node_as<number_interface>() +
+                   *b.node_as<number_interface>();
+        };
 
-            // Numbers will be grouped later
-            if (child_node.type() == typeid(number_interface)) {
+        // Accumulated coefficient of each coefficient-free term
+        // The terms are kept in the order we first see them
+        std::unordered_map<sym, sym> coefficients;
+        coefficients.reserve(child_nodes_.size());
+        std::vector<std::pair<const sym, sym> *> terms;
+        for (const auto &child_node : child_nodes_) {
+            auto [coefficient, term] = split_coefficient(child_node);
+            if (term.is_number()) {
+                numbers = add(numbers, coefficient);
                 continue;
             }
-
-            // Create number with the leading coefficient of products
-            sym leading_coefficient(1);
-
-            // The leading coefficient of products must be ignored in
-            // grouping comparisons
-            if (child_node.type() == typeid(product)) {
-                auto p = child_node.root_node_as<product>();
-                const bool first_term_is_number =
-                    !p->child_nodes_.empty() &&
-                    p->child_nodes_.front().is_number();
-                if (first_term_is_number) {
-                    leading_coefficient = sym(p->child_nodes_.front());
-                    p->child_nodes_.erase(p->child_nodes_.begin());
-                    // Don't need to forward the ratio
-                    // The child has already been simplified
-                    // during collection, we just need to make
-                    // sure the most obvious simplifications
-                    // happen here.
-                    p->simplify();
-                }
+            auto [it, inserted] =
+                coefficients.try_emplace(std::move(term), coefficient);
+            if (inserted) {
+                terms.emplace_back(&*it);
+            } else {
+                it->second = add(it->second, coefficient);
             }
+        }
 
-            // Iterate terms that come after child_node in this summation
-            auto j = i;
-            ++j;
-            for (; j != child_nodes_.end();) {
-                auto &child_node2 = *j;
-
-                // Numbers will be grouped later
-                if (child_node2.is_number()) {
-                    ++j;
-                    continue;
-                }
-
-                // Get the leading coefficient of this element too
-                // The leading coefficient of products must be ignored
-                // in grouping comparisons
-                sym leading_coefficient2(integer(1));
-                if (child_node2.type() == typeid(product)) {
-                    auto p = child_node2.root_node_as<product>();
-                    bool first_term_is_number =
-                        !p->child_nodes_.empty() &&
-                        p->child_nodes_.front().is_number();
-                    if (first_term_is_number) {
-                        leading_coefficient2 = sym(p->child_nodes_.front());
-                        p->child_nodes_.erase(p->child_nodes_.begin());
-                    }
-                }
-
-                // Compare the pair of child nodes
-                // If the nodes (now without their number coefficients) are the
-                // same
-                if (child_node.root_node()->compare(*child_node2.root_node()) ==
-                    0) {
-                    // We create a new coefficient from both terms
-                    leading_coefficient =
-                        leading_coefficient + leading_coefficient2;
-                    // and remove one of the terms (the second one)
-                    j = child_nodes_.erase(j);
-                } else {
-                    ++j;
-                }
+        // Create the new terms in one pass
+        std::vector<sym> result;
+        result.reserve(terms.size() + 1);
+        if (!numbers.node_as<number_interface>()->is_zero()) {
+            result.emplace_back(std::move(numbers));
+        }
+        for (auto *t : terms) {
+            const auto *c = t->second.node_as<number_interface>();
+            if (c->is_zero()) {
+                continue;
             }
-
-            // If the leading coefficient of the product is zero
-            if (leading_coefficient.is_zero()) {
-                // just erase the node
-                i = child_nodes_.erase(i);
+            if (c->is_one()) {
+                result.emplace_back(t->first);
             } else {
-                // if the leading coefficient is not zero
-                // recreate the product with the new coefficient
-                *i = (leading_coefficient * child_node);
-                // simplify
-                i->simplify();
-                // and move forward
-                ++i;
+                result.emplace_back(product(t->second, t->first));
             }
         }
+        child_nodes_ = std::move(result);
+        children_changed();
 
+        if (child_nodes_.empty()) {
+            return sym(0);
+        }
+        if (child_nodes_.size() == 1) {
+            return child_nodes_.front();
+        }
         return std::nullopt;
     }
 
+    std::pair<sym, sym> summation::split_coefficient(const sym &s) {
+        if (s.is_number()) {
+            return {s, sym(1)};
+        }
+        auto p = s.node_as<product>();
+        if (!p) {
+            return {sym(1), s};
+        }
+        sym coefficient(1);
+        std::vector<sym> factors;
+        factors.reserve(p->size());
+        for (const auto &factor : p->child_nodes_) {
+            if (factor.is_number()) {
+                coefficient = *coefficient.node_as<number_interface>() *
+                              *factor.node_as<number_interface>();
+            } else {
+                factors.emplace_back(factor);
+            }
+        }
+        if (factors.size() == p->size()) {
+            return {sym(1), s};
+        }
+        if (factors.empty()) {
+            return {coefficient, sym(1)};
+        }
+        if (factors.size() == 1) {
+            return {coefficient, factors.front()};
+        }
+        return {coefficient, sym(product(std::move(factors)))};
+    }
+
     void summation::stream(std::ostream &os, bool symbolic_format) const {
+        // stream the terms in canonical order, without reordering the
+        // terms of a node other threads might be reading
+        if (!children_sorted_) {
+            summation sorted(*this);
+            sorted.sort_children();
+            sorted.stream(os, symbolic_format);
+            return;
+        }
         if (child_nodes_.empty()) {
             os << 0;
         } else {
             // if there are children
             for (auto i = child_nodes_.begin(); i != child_nodes_.end(); ++i) {
                 if (i != child_nodes_.begin()) {
-                    auto number_node = i->root_node_as<number_interface>();
+                    auto number_node = i->node_as<number_interface>();
                     bool is_positive_if_num =
                         !number_node || !number_node->is_negative();
-                    auto prod_node = i->root_node_as<product>();
+                    auto prod_node = i->node_as<product>();
                     bool is_positive_if_prod =
                         !prod_node || !prod_node->prints_negative();
                     if (is_positive_if_num && is_positive_if_prod) {
@@ -244,9 +312,11 @@ namespace sympp {
     std::optional<sym> summation::simplify(double ratio,
                                            complexity_lambda measure_function) {
         /*
-         * The ration and measure function are currently unused
-         * because we don't use expand to try to simplify the
-         * summation so `simplify` can only reduce the expression.
+         * The ratio and measure function are only forwarded to the
+         * children: we don't use expand to try to simplify the
+         * summation, so `simplify` can only reduce the expression.
+         * sym::simplify runs the simplifier driver, which tries
+         * expand, for other than the default options.
          */
 
         // Collect common powers (always reduces expression)
@@ -270,24 +340,7 @@ namespace sympp {
             return child_nodes_.front();
         }
 
-        // Move numbers to the back (always reduces expression)
-        sym numbers(integer(0));
-        for (auto j = child_nodes_.begin(); j != child_nodes_.end();) {
-            if (j->is_number()) {
-                numbers = numbers + sym(*j);
-                j = child_nodes_.erase(j);
-            } else {
-                ++j;
-            }
-        }
-
-        bool not_zero = !numbers.is_number() ||
-                        !numbers.root_node_as<number_interface>()->is_zero();
-        if (not_zero) {
-            numbers.simplify(ratio, measure_function);
-            child_nodes_.push_back(numbers);
-        }
-
+        // collect has already added the numbers
         if (child_nodes_.empty()) {
             return sym(0);
         }
@@ -315,12 +368,11 @@ namespace sympp {
 
         // sum does not contain expression for substitution
         // try to substitute in each summand
+        // sym::subs only detaches the summands that might change
         for (auto &child_node : child_nodes_) {
-            std::optional<sym> r = child_node.root_node()->subs(x, y);
-            if (r) {
-                child_node = *r;
-            }
+            child_node.subs(x, y);
         }
+        children_changed();
 
         if (child_nodes_.size() == 1) {
             return *child_nodes_.begin();
@@ -329,50 +381,40 @@ namespace sympp {
     }
 
     int summation::compare(const node_interface &s) const {
-        // compare type
-        if (type() != s.type()) {
-            return (type().before(s.type())) ? -1 : +1;
+        // compare kind
+        if (kind() != s.kind()) {
+            return compare_kinds(kind(), s.kind());
         }
 
         // compare number of children
-        const auto &rhs = dynamic_cast<const summation &>(s);
+        const auto &rhs = static_cast<const summation &>(s);
         if (child_nodes_.size() != rhs.child_nodes_.size()) {
             return child_nodes_.size() < rhs.child_nodes_.size() ? -1 : +1;
         }
 
-        // compare the children
-        if (children_match(rhs)) {
-            return 0;
-        } else {
-            // if they don't match
-            // the first inequality tells us who comes before
-            auto i = this->child_nodes_.begin();
-            auto j = rhs.child_nodes_.begin();
-            int c;
-            do {
-                c = i->compare(*j);
-                if (c != 0) {
-                    return c;
-                }
-                ++i;
-                ++j;
-            } while (i == child_nodes_.end());
-        }
-
-        return 0;
+        // in canonical order, the first inequality tells us who comes
+        // before
+        return compare_sorted_children(rhs);
     }
 
     void summation::put_indexes(
         std::unordered_map<int, sym> &bool_symbols_vars,
         std::unordered_map<int, sym> &int_symbols_vars,
         std::unordered_map<int, sym> &real_symbols_vars,
-        std::unordered_map<std::string, int> &bool_symbols_names,
-        std::unordered_map<std::string, int> &int_symbols_names,
-        std::unordered_map<std::string, int> &real_symbols_names) {
+        std::unordered_map<symbol_id, int> &bool_symbols_names,
+        std::unordered_map<symbol_id, int> &int_symbols_names,
+        std::unordered_map<symbol_id, int> &real_symbols_names) {
+        // Only detach the summands whose indexes change
         for (auto &summand : this->child_nodes_) {
-            summand.root_node()->put_indexes(
-                bool_symbols_vars, int_symbols_vars, real_symbols_vars,
-                bool_symbols_names, int_symbols_names, real_symbols_names);
+            if (indexes_changed(std::as_const(summand), bool_symbols_vars,
+                                int_symbols_vars, real_symbols_vars,
+                                bool_symbols_names, int_symbols_names,
+                                real_symbols_names)) {
+                summand.root_node()->put_indexes(
+                    bool_symbols_vars, int_symbols_vars, real_symbols_vars,
+                    bool_symbols_names, int_symbols_names,
+                    real_symbols_names);
+            }
         }
     }
 
@@ -384,7 +426,7 @@ namespace sympp {
     void summation::absorb_sum_of_sums() {
         // find all internal sums
         auto is_not_sum = [](const auto &child) {
-            return child.type() == typeid(summation);
+            return child.kind() != node_kind::summation;
         };
         auto p = std::stable_partition(child_nodes_.begin(), child_nodes_.end(),
                                        is_not_sum);
@@ -399,35 +441,19 @@ namespace sympp {
                                 std::make_move_iterator(internal_sum.begin()),
                                 std::make_move_iterator(internal_sum.end()));
         }
+        children_changed();
     }
 
     bool summation::children_match(const summation &rhs) const {
-        auto hint_it = child_nodes_.begin();
-        for (auto &rhs_child : rhs.child_nodes_) {
-            // search the term in this
-            auto j = std::find(hint_it, child_nodes_.end(), rhs_child);
-            if (j == child_nodes_.end()) {
-                j = std::find(child_nodes_.begin(), child_nodes_.end(),
-                              rhs_child);
-            }
-            // if not found
-            if (j == child_nodes_.end()) {
-                // give up
-                break;
-            } else {
-                ++hint_it;
-            }
-        }
-        return hint_it == child_nodes_.end();
+        return compare(rhs) == 0;
     }
 
     std::optional<sym> summation::expand() {
-        for (auto &child_node : child_nodes_) {
-            std::optional<sym> r = child_node.root_node()->expand();
-            if (r) {
-                child_node = *r;
-            }
-        }
+        // The terms are independent, so they can run on the thread pool
+        // sym::expand keeps the summands that do not change shared
+        parallel_scope::for_each_child(
+            child_nodes_, [](sym &child_node) { child_node.expand(); });
+        children_changed();
         return std::nullopt;
     }
 
@@ -5,6 +5,7 @@
 
 // C++
 #include <functional>
+#include <utility>
 #include <vector>
 
 // Internal
@@ -15,6 +16,9 @@ namespace sympp {
     class product;
     class summation : public internal_node_interface<summation> {
       public:
+        /// Kind of this node type
+        static constexpr node_kind kind_value = node_kind::summation;
+
         friend class product;
 
       public:
@@ -24,7 +28,11 @@ namespace sympp {
         /// Move constructor
         summation(summation &&) noexcept;
         summation(const sym &, const sym &);
+        /// Construct from two terms, stealing their nodes
+        summation(sym &&, sym &&);
         explicit summation(const std::vector<sym> &summands);
+        /// Construct from terms, stealing their nodes
+        explicit summation(std::vector<sym> &&summands);
         ~summation() override;
         summation &operator=(const summation &);
 
@@ -63,16 +71,31 @@ namespace sympp {
             std::unordered_map<int, sym> &bool_symbols_vars,
             std::unordered_map<int, sym> &int_symbols_vars,
             std::unordered_map<int, sym> &real_symbols_vars,
-            std::unordered_map<std::string, int> &bool_symbols_names,
-            std::unordered_map<std::string, int> &int_symbols_names,
-            std::unordered_map<std::string, int> &real_symbols_names) override;
+            std::unordered_map<symbol_id, int> &bool_symbols_names,
+            std::unordered_map<symbol_id, int> &int_symbols_names,
+            std::unordered_map<symbol_id, int> &real_symbols_names) override;
         [[nodiscard]] bool is_commutative() const override;
+
+      protected /* node_interface pure virtual functions */:
         [[nodiscard]] node_interface *clone() const override;
 
       public:
         /// Absorb sum of sums: a + (a + a) + a -> a + a + a + a
         void absorb_sum_of_sums();
         [[nodiscard]] bool children_match(const summation &rhs) const;
+
+      private:
+        /// Split a term into its numeric coefficient and the rest
+        /// eg.: 2*x*y -> (2, x*y), x -> (1, x), 3 -> (3, 1)
+        static std::pair<sym, sym> split_coefficient(const sym &);
+
+        /// Append a term, or the terms of a nested summation
+        /// If merge is false, the caller sorts the terms later
+        void append(const sym &, bool merge = true);
+
+        /// Append a term, or steal the terms of a nested summation
+        /// If merge is false, the caller sorts the terms later
+        void append(sym &&, bool merge = true);
     };
 
 } // namespace sympp
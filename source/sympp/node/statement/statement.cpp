@@ -21,7 +21,7 @@ namespace sympp {
     }
 
     statement::statement(statement &&v) noexcept
-        : internal_node_interface<statement>(v) {}
+        : internal_node_interface<statement>(v), type_(v.type_) {}
 
     statement::statement(const sym &s1, const sym &s2)
         : statement(s1, s2, statement_type::equality) {}
@@ -101,6 +101,25 @@ namespace sympp {
                type_ == statement_type::inequality;
     }
 
+    int statement::compare(const node_interface &s) const {
+        int r = internal_node_interface<statement>::compare(s);
+        if (r != 0) {
+            return r;
+        }
+        // a == b and a <= b have the same children
+        const auto &rhs = dynamic_cast<const statement &>(s);
+        if (type_ != rhs.type_) {
+            return (type_ < rhs.type_) ? -1 : +1;
+        }
+        return 0;
+    }
+
+    size_t statement::calculate_hash() const {
+        return hash_combine(
+            internal_node_interface<statement>::calculate_hash(),
+            static_cast<size_t>(type_));
+    }
+
     statement::operator bool() const {
         switch (type_) {
         case statement_type::equality:
@@ -11,6 +11,9 @@ namespace sympp {
 
     class statement : public internal_node_interface<statement> {
       public:
+        /// Kind of this node type
+        static constexpr node_kind kind_value = node_kind::statement;
+
         enum statement_type {
             equality,
             greater_than,
@@ -34,6 +37,8 @@ namespace sympp {
       public /* override internal node interface */:
         void stream(std::ostream &os, bool symbolic_format) const override;
         [[nodiscard]] bool is_commutative() const override;
+        [[nodiscard]] int compare(const node_interface &s) const override;
+        [[nodiscard]] size_t calculate_hash() const override;
       public /* override internal node interface */:
         [[nodiscard]] double
         evaluate(const std::vector<uint8_t> &bool_values,
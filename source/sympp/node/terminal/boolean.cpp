@@ -76,6 +76,8 @@ namespace sympp {
         return dynamic_cast<node_interface *>(new boolean(*this));
     }
 
+    node_kind boolean::calculate_kind() const { return kind_value; }
+
     const std::type_info &boolean::numeric_type() const { return typeid(bool); }
 
     bool boolean::is_zero() const { return !number_; }
@@ -85,7 +87,7 @@ namespace sympp {
     bool boolean::is_negative() const { return false; }
 
     int boolean::compare_number(const number_interface &rhs) const {
-        if (rhs.type() == typeid(real)) {
+        if (rhs.kind() == node_kind::real) {
             auto lhs_double = static_cast<double>(number_);
             auto rhs_double = static_cast<double>(rhs);
             if (lhs_double < rhs_double) {
@@ -95,7 +97,7 @@ namespace sympp {
             } else {
                 return 0;
             }
-        } else if (rhs.type() == typeid(integer)) {
+        } else if (rhs.kind() == node_kind::integer) {
             auto lhs_int = static_cast<int>(number_);
             auto rhs_int = static_cast<int>(rhs);
             if (lhs_int < rhs_int) {
@@ -105,7 +107,7 @@ namespace sympp {
             } else {
                 return 0;
             }
-        } else if (rhs.type() == typeid(boolean)) {
+        } else if (rhs.kind() == node_kind::boolean) {
             auto rhs_bool = static_cast<bool>(rhs);
             if (!number_ && rhs_bool) {
                 return -1;
@@ -114,8 +116,8 @@ namespace sympp {
             } else {
                 return 0;
             }
-        } else if (rhs.type() == typeid(rational)) {
-            const auto &r = dynamic_cast<const rational &>(rhs);
+        } else if (rhs.kind() == node_kind::rational) {
+            const auto &r = static_cast<const rational &>(rhs);
             if (!number_) {
                 if (r.numerator() > 0) {
                     return -1;
@@ -144,7 +146,7 @@ namespace sympp {
     boolean::operator double() const { return static_cast<double>(number_); }
 
     sym boolean::add(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean)) {
+        if (rhs.kind() == node_kind::boolean) {
             auto rhs_bool = static_cast<bool>(rhs);
             if (number_ && rhs_bool) {
                 return sym(integer(2));
@@ -161,23 +163,23 @@ namespace sympp {
     }
 
     sym boolean::sub(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean)) {
+        if (rhs.kind() == node_kind::boolean) {
             auto rhs_bool = static_cast<bool>(rhs);
             if (!number_ && rhs_bool) {
                 return sym(integer(-1));
             } else {
                 return sym(boolean(number_ != rhs_bool));
             }
-        } else if (rhs.type() == typeid(integer)) {
+        } else if (rhs.kind() == node_kind::integer) {
             auto lhs_int = static_cast<int>(number_);
             auto rhs_int = static_cast<int>(rhs);
             return sym(integer(lhs_int - rhs_int));
-        } else if (rhs.type() == typeid(real)) {
+        } else if (rhs.kind() == node_kind::real) {
             auto lhs_double = static_cast<double>(number_);
             auto rhs_double = static_cast<double>(rhs);
             return sym(real(lhs_double - rhs_double));
-        } else if (rhs.type() == typeid(rational)) {
-            const auto &r = dynamic_cast<const rational &>(rhs);
+        } else if (rhs.kind() == node_kind::rational) {
+            const auto &r = static_cast<const rational &>(rhs);
             if (!number_) {
                 return sym(rational(-1 * r.numerator(), r.denominator()));
             } else {
@@ -190,7 +192,7 @@ namespace sympp {
     }
 
     sym boolean::mul(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean)) {
+        if (rhs.kind() == node_kind::boolean) {
             auto rhs_bool = static_cast<bool>(rhs);
             return sym(boolean(number_ && rhs_bool));
         } else {
@@ -202,14 +204,14 @@ namespace sympp {
     }
 
     sym boolean::div(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean)) {
+        if (rhs.kind() == node_kind::boolean) {
             auto rhs_bool = static_cast<bool>(rhs);
             if (!rhs_bool) {
                 return sym(integer(std::numeric_limits<int>::infinity()));
             } else {
                 return sym(number_);
             }
-        } else if (rhs.type() == typeid(integer)) {
+        } else if (rhs.kind() == node_kind::integer) {
             auto lhs_int = static_cast<int>(number_);
             auto rhs_int = static_cast<int>(rhs);
             if (rhs_int != 0 && lhs_int % rhs_int == 0) {
@@ -217,13 +219,13 @@ namespace sympp {
             } else {
                 return sym(rational(lhs_int, rhs_int));
             }
-        } else if (rhs.type() == typeid(real)) {
+        } else if (rhs.kind() == node_kind::real) {
             auto lhs_double = static_cast<double>(number_);
             auto rhs_double = static_cast<double>(rhs);
             return sym(real(lhs_double / rhs_double));
-        } else if (rhs.type() == typeid(rational)) {
+        } else if (rhs.kind() == node_kind::rational) {
             auto lhs_int = static_cast<int>(number_);
-            const auto &r = dynamic_cast<const rational &>(rhs);
+            const auto &r = static_cast<const rational &>(rhs);
             return sym(rational(lhs_int * r.denominator(), r.numerator()));
         } else {
             throw sym_error(sym_error::NotNumeric);
@@ -231,23 +233,23 @@ namespace sympp {
     }
 
     sym boolean::mod(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean)) {
+        if (rhs.kind() == node_kind::boolean) {
             auto rhs_bool = static_cast<bool>(rhs);
             if (!rhs_bool) {
                 return sym(rational(static_cast<int>(number_), 0));
             } else {
                 return sym(boolean(false));
             }
-        } else if (rhs.type() == typeid(integer)) {
+        } else if (rhs.kind() == node_kind::integer) {
             auto lhs_int = static_cast<int>(number_);
             auto rhs_int = static_cast<int>(rhs);
             return sym(integer(lhs_int % rhs_int));
-        } else if (rhs.type() == typeid(real)) {
+        } else if (rhs.kind() == node_kind::real) {
             auto lhs_double = static_cast<double>(number_);
             auto rhs_double = static_cast<double>(rhs);
             return sym(real(std::fmod(lhs_double, rhs_double)));
-        } else if (rhs.type() == typeid(rational)) {
-            const auto &r = dynamic_cast<const rational &>(rhs);
+        } else if (rhs.kind() == node_kind::rational) {
+            const auto &r = static_cast<const rational &>(rhs);
             auto lhs_int = static_cast<int>(number_) * r.denominator();
             auto rhs_int = static_cast<int>(number_) * r.denominator();
             return sym(rational(lhs_int % rhs_int, r.denominator()));
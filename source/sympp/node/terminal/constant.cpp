@@ -4,6 +4,7 @@
 
 #include "constant.h"
 #include <stack>
+#include <sympp/core/arena.h>
 #include <sympp/core/node_interface.h>
 #include <sympp/core/sym_error.h>
 #include <sympp/node/function/pow.h>
@@ -13,13 +14,47 @@
 
 namespace sympp {
 
-    sym constant::i() {
-        return sym(constant("i", sym(pow(sym(-1), sym(pow(sym(2), sym(-1)))))));
+    namespace {
+        /// Shared constant node
+        /// The node outlives any arena, so it is built on the heap even
+        /// if the first call is inside an arena.
+        sym make_shared_constant(std::string_view name, sym (*value)()) {
+            arena heap(nullptr);
+            return sym(constant(name, value()));
+        }
+
+        /// True if s is the shared constant c or has its value
+        bool is_same_constant(const sym &s, const sym &c) {
+            if (s.kind() != node_kind::constant) {
+                return false;
+            }
+            return s.node_as<node_interface>() == c.node_as<node_interface>() ||
+                   s.compare(c) == 0;
+        }
+    } // namespace
+
+    const sym &constant::i() {
+        static const sym c = make_shared_constant("i", [] {
+            return sym(pow(sym(-1), sym(pow(sym(2), sym(-1)))));
+        });
+        return c;
     }
 
-    sym constant::e() { return sym(constant("e", sym(2.71828))); }
+    const sym &constant::e() {
+        static const sym c =
+            make_shared_constant("e", [] { return sym(2.718281828459045); });
+        return c;
+    }
+
+    const sym &constant::pi() {
+        static const sym c =
+            make_shared_constant("pi", [] { return sym(3.141592653589793); });
+        return c;
+    }
 
-    sym constant::pi() { return sym(constant("pi", sym(3.14159))); }
+    bool constant::is_e(const sym &s) { return is_same_constant(s, e()); }
+
+    bool constant::is_pi(const sym &s) { return is_same_constant(s, pi()); }
 
     constant::constant() = default;
 
@@ -28,16 +63,16 @@ namespace sympp {
     constant::constant(constant &&v) noexcept = default;
 
     constant::constant(std::string_view var_name, double d)
-        : name_(var_name), value_(d) {}
+        : name_id_(symbol_table::intern(var_name)), value_(d) {}
 
     constant::constant(std::string_view var_name, int d)
-        : name_(var_name), value_(d) {}
+        : name_id_(symbol_table::intern(var_name)), value_(d) {}
 
     constant::constant(std::string_view var_name, bool d)
-        : name_(var_name), value_(d) {}
+        : name_id_(symbol_table::intern(var_name)), value_(d) {}
 
     constant::constant(std::string_view var_name, const sym &d)
-        : name_(var_name), value_(d) {}
+        : name_id_(symbol_table::intern(var_name)), value_(d) {}
 
     constant::constant(const node_interface &v)
         : constant(dynamic_cast<const constant &>(v)) {}
@@ -47,10 +82,10 @@ namespace sympp {
     constant::~constant() = default;
 
     int constant::compare(const node_interface &s) const {
-        if (type() != s.type()) {
-            return (type().before(s.type())) ? -1 : +1;
+        if (kind() != s.kind()) {
+            return compare_kinds(kind(), s.kind());
         }
-        const auto &rhs = dynamic_cast<const constant &>(s);
+        const auto &rhs = static_cast<const constant &>(s);
         return value_.compare(rhs.value_);
     }
 
@@ -61,6 +96,11 @@ namespace sympp {
         return sym(integer(0));
     }
 
+    size_t constant::calculate_hash() const {
+        // constants are compared by value only
+        return hash_combine(static_cast<size_t>(kind()), value_.hash());
+    }
+
     double constant::evaluate(const std::vector<uint8_t> &,
                               const std::vector<int> &,
                               const std::vector<double> &) const {
@@ -92,7 +132,7 @@ namespace sympp {
         }
     }
 
-    void constant::stream(std::ostream &os, bool) const { os << name_; }
+    void constant::stream(std::ostream &os, bool) const { os << name(); }
 
     constant::operator double() const {
         return static_cast<double>(this->value_);
@@ -104,13 +144,19 @@ namespace sympp {
 
     sym &constant::value() { return value_; }
 
-    const std::string &constant::name() const { return name_; }
+    const std::string &constant::name() const {
+        return symbol_table::name(name_id_);
+    }
+
+    void constant::name(std::string_view n) {
+        name_id_ = symbol_table::intern(n);
+    }
 
-    std::string &constant::name() { return name_; }
+    symbol_id constant::name_id() const { return name_id_; }
 
     bool constant::is_zero() const {
         if (value().is_number()) {
-            auto n = value().root_node_as<number_interface>();
+            auto n = value().node_as<number_interface>();
             return n->is_zero();
         }
         throw sym_error(sym_error::NotNumeric);
@@ -118,7 +164,7 @@ namespace sympp {
 
     bool constant::is_one() const {
         if (value().is_number()) {
-            auto n = value().root_node_as<number_interface>();
+            auto n = value().node_as<number_interface>();
             return n->is_one();
         }
         throw sym_error(sym_error::NotNumeric);
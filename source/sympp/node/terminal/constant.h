@@ -14,6 +14,7 @@
 
 // Internal
 #include <sympp/core/sym.h>
+#include <sympp/core/symbol_table.h>
 #include <sympp/core/terminal_node_interface.h>
 #include <sympp/node/terminal/number_interface.h>
 
@@ -21,9 +22,23 @@ namespace sympp {
 
     class constant : public terminal_node_interface<constant> {
       public:
-        static sym i();
-        static sym e();
-        static sym pi();
+        /// Kind of this node type
+        static constexpr node_kind kind_value = node_kind::constant;
+
+        /// Built-in constants
+        /// These nodes are created once with the full precision of a
+        /// double and shared by every expression using them.
+        static const sym &i();
+        static const sym &e();
+        static const sym &pi();
+
+        /// True if an expression is the constant e
+        /// Copies of e() share its node, so this is usually a pointer
+        /// comparison.
+        static bool is_e(const sym &);
+
+        /// True if an expression is the constant pi
+        static bool is_pi(const sym &);
 
       public:
         /// Create constant and give it an name
@@ -69,6 +84,9 @@ namespace sympp {
                     bool &leaf, std::stack<std::string> &code_aux,
                     std::string &code) const override;
 
+      protected /* node_interface pure-virtual functions */:
+        [[nodiscard]] size_t calculate_hash() const override;
+
       public /* terminal_node_interface virtual functions */:
         void stream(std::ostream &os, bool b) const override;
 
@@ -87,12 +105,18 @@ namespace sympp {
         const sym &value() const;
         sym &value();
 
-        const std::string &name() const;
-        std::string &name();
+        /// Name of the constant
+        [[nodiscard]] const std::string &name() const;
+
+        /// Rename the constant
+        void name(std::string_view);
+
+        /// Id of the constant name in the symbol table
+        [[nodiscard]] symbol_id name_id() const;
 
       private:
-        /// Name we use to stream this constant
-        std::string name_;
+        /// Id of the name we use to stream this constant
+        symbol_id name_id_{symbol_table::intern("")};
 
         /// Number type of this constant when compiling
         sym value_;
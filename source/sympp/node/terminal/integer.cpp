@@ -67,6 +67,8 @@ namespace sympp {
         return dynamic_cast<node_interface *>(new integer(*this));
     }
 
+    node_kind integer::calculate_kind() const { return kind_value; }
+
     const std::type_info &integer::numeric_type() const { return typeid(int); }
 
     bool integer::is_zero() const { return number_ == 0; }
@@ -76,7 +78,7 @@ namespace sympp {
     bool integer::is_negative() const { return number_ < 0; }
 
     int integer::compare_number(const number_interface &rhs) const {
-        if (rhs.type() == typeid(real)) {
+        if (rhs.kind() == node_kind::real) {
             auto lhs_double = static_cast<double>(number_);
             auto rhs_double = static_cast<double>(rhs);
             if (lhs_double < rhs_double) {
@@ -86,7 +88,7 @@ namespace sympp {
             } else {
                 return 0;
             }
-        } else if (rhs.type() == typeid(integer)) {
+        } else if (rhs.kind() == node_kind::integer) {
             auto rhs_int = static_cast<int>(rhs);
             if (number_ < rhs_int) {
                 return -1;
@@ -95,7 +97,7 @@ namespace sympp {
             } else {
                 return 0;
             }
-        } else if (rhs.type() == typeid(boolean)) {
+        } else if (rhs.kind() == node_kind::boolean) {
             auto rhs_bool = static_cast<bool>(rhs);
             if (!rhs_bool) {
                 if (number_ < 0) {
@@ -114,8 +116,8 @@ namespace sympp {
                     return 0;
                 }
             }
-        } else if (rhs.type() == typeid(rational)) {
-            const auto &r = dynamic_cast<const rational &>(rhs);
+        } else if (rhs.kind() == node_kind::rational) {
+            const auto &r = static_cast<const rational &>(rhs);
             int lhs_int = number_ * r.denominator();
             if (lhs_int > r.numerator()) {
                 return -1;
@@ -135,7 +137,8 @@ namespace sympp {
     integer::operator double() const { return static_cast<double>(number_); }
 
     sym integer::add(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean) || rhs.type() == typeid(integer)) {
+        if (rhs.kind() == node_kind::boolean ||
+            rhs.kind() == node_kind::integer) {
             // might promote the boolean
             auto rhs_int = static_cast<int>(rhs);
             return sym(integer(number_ + rhs_int));
@@ -146,22 +149,22 @@ namespace sympp {
     }
 
     sym integer::sub(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean)) {
+        if (rhs.kind() == node_kind::boolean) {
             auto rhs_bool = static_cast<bool>(rhs);
             if (rhs_bool) {
                 return sym(integer(number_ - 1));
             } else {
                 return sym(integer(number_));
             }
-        } else if (rhs.type() == typeid(integer)) {
+        } else if (rhs.kind() == node_kind::integer) {
             auto rhs_int = static_cast<int>(rhs);
             return sym(integer(number_ - rhs_int));
-        } else if (rhs.type() == typeid(real)) {
+        } else if (rhs.kind() == node_kind::real) {
             auto lhs_double = static_cast<double>(number_);
             auto rhs_double = static_cast<double>(rhs);
             return sym(real(lhs_double - rhs_double));
-        } else if (rhs.type() == typeid(rational)) {
-            const auto &r = dynamic_cast<const rational &>(rhs);
+        } else if (rhs.kind() == node_kind::rational) {
+            const auto &r = static_cast<const rational &>(rhs);
             int lhs_numerator = number_ * r.denominator();
             int result_numerator = lhs_numerator - r.numerator();
             if (result_numerator % r.denominator() == 0) {
@@ -175,7 +178,8 @@ namespace sympp {
     }
 
     sym integer::mul(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean) || rhs.type() == typeid(integer)) {
+        if (rhs.kind() == node_kind::boolean ||
+            rhs.kind() == node_kind::integer) {
             auto rhs_int = static_cast<int>(rhs);
             return sym(integer(number_ * rhs_int));
         } else {
@@ -185,26 +189,26 @@ namespace sympp {
     }
 
     sym integer::div(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean)) {
+        if (rhs.kind() == node_kind::boolean) {
             auto rhs_bool = static_cast<bool>(rhs);
             if (!rhs_bool) {
                 return sym(integer(std::numeric_limits<int>::infinity()));
             } else {
                 return sym(integer(number_));
             }
-        } else if (rhs.type() == typeid(integer)) {
+        } else if (rhs.kind() == node_kind::integer) {
             auto rhs_int = static_cast<int>(rhs);
             if (rhs_int != 0 && number_ % rhs_int == 0) {
                 return sym(integer(number_ / rhs_int));
             } else {
                 return sym(rational(number_, rhs_int));
             }
-        } else if (rhs.type() == typeid(real)) {
+        } else if (rhs.kind() == node_kind::real) {
             auto lhs_double = static_cast<double>(number_);
             auto rhs_double = static_cast<double>(rhs);
             return sym(real(lhs_double / rhs_double));
-        } else if (rhs.type() == typeid(rational)) {
-            const auto &r = dynamic_cast<const rational &>(rhs);
+        } else if (rhs.kind() == node_kind::rational) {
+            const auto &r = static_cast<const rational &>(rhs);
             int result_numerator = number_ * r.denominator();
             if (result_numerator % r.numerator() == 0) {
                 return sym(integer(result_numerator / r.numerator()));
@@ -217,22 +221,22 @@ namespace sympp {
     }
 
     sym integer::mod(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean)) {
+        if (rhs.kind() == node_kind::boolean) {
             auto rhs_bool = static_cast<bool>(rhs);
             if (!rhs_bool) {
                 return sym(rational(static_cast<int>(number_), 0));
             } else {
                 return sym(integer(0));
             }
-        } else if (rhs.type() == typeid(integer)) {
+        } else if (rhs.kind() == node_kind::integer) {
             auto rhs_int = static_cast<int>(rhs);
             return sym(integer(number_ % rhs_int));
-        } else if (rhs.type() == typeid(real)) {
+        } else if (rhs.kind() == node_kind::real) {
             auto lhs_double = static_cast<double>(number_);
             auto rhs_double = static_cast<double>(rhs);
             return sym(real(std::fmod(lhs_double, rhs_double)));
-        } else if (rhs.type() == typeid(rational)) {
-            const auto &r = dynamic_cast<const rational &>(rhs);
+        } else if (rhs.kind() == node_kind::rational) {
+            const auto &r = static_cast<const rational &>(rhs);
             auto lhs_int = static_cast<int>(number_) * r.denominator();
             auto rhs_int = static_cast<int>(number_) * r.denominator();
             return sym(rational(lhs_int % rhs_int, r.denominator()));
@@ -11,6 +11,9 @@ namespace sympp {
 
     class integer : public number_interface {
       public:
+        /// Kind of this node type
+        static constexpr node_kind kind_value = node_kind::integer;
+
         integer();
         integer(const integer &);
         integer(integer &&) noexcept;
@@ -44,6 +47,7 @@ namespace sympp {
         [[nodiscard]] const std::type_info &type() const override;
 
         [[nodiscard]] node_interface *clone() const override;
+        [[nodiscard]] node_kind calculate_kind() const override;
 
       public /* number_interface virtual functions */:
         [[nodiscard]] const std::type_info &numeric_type() const override;
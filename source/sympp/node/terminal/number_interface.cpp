@@ -17,8 +17,11 @@
 
 namespace sympp {
     int number_interface::compare(const node_interface &node) const {
-        const auto &p = dynamic_cast<const number_interface &>(node);
-        return compare_number(p);
+        const auto *p = node.as<number_interface>();
+        if (!p) {
+            return compare_kinds(kind(), node.kind());
+        }
+        return compare_number(*p);
     }
 
     sym number_interface::operator+(const number_interface &n) const {
@@ -63,13 +66,19 @@ namespace sympp {
 
     /// Coefficients
     sym number_interface::coeff(const node_interface &s) const {
-        auto nroot = dynamic_cast<const number_interface *>(&s);
+        auto nroot = s.as<number_interface>();
         if (nroot) {
             return this->div(*nroot);
         }
         return sym(integer(0));
     }
 
+    size_t number_interface::calculate_hash() const {
+        auto d = static_cast<double>(*this);
+        // make sure 0. and -0. have the same hash
+        return std::hash<double>()(d == 0. ? 0. : d);
+    }
+
     number_interface::operator bool() const { return is_one(); }
 
     number_interface::operator int() const {
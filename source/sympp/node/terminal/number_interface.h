@@ -33,6 +33,11 @@ namespace sympp {
         /// Coefficients
         [[nodiscard]] sym coeff(const node_interface &s) const override;
 
+        /// Hash the value of the number
+        /// Numbers of different types can compare equal, so the
+        /// hash only depends on the value as a double
+        [[nodiscard]] size_t calculate_hash() const override;
+
       public /* virtual functions for numbers */:
         /// Type of the base number
         [[nodiscard]] virtual const std::type_info &numeric_type() const = 0;
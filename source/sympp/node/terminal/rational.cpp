@@ -95,7 +95,7 @@ namespace sympp {
     }
 
     rational::rational(const number_interface &v) : rational() {
-        if (v.type() == typeid(rational)) {
+        if (v.kind() == node_kind::rational) {
             const auto &p = dynamic_cast<const rational &>(v);
             *this = p;
         } else {
@@ -167,6 +167,8 @@ namespace sympp {
         return dynamic_cast<node_interface *>(new rational(*this));
     }
 
+    node_kind rational::calculate_kind() const { return kind_value; }
+
     const std::type_info &rational::numeric_type() const {
         return typeid(std::pair<int, int>);
     }
@@ -178,7 +180,7 @@ namespace sympp {
     bool rational::is_negative() const { return numerator_ < 0; }
 
     int rational::compare_number(const number_interface &rhs) const {
-        if (rhs.type() == typeid(real)) {
+        if (rhs.kind() == node_kind::real) {
             auto lhs_double = static_cast<double>(*this);
             auto rhs_double = static_cast<double>(rhs);
             if (lhs_double < rhs_double) {
@@ -188,12 +190,12 @@ namespace sympp {
             } else {
                 return 0;
             }
-        } else if (rhs.type() == typeid(integer)) {
+        } else if (rhs.kind() == node_kind::integer) {
             return rhs.compare(*this) * -1;
-        } else if (rhs.type() == typeid(boolean)) {
+        } else if (rhs.kind() == node_kind::boolean) {
             return rhs.compare(*this) * -1;
-        } else if (rhs.type() == typeid(rational)) {
-            auto &rhsr = dynamic_cast<const rational &>(rhs);
+        } else if (rhs.kind() == node_kind::rational) {
+            auto &rhsr = static_cast<const rational &>(rhs);
             int l = std::lcm(this->denominator_, rhsr.denominator_);
             int n1 = this->numerator_ * (l / this->denominator_);
             int n2 = rhsr.numerator_ * (l / rhsr.denominator_);
@@ -218,14 +220,15 @@ namespace sympp {
     }
 
     sym rational::add(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean) || rhs.type() == typeid(integer)) {
+        if (rhs.kind() == node_kind::boolean ||
+            rhs.kind() == node_kind::integer) {
             // might promote the boolean
             auto rhs_int = static_cast<int>(rhs);
             return sym(
                 rational(numerator_ + rhs_int * denominator_, denominator_));
-        } else if (rhs.type() == typeid(rational)) {
+        } else if (rhs.kind() == node_kind::rational) {
             // might promote the boolean
-            const auto &rhsr = dynamic_cast<const rational &>(rhs);
+            const auto &rhsr = static_cast<const rational &>(rhs);
             int l = std::lcm(this->denominator_, rhsr.denominator_);
             int n1 = this->numerator_ * (l / this->denominator_);
             int n2 = rhsr.numerator_ * (l / rhsr.denominator_);
@@ -237,23 +240,23 @@ namespace sympp {
     }
 
     sym rational::sub(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean)) {
+        if (rhs.kind() == node_kind::boolean) {
             auto rhs_bool = static_cast<bool>(rhs);
             if (rhs_bool) {
                 return sym(rational(numerator_ - denominator_, denominator_));
             } else {
                 return sym(*this);
             }
-        } else if (rhs.type() == typeid(integer)) {
+        } else if (rhs.kind() == node_kind::integer) {
             auto rhs_int = static_cast<int>(rhs);
             return sym(
                 rational(numerator_ - rhs_int * denominator_, denominator_));
-        } else if (rhs.type() == typeid(real)) {
+        } else if (rhs.kind() == node_kind::real) {
             auto lhs_double = static_cast<double>(*this);
             auto rhs_double = static_cast<double>(rhs);
             return sym(real(lhs_double - rhs_double));
-        } else if (rhs.type() == typeid(rational)) {
-            const auto &rhsr = dynamic_cast<const rational &>(rhs);
+        } else if (rhs.kind() == node_kind::rational) {
+            const auto &rhsr = static_cast<const rational &>(rhs);
             int l = std::lcm(this->denominator_, rhsr.denominator_);
             int n1 = this->numerator_ * (l / this->denominator_);
             int n2 = rhsr.numerator_ * (l / rhsr.denominator_);
@@ -264,10 +267,11 @@ namespace sympp {
     }
 
     sym rational::mul(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean) || rhs.type() == typeid(integer)) {
+        if (rhs.kind() == node_kind::boolean ||
+            rhs.kind() == node_kind::integer) {
             auto rhs_int = static_cast<int>(rhs);
             return sym(rational(numerator_ * rhs_int, denominator_));
-        } else if (rhs.type() == typeid(rational)) {
+        } else if (rhs.kind() == node_kind::rational) {
             auto rhsr = static_cast<rational>(rhs);
             return sym(rational(numerator_ * rhsr.numerator_,
                                 denominator_ * rhsr.denominator_));
@@ -278,22 +282,22 @@ namespace sympp {
     }
 
     sym rational::div(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean)) {
+        if (rhs.kind() == node_kind::boolean) {
             auto rhs_bool = static_cast<bool>(rhs);
             if (!rhs_bool) {
                 return sym(integer(std::numeric_limits<int>::infinity()));
             } else {
                 return sym(*this);
             }
-        } else if (rhs.type() == typeid(integer)) {
+        } else if (rhs.kind() == node_kind::integer) {
             auto rhs_int = static_cast<int>(rhs);
             return sym(rational(numerator_, denominator_ * rhs_int));
-        } else if (rhs.type() == typeid(real)) {
+        } else if (rhs.kind() == node_kind::real) {
             auto lhs_double = static_cast<double>(*this);
             auto rhs_double = static_cast<double>(rhs);
             return sym(real(lhs_double / rhs_double));
-        } else if (rhs.type() == typeid(rational)) {
-            const auto &r = dynamic_cast<const rational &>(rhs);
+        } else if (rhs.kind() == node_kind::rational) {
+            const auto &r = static_cast<const rational &>(rhs);
             return sym(rational(numerator_ * r.denominator_,
                                 denominator_ * r.numerator_));
         } else {
@@ -302,23 +306,23 @@ namespace sympp {
     }
 
     sym rational::mod(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean)) {
+        if (rhs.kind() == node_kind::boolean) {
             auto rhs_bool = static_cast<bool>(rhs);
             if (!rhs_bool) {
                 return sym(rational(numerator_, 0));
             } else {
                 return sym(integer(0));
             }
-        } else if (rhs.type() == typeid(integer)) {
+        } else if (rhs.kind() == node_kind::integer) {
             auto rhs_int = static_cast<int>(rhs);
             return sym(
                 rational(numerator_ % (rhs_int * denominator_), denominator_));
-        } else if (rhs.type() == typeid(real)) {
+        } else if (rhs.kind() == node_kind::real) {
             auto lhs_double = static_cast<double>(*this);
             auto rhs_double = static_cast<double>(rhs);
             return sym(real(std::fmod(lhs_double, rhs_double)));
-        } else if (rhs.type() == typeid(rational)) {
-            const auto &rhsr = dynamic_cast<const rational &>(rhs);
+        } else if (rhs.kind() == node_kind::rational) {
+            const auto &rhsr = static_cast<const rational &>(rhs);
             int l = std::lcm(this->denominator_, rhsr.denominator_);
             int n1 = this->numerator_ * (l / this->denominator_);
             int n2 = rhsr.numerator_ * (l / rhsr.denominator_);
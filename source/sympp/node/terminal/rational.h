@@ -11,6 +11,9 @@
 namespace sympp {
     class rational : public number_interface {
       public:
+        /// Kind of this node type
+        static constexpr node_kind kind_value = node_kind::rational;
+
         rational();
         rational(const rational &);
         rational &operator=(const rational &);
@@ -47,6 +50,7 @@ namespace sympp {
         [[nodiscard]] const std::type_info &type() const override;
 
         [[nodiscard]] node_interface *clone() const override;
+        [[nodiscard]] node_kind calculate_kind() const override;
 
         std::optional<sym> simplify(double ratio,
                                     complexity_lambda func) override;
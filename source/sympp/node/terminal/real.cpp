@@ -63,6 +63,8 @@ namespace sympp {
         return dynamic_cast<node_interface *>(new real(*this));
     }
 
+    node_kind real::calculate_kind() const { return kind_value; }
+
     const std::type_info &real::numeric_type() const { return typeid(double); }
 
     bool real::is_zero() const { return number_ == 0.; }
@@ -72,7 +74,7 @@ namespace sympp {
     bool real::is_negative() const { return number_ < 0.; }
 
     int real::compare_number(const number_interface &rhs) const {
-        if (rhs.type() == typeid(real) || rhs.type() == typeid(integer)) {
+        if (rhs.kind() == node_kind::real || rhs.kind() == node_kind::integer) {
             auto rhs_double = static_cast<double>(rhs);
             if (number_ < rhs_double) {
                 return -1;
@@ -81,7 +83,7 @@ namespace sympp {
             } else {
                 return 0;
             }
-        } else if (rhs.type() == typeid(boolean)) {
+        } else if (rhs.kind() == node_kind::boolean) {
             auto rhs_bool = static_cast<bool>(rhs);
             if (!rhs_bool) {
                 if (number_ < 0.) {
@@ -100,8 +102,8 @@ namespace sympp {
                     return 0;
                 }
             }
-        } else if (rhs.type() == typeid(rational)) {
-            const auto &r = dynamic_cast<const rational &>(rhs);
+        } else if (rhs.kind() == node_kind::rational) {
+            const auto &r = static_cast<const rational &>(rhs);
             double lhs_int = number_ * r.denominator();
             if (lhs_int > r.numerator()) {
                 return -1;
@@ -121,8 +123,11 @@ namespace sympp {
     real::operator double() const { return number_; }
 
     sym real::add(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean) || rhs.type() == typeid(integer) ||
-            rhs.type() == typeid(real)) {
+        // rationals delegate to real, so we cannot delegate them back
+        if (rhs.kind() == node_kind::boolean ||
+            rhs.kind() == node_kind::integer ||
+            rhs.kind() == node_kind::rational ||
+            rhs.kind() == node_kind::real) {
             // might promote the boolean
             auto rhs_double = static_cast<double>(rhs);
             return sym(real(number_ + rhs_double));
@@ -133,16 +138,16 @@ namespace sympp {
     }
 
     sym real::sub(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean)) {
+        if (rhs.kind() == node_kind::boolean) {
             auto rhs_bool = static_cast<bool>(rhs);
             if (rhs_bool) {
                 return sym(real(number_ - 1.));
             } else {
                 return sym(real(number_));
             }
-        } else if (rhs.type() == typeid(integer) ||
-                   rhs.type() == typeid(real) ||
-                   rhs.type() == typeid(rational)) {
+        } else if (rhs.kind() == node_kind::integer ||
+                   rhs.kind() == node_kind::real ||
+                   rhs.kind() == node_kind::rational) {
             auto rhs_int = static_cast<double>(rhs);
             return sym(real(number_ - rhs_int));
         } else {
@@ -151,8 +156,7 @@ namespace sympp {
     }
 
     sym real::mul(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean) || rhs.type() == typeid(integer) ||
-            rhs.type() == typeid(rational) || rhs.type() == typeid(real)) {
+        if (is_number_kind(rhs.kind())) {
             auto rhs_double = static_cast<double>(rhs);
             return sym(real(number_ * rhs_double));
         } else {
@@ -161,8 +165,7 @@ namespace sympp {
     }
 
     sym real::div(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean) || rhs.type() == typeid(integer) ||
-            rhs.type() == typeid(rational) || rhs.type() == typeid(real)) {
+        if (is_number_kind(rhs.kind())) {
             auto rhs_double = static_cast<double>(rhs);
             return sym(real(number_ / rhs_double));
         } else {
@@ -171,8 +174,7 @@ namespace sympp {
     }
 
     sym real::mod(const number_interface &rhs) const {
-        if (rhs.type() == typeid(boolean) || rhs.type() == typeid(integer) ||
-            rhs.type() == typeid(rational) || rhs.type() == typeid(real)) {
+        if (is_number_kind(rhs.kind())) {
             auto rhs_double = static_cast<double>(rhs);
             return sym(real(std::fmod(number_, rhs_double)));
         } else {
@@ -10,6 +10,9 @@
 namespace sympp {
     class real : public number_interface {
       public:
+        /// Kind of this node type
+        static constexpr node_kind kind_value = node_kind::real;
+
         real();
         real(const real &);
         real(real &&) noexcept;
@@ -43,6 +46,7 @@ namespace sympp {
         [[nodiscard]] const std::type_info &type() const override;
 
         [[nodiscard]] node_interface *clone() const override;
+        [[nodiscard]] node_kind calculate_kind() const override;
 
       public /* number_interface virtual functions */:
         [[nodiscard]] const std::type_info &numeric_type() const override;
@@ -28,13 +28,14 @@ namespace sympp {
         : variable(numeric_type::var_real, var_name) {}
 
     variable::variable(numeric_type v, std::string_view var_name)
-        : name_(var_name), index_(0), num_type_(v) {}
+        : name_id_(symbol_table::intern(var_name)), index_(0), num_type_(v) {}
 
     variable::variable(std::string_view var_name, numeric_type v)
-        : name_(var_name), index_(0), num_type_(v) {}
+        : name_id_(symbol_table::intern(var_name)), index_(0), num_type_(v) {}
 
     variable::variable(numeric_type v)
-        : name_(generate_var_name()), index_(0), num_type_(v) {}
+        : name_id_(symbol_table::intern(generate_var_name())), index_(0),
+          num_type_(v) {}
 
     variable::variable(const node_interface &v)
         : variable(dynamic_cast<const variable &>(v)) {}
@@ -44,14 +45,14 @@ namespace sympp {
     variable::~variable() = default;
 
     int variable::compare(const node_interface &s) const {
-        if (type() != s.type()) {
-            return (type().before(s.type())) ? -1 : +1;
+        if (kind() != s.kind()) {
+            return compare_kinds(kind(), s.kind());
         }
-        const auto &rhs = dynamic_cast<const variable &>(s);
+        const auto &rhs = static_cast<const variable &>(s);
         if (num_type_ != rhs.num_type_) {
             return (num_type_ < rhs.num_type_) ? -1 : +1;
-        } else if (name_ != rhs.name_) {
-            return (name_ < rhs.name_) ? -1 : +1;
+        } else if (name_id_ != rhs.name_id_) {
+            return (name_id_ < rhs.name_id_) ? -1 : +1;
         } else if (index_ != rhs.index_) {
             return (index_ < rhs.index_) ? -1 : +1;
         }
@@ -65,6 +66,14 @@ namespace sympp {
         return sym(integer(0));
     }
 
+    size_t variable::calculate_hash() const {
+        // the index is not included because it might change
+        // when compiling the expression
+        size_t h = hash_combine(static_cast<size_t>(kind()),
+                                std::hash<symbol_id>()(name_id_));
+        return hash_combine(h, static_cast<size_t>(num_type_));
+    }
+
     double variable::evaluate(const std::vector<uint8_t> &bool_values,
                               const std::vector<int> &int_values,
                               const std::vector<double> &double_values) const {
@@ -174,12 +183,23 @@ namespace sympp {
         std::unordered_map<int, sym> &bool_symbols_vars,
         std::unordered_map<int, sym> &int_symbols_vars,
         std::unordered_map<int, sym> &real_symbols_vars,
-        std::unordered_map<std::string, int> &bool_symbols_names,
-        std::unordered_map<std::string, int> &int_symbols_names,
-        std::unordered_map<std::string, int> &real_symbols_names) {
+        std::unordered_map<symbol_id, int> &bool_symbols_names,
+        std::unordered_map<symbol_id, int> &int_symbols_names,
+        std::unordered_map<symbol_id, int> &real_symbols_names) {
+        this->index_ = find_index(bool_symbols_vars, int_symbols_vars,
+                                  real_symbols_vars, bool_symbols_names,
+                                  int_symbols_names, real_symbols_names);
+    }
 
+    int variable::find_index(
+        std::unordered_map<int, sym> &bool_symbols_vars,
+        std::unordered_map<int, sym> &int_symbols_vars,
+        std::unordered_map<int, sym> &real_symbols_vars,
+        std::unordered_map<symbol_id, int> &bool_symbols_names,
+        std::unordered_map<symbol_id, int> &int_symbols_names,
+        std::unordered_map<symbol_id, int> &real_symbols_names) const {
         std::unordered_map<int, sym> *symbols_vars = nullptr;
-        std::unordered_map<std::string, int> *symbols_names = nullptr;
+        std::unordered_map<symbol_id, int> *symbols_names = nullptr;
         switch (num_type_) {
         case var_integer:
             symbols_vars = &int_symbols_vars;
@@ -194,28 +214,25 @@ namespace sympp {
             symbols_names = &real_symbols_names;
             break;
         }
-        if (symbols_names->empty()) {
-            symbols_names->operator[](this->name_) = 0;
-            symbols_vars->operator[](0) = sym(*this);
-            this->index_ = 0;
-        } else {
-            // Look for index
-            auto search_name = symbols_names->find(this->name_);
-            // If not found, add new variable and index
-            if (search_name == symbols_names->end()) {
-                int cur_index = static_cast<int>(symbols_names->size());
-                symbols_names->operator[](this->name_) = cur_index;
-                symbols_vars->operator[](cur_index) = (sym) * this;
-                this->index_ = cur_index;
-
-            } else {
-                // If found, update symbol index
-                this->index_ = search_name->second;
-            }
+        // Look for index
+        auto search_name = symbols_names->find(this->name_id_);
+        if (search_name != symbols_names->end()) {
+            return search_name->second;
         }
+        // If not found, add new variable and index
+        int cur_index = static_cast<int>(symbols_names->size());
+        symbols_names->operator[](this->name_id_) = cur_index;
+        symbols_vars->operator[](cur_index) = sym(*this);
+        return cur_index;
+    }
+
+    void variable::stream(std::ostream &os, bool) const { os << name(); }
+
+    const std::string &variable::name() const {
+        return symbol_table::name(name_id_);
     }
 
-    void variable::stream(std::ostream &os, bool) const { os << name_; }
+    symbol_id variable::name_id() const { return name_id_; }
 
     int variable::index() const { return index_; }
 
@@ -14,12 +14,16 @@
 
 // Internal
 #include <sympp/core/sym.h>
+#include <sympp/core/symbol_table.h>
 #include <sympp/core/terminal_node_interface.h>
 
 namespace sympp {
 
     class variable : public terminal_node_interface<variable> {
       public:
+        /// Kind of this node type
+        static constexpr node_kind kind_value = node_kind::variable;
+
         /// Create variable and give it an name
         variable();
 
@@ -65,19 +69,38 @@ namespace sympp {
                     bool &leaf, std::stack<std::string> &code_aux,
                     std::string &code) const override;
 
+      protected /* node_interface pure-virtual functions */:
+        [[nodiscard]] size_t calculate_hash() const override;
+
       public /* node_interface virtual functions */:
         void put_indexes(
             std::unordered_map<int, sym> &bool_symbols_vars,
             std::unordered_map<int, sym> &int_symbols_vars,
             std::unordered_map<int, sym> &real_symbols_vars,
-            std::unordered_map<std::string, int> &bool_symbols_names,
-            std::unordered_map<std::string, int> &int_symbols_names,
-            std::unordered_map<std::string, int> &real_symbols_names) override;
+            std::unordered_map<symbol_id, int> &bool_symbols_names,
+            std::unordered_map<symbol_id, int> &int_symbols_names,
+            std::unordered_map<symbol_id, int> &real_symbols_names) override;
+
+        /// Index put_indexes gives this variable
+        /// A new name is added to the maps, as put_indexes does
+        int find_index(
+            std::unordered_map<int, sym> &bool_symbols_vars,
+            std::unordered_map<int, sym> &int_symbols_vars,
+            std::unordered_map<int, sym> &real_symbols_vars,
+            std::unordered_map<symbol_id, int> &bool_symbols_names,
+            std::unordered_map<symbol_id, int> &int_symbols_names,
+            std::unordered_map<symbol_id, int> &real_symbols_names) const;
 
       public /* terminal_node_interface virtual functions */:
         void stream(std::ostream &os, bool b) const override;
 
       public /* getters and setters */:
+        /// Name of the variable
+        [[nodiscard]] const std::string &name() const;
+
+        /// Id of the variable name in the symbol table
+        [[nodiscard]] symbol_id name_id() const;
+
         /// Index for compiling
         [[nodiscard]] int index() const;
 
@@ -93,8 +116,8 @@ namespace sympp {
         static std::string generate_var_name();
 
       private:
-        /// Name we use to stream this variable
-        std::string name_;
+        /// Id of the name we use to stream this variable
+        symbol_id name_id_{0};
 
         /// Index of this variable when compiling the function
         int index_{0};
@@ -2,11 +2,24 @@
 #define SYMPP_H
 
 // Main library objects
+#include <sympp/core/arena.h>
+#include <sympp/core/bytecode.h>
+#include <sympp/core/cse.h>
+#include <sympp/core/e_graph.h>
 #include <sympp/core/internal_node_interface.h>
 #include <sympp/core/node_interface.h>
+#include <sympp/core/node_kind.h>
+#include <sympp/core/rewrite_rule.h>
+#include <sympp/core/simplifier.h>
+#include <sympp/core/simplify_memo.h>
 #include <sympp/core/sym.h>
+#include <sympp/core/sym_builder.h>
 #include <sympp/core/sym_error.h>
+#include <sympp/core/symbol_table.h>
+#include <sympp/core/tape.h>
 #include <sympp/core/terminal_node_interface.h>
+#include <sympp/core/thread_pool.h>
+#include <sympp/core/unique_table.h>
 
 // Nodes that represent a symbol
 #include <sympp/node/terminal/boolean.h>
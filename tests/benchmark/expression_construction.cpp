@@ -0,0 +1,72 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <sympp/sympp.h>
+
+// Count the heap allocations in this process
+static std::atomic<size_t> heap_allocations{0};
+
+void *operator new(size_t size) {
+    ++heap_allocations;
+    if (void *p = std::malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+// Build the rastrigin function with n variables, then
+// modify a copy of it, which clones the nodes on the path
+void build_rastrigin(int n) {
+    using namespace sympp;
+    sym A("A", 10);
+    sym pi = constant::pi();
+    sym x0("x_0");
+    sym f = A * n;
+    for (int i = 0; i < n; ++i) {
+        sym x("x_" + std::to_string(i));
+        f = f + sympp::pow(x, sym(2)) - A * sympp::cos(2 * pi * x);
+    }
+    sym g = f;
+    g.subs(x0, sym(1));
+    benchmark::DoNotOptimize(f);
+    benchmark::DoNotOptimize(g);
+}
+
+static void heap_construction(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    size_t allocations = 0;
+    for (auto _ : state) {
+        size_t before = heap_allocations;
+        build_rastrigin(n);
+        allocations += heap_allocations - before;
+    }
+    state.counters["allocations"] = benchmark::Counter(
+        static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(heap_construction)->RangeMultiplier(4)->Range(4, 256);
+
+static void arena_construction(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    size_t allocations = 0;
+    for (auto _ : state) {
+        size_t before = heap_allocations;
+        {
+            sympp::arena a;
+            build_rastrigin(n);
+        }
+        allocations += heap_allocations - before;
+    }
+    state.counters["allocations"] = benchmark::Counter(
+        static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(arena_construction)->RangeMultiplier(4)->Range(4, 256);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,214 @@
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <sympp/sympp.h>
+
+// Rastrigin model with n variables where every term repeats
+// cos(2*pi*x_i)
+sympp::sym build_model(int n) {
+    using namespace sympp;
+    sym A("A", 10);
+    sym f = A * n;
+    for (int i = 0; i < n; ++i) {
+        sym x("x_" + std::to_string(i));
+        sym c = sym(sympp::cos(2 * constant::pi() * x));
+        f = f + sym(sympp::pow(x, sym(2))) - A * c + c * x;
+    }
+    f.put_indexes();
+    return f;
+}
+
+// Evaluate the expression tree
+static void evaluate_tree(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::sym f = build_model(n);
+    std::vector<double> x(n, 0.5);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(f.evaluate({}, {}, x));
+    }
+}
+BENCHMARK(evaluate_tree)->RangeMultiplier(4)->Range(4, 1024);
+
+// Evaluate the expression tree with 2*pi folded into one number
+static void evaluate_folded(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::sym f = build_model(n);
+    f.fold_constants();
+    std::vector<double> x(n, 0.5);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(f.evaluate({}, {}, x));
+    }
+}
+BENCHMARK(evaluate_folded)->RangeMultiplier(4)->Range(4, 1024);
+
+// Evaluate the expression in one pass over its tape
+static void evaluate_tape(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    const sympp::tape t = build_model(n).to_tape();
+    std::vector<double> x(n, 0.5);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(t.evaluate({}, {}, x));
+    }
+}
+BENCHMARK(evaluate_tape)->RangeMultiplier(4)->Range(4, 1024);
+
+// Evaluate the expression with the repeated subexpressions once
+static void evaluate_cse(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::sym f = build_model(n);
+    sympp::cse program(f);
+    std::vector<double> x(n, 0.5);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(program.evaluate({}, {}, x));
+    }
+    state.counters["eliminated"] =
+        benchmark::Counter(static_cast<double>(program.eliminated_ops()));
+}
+BENCHMARK(evaluate_cse)->RangeMultiplier(4)->Range(4, 1024);
+
+// Evaluate the lambdified expression
+static void evaluate_lambdify(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::sym f = build_model(n);
+    sympp::node_lambda l = f.lambdify();
+    std::vector<double> x(n, 0.5);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(l({}, {}, x));
+    }
+}
+BENCHMARK(evaluate_lambdify)->RangeMultiplier(4)->Range(4, 1024);
+
+// Evaluate the expression compiled to bytecode
+static void evaluate_bytecode(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::bytecode program(build_model(n));
+    std::vector<double> x(n, 0.5);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(program.evaluate({}, {}, x));
+    }
+}
+BENCHMARK(evaluate_bytecode)->RangeMultiplier(4)->Range(4, 1024);
+
+// Compile the expression to bytecode
+static void compile_bytecode(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::sym f = build_model(n);
+    for (auto _ : state) {
+        sympp::bytecode program(f);
+        benchmark::DoNotOptimize(program.instructions().data());
+    }
+}
+BENCHMARK(compile_bytecode)->RangeMultiplier(4)->Range(4, 1024);
+
+// Dense polynomial of degree n in x whose coefficients are
+// polynomials in y
+sympp::sym build_polynomial(int n) {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    sym f(0);
+    for (int k = 0; k <= n; ++k) {
+        f = f + (k + 1) * sym(sympp::pow(x, sym(k))) *
+                    sym(sympp::pow(y, sym(k % 3)));
+    }
+    f.put_indexes();
+    return f;
+}
+
+// Evaluate the polynomial expanded, in Horner form, and in Estrin form
+static void evaluate_polynomial(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    const auto form = static_cast<sympp::polynomial_form>(state.range(1));
+    sympp::cse program(build_polynomial(n), form);
+    std::vector<double> x{0.9, 1.1};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(program.evaluate({}, {}, x));
+    }
+    state.counters["ops"] =
+        benchmark::Counter(static_cast<double>(program.ops()));
+}
+BENCHMARK(evaluate_polynomial)->ArgsProduct({{8, 64, 512}, {0, 1, 2}});
+
+// Sum of integer powers, square roots and exponentials of n variables
+sympp::sym build_powers(int n) {
+    using namespace sympp;
+    sym f(0);
+    for (int i = 0; i < n; ++i) {
+        sym x("x_" + std::to_string(i));
+        f = f + sym(sympp::pow(x, sym(i % 9 + 2))) + sympp::sqrt(x) +
+            sympp::exp(x) / x;
+    }
+    f.put_indexes();
+    return f;
+}
+
+// Evaluate the powers with multiplications, sqrt and exp
+static void evaluate_powers(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::node_lambda l = build_powers(n).lambdify();
+    std::vector<double> x(n, 1.5);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(l({}, {}, x));
+    }
+}
+BENCHMARK(evaluate_powers)->RangeMultiplier(4)->Range(4, 1024);
+
+// Number of points in the batch benchmarks
+constexpr size_t points = 4096;
+
+// Evaluate the model at many points one point at a time
+static void evaluate_points(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::node_lambda l = build_model(n).lambdify();
+    std::vector<double> x(n);
+    std::vector<double> out(points);
+    for (auto _ : state) {
+        for (size_t j = 0; j < points; ++j) {
+            std::fill(x.begin(), x.end(), 0.001 * static_cast<double>(j));
+            out[j] = l({}, {}, x);
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * points);
+}
+BENCHMARK(evaluate_points)->RangeMultiplier(4)->Range(4, 256);
+
+// Evaluate the model at many points a block at a time
+static void evaluate_batch(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::batch_lambda l = build_model(n).lambdify_batch();
+    std::vector<double> x(points);
+    for (size_t j = 0; j < points; ++j) {
+        x[j] = 0.001 * static_cast<double>(j);
+    }
+    std::vector<const double *> columns(n, x.data());
+    std::vector<double> out(points);
+    for (auto _ : state) {
+        l(points, {}, {}, columns, out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * points);
+}
+BENCHMARK(evaluate_batch)->RangeMultiplier(4)->Range(4, 256);
+
+// Evaluate the model at many points with the SIMD kernels
+static void evaluate_batch_simd(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::batch_lambda l =
+        build_model(n).lambdify_batch(sympp::execution::simd);
+    std::vector<double> x(points);
+    for (size_t j = 0; j < points; ++j) {
+        x[j] = 0.001 * static_cast<double>(j);
+    }
+    std::vector<const double *> columns(n, x.data());
+    std::vector<double> out(points);
+    for (auto _ : state) {
+        l(points, {}, {}, columns, out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * points);
+}
+BENCHMARK(evaluate_batch_simd)->RangeMultiplier(4)->Range(4, 256);
+
+BENCHMARK_MAIN();
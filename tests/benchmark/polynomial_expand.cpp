@@ -0,0 +1,47 @@
+#include <benchmark/benchmark.h>
+#include <sympp/sympp.h>
+
+// Expand (x+y+z+1)^n
+static void expand_power(benchmark::State &state) {
+    using namespace sympp;
+    const auto n = static_cast<int>(state.range(0));
+    sym x("x");
+    sym y("y");
+    sym z("z");
+    sym p(sympp::pow(x + y + z + 1, sym(n)));
+    size_t terms = 0;
+    for (auto _ : state) {
+        sym e = p;
+        e.expand();
+        terms = e.size();
+        benchmark::DoNotOptimize(e);
+    }
+    state.counters["terms"] = static_cast<double>(terms);
+}
+BENCHMARK(expand_power)
+    ->DenseRange(5, 20, 5)
+    ->Unit(benchmark::kMillisecond);
+
+// Expand the product of n copies of (x+y+z+1)
+static void expand_product(benchmark::State &state) {
+    using namespace sympp;
+    const auto n = static_cast<int>(state.range(0));
+    sym x("x");
+    sym y("y");
+    sym z("z");
+    sym_builder b(node_kind::product);
+    for (int i = 0; i < n; ++i) {
+        b.push_back(x + y + z + 1);
+    }
+    sym p = b.build();
+    for (auto _ : state) {
+        sym e = p;
+        e.expand();
+        benchmark::DoNotOptimize(e);
+    }
+}
+BENCHMARK(expand_product)
+    ->DenseRange(5, 20, 5)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,47 @@
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <sympp/sympp.h>
+
+// Monomial with n factors x_i^k over m variables, as the ones
+// product::expand_powers creates, so many factors have the same base
+sympp::sym build_monomial(int n) {
+    using namespace sympp;
+    const int m = 64;
+    std::vector<sym> x;
+    for (int i = 0; i < m; ++i) {
+        x.emplace_back("x_" + std::to_string(i));
+    }
+    sym_builder b(node_kind::product);
+    b.reserve(static_cast<size_t>(n));
+    for (int k = 0; k < n; ++k) {
+        const int i = (k * 7) % m;
+        if (k % 13 == 0) {
+            b.push_back(sym(k % 3 + 2));
+        } else if (k % 3 == 0) {
+            b.push_back(sym(sympp::pow(x[i], sym(k % 4 + 2))));
+        } else {
+            b.push_back(x[i]);
+        }
+    }
+    return b.build();
+}
+
+static void collect_factors(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::sym p = build_monomial(n);
+    for (auto _ : state) {
+        sympp::sym c = p;
+        c.collect();
+        benchmark::DoNotOptimize(c);
+    }
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(collect_factors)
+    ->RangeMultiplier(10)
+    ->Range(10, 10000)
+    ->Unit(benchmark::kMicrosecond)
+    ->Complexity();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,123 @@
+#include <chrono>
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <sympp/sympp.h>
+
+// Rastrigin-like model with n variables where every term
+// repeats the same shifted subexpression
+sympp::sym build_model(int n) {
+    using namespace sympp;
+    sym A("A", 10);
+    sym f = A * n;
+    for (int i = 0; i < n; ++i) {
+        sym x("x_" + std::to_string(i));
+        sym shift = x + x + 1;
+        f = f + sympp::pow(shift, sym(2)) - A * sympp::cos(shift);
+    }
+    return f;
+}
+
+// Simplify a new model every iteration
+static void simplify_model(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        sympp::sym f = build_model(n);
+        state.ResumeTiming();
+        f.simplify();
+        benchmark::DoNotOptimize(f);
+    }
+}
+BENCHMARK(simplify_model)->RangeMultiplier(4)->Range(4, 256);
+
+// Simplify a new model with a memo for the shared subtrees
+static void simplify_model_memo(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        sympp::sym f = build_model(n);
+        state.ResumeTiming();
+        sympp::simplify_memo memo;
+        f.simplify();
+        benchmark::DoNotOptimize(f);
+    }
+}
+BENCHMARK(simplify_model_memo)->RangeMultiplier(4)->Range(4, 256);
+
+// Simplify a new model with the terms on the thread pool
+static void simplify_model_parallel(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        sympp::sym f = build_model(n);
+        state.ResumeTiming();
+        f.simplify(sympp::execution::par);
+        benchmark::DoNotOptimize(f);
+    }
+    state.counters["threads"] = benchmark::Counter(
+        static_cast<double>(sympp::thread_pool::global().size() + 1));
+}
+BENCHMARK(simplify_model_parallel)->RangeMultiplier(4)->Range(4, 4096);
+
+// Simplify a model that is already in normal form
+static void resimplify_model(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::sym f = build_model(n);
+    f.simplify();
+    for (auto _ : state) {
+        f.simplify();
+        benchmark::DoNotOptimize(f);
+    }
+}
+BENCHMARK(resimplify_model)->RangeMultiplier(4)->Range(4, 256);
+
+// Search for a simpler model with a time budget
+static void simplify_model_budget(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::sym f = build_model(n);
+    sympp::simplifier s =
+        sympp::simplifier().max_time(std::chrono::milliseconds(1));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(s(f));
+    }
+    state.counters["candidates"] =
+        benchmark::Counter(static_cast<double>(s.candidates()));
+}
+BENCHMARK(simplify_model_budget)->RangeMultiplier(4)->Range(4, 256);
+
+// Saturate an e-graph with the model and extract the cheapest form
+static void simplify_model_e_graph(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::sym f = build_model(n);
+    sympp::e_graph::limits l;
+    l.max_time = std::chrono::milliseconds(10);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sympp::e_graph::simplify(f, l));
+    }
+}
+BENCHMARK(simplify_model_e_graph)->RangeMultiplier(4)->Range(4, 256);
+
+// Apply the trigsimp rules to a model with sin^2+cos^2 in every term
+static void trigsimp_model(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::sym f = build_model(n);
+    auto square = [](const sympp::sym &x) {
+        return sympp::sym(sympp::pow(x, sympp::sym(2)));
+    };
+    for (int i = 0; i < n; ++i) {
+        sympp::sym x("x_" + std::to_string(i));
+        f = f + square(sympp::sym(sympp::sin(x))) +
+            square(sympp::sym(sympp::cos(x)));
+    }
+    for (auto _ : state) {
+        sympp::sym g = f;
+        g.trigsimp();
+        benchmark::DoNotOptimize(g);
+    }
+    state.counters["attempts"] = benchmark::Counter(
+        static_cast<double>(sympp::rule_set::trigsimp().attempts()));
+}
+BENCHMARK(trigsimp_model)->RangeMultiplier(4)->Range(4, 256);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,46 @@
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <sympp/sympp.h>
+
+// Sum with n terms c*x_i*x_j over m variables, so many
+// terms have the same coefficient-free part
+sympp::sym build_polynomial(int n) {
+    using namespace sympp;
+    const int m = 64;
+    std::vector<sym> x;
+    for (int i = 0; i < m; ++i) {
+        x.emplace_back("x_" + std::to_string(i));
+    }
+    sym_builder b;
+    b.reserve(static_cast<size_t>(n));
+    for (int k = 0; k < n; ++k) {
+        const int i = k % m;
+        const int j = (k / m) % m;
+        if (k % 7 == 0) {
+            b.push_back(sym(k % 5));
+        } else {
+            b.push_back(sym(k % 11 + 1) * x[i] * x[j]);
+        }
+    }
+    return b.build();
+}
+
+static void collect_terms(benchmark::State &state) {
+    const auto n = static_cast<int>(state.range(0));
+    sympp::sym p = build_polynomial(n);
+    for (auto _ : state) {
+        sympp::sym c = p;
+        c.collect();
+        benchmark::DoNotOptimize(c);
+    }
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(collect_terms)
+    ->RangeMultiplier(10)
+    ->Range(100, 1000000)
+    ->Unit(benchmark::kMillisecond)
+    ->Complexity();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,1197 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <memory_resource>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <sympp/sympp.h>
+
+TEST_CASE("Copy on write") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    sym a = x + y;
+    sym b = a;
+    REQUIRE(a.is_shared());
+    REQUIRE(b.is_shared());
+    REQUIRE(std::as_const(a).root_node() == std::as_const(b).root_node());
+
+    // modifying the copy doesn't change the original
+    b.subs(x, y);
+    REQUIRE_FALSE(a.is_shared());
+    REQUIRE(a.compare(x + y) == 0);
+    REQUIRE(b.compare(y + y) == 0);
+
+    // element access detaches the node too
+    sym c = a;
+    c[0] = sym(2);
+    REQUIRE(a[0].compare(x) == 0);
+    REQUIRE(c[0].compare(sym(2)) == 0);
+
+    // substitution only detaches the subtrees that change
+    sym w("w");
+    sym z("z");
+    sym q("q");
+    sym e = x * y + w * sympp::sin(z);
+    auto term = [&](const sym &s, const sym &t) {
+        for (const sym &child : s) {
+            if (child.compare(t) == 0) {
+                return child.node_as<node_interface>();
+            }
+        }
+        return static_cast<const node_interface *>(nullptr);
+    };
+    const node_interface *untouched = term(e, w * sympp::sin(z));
+    REQUIRE(untouched != nullptr);
+    sym d = e;
+    d.subs(x, q);
+    REQUIRE(d.compare(q * y + w * sympp::sin(z)) == 0);
+    REQUIRE(term(d, w * sympp::sin(z)) == untouched);
+    // substituting a symbol that does not occur keeps the whole tree
+    sym f = e;
+    f.subs(q, x);
+    REQUIRE(std::as_const(f).root_node() == std::as_const(e).root_node());
+    // so does expanding a tree that is already expanded
+    f.expand();
+    REQUIRE(term(f, w * sympp::sin(z)) == untouched);
+    // reading the terms does not detach the node
+    sym g = e;
+    REQUIRE(g.calculate_function_type() == function_type::nonlinear);
+    REQUIRE(std::as_const(g).root_node() == std::as_const(e).root_node());
+}
+
+TEST_CASE("Hash-consing") {
+    using namespace sympp;
+    unique_table::clear();
+    unique_table::enable(true);
+    sym x("x");
+    sym a(sympp::cos(2 * x));
+    sym b(sympp::cos(2 * x));
+    REQUIRE(std::as_const(a).root_node() == std::as_const(b).root_node());
+    REQUIRE(a.compare(b) == 0);
+    REQUIRE(unique_table::hits() > 0);
+    REQUIRE(unique_table::hit_rate() > 0.);
+
+    // modifying a shared node doesn't change the other syms
+    b.subs(x, sym(1));
+    REQUIRE(a.compare(sym(sympp::cos(2 * x))) == 0);
+
+    // identical nodes must have the same type
+    sym i(1);
+    sym r(1.);
+    REQUIRE(i.is_integer_number());
+    REQUIRE(r.is_real_number());
+    unique_table::enable(false);
+}
+
+TEST_CASE("Structural hash") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    sym a = x + 2 * y;
+    sym b = 2 * y + x;
+    REQUIRE(a.hash() == b.hash());
+    REQUIRE(a == b);
+    REQUIRE(a != x + y);
+    REQUIRE(sym(2).hash() == sym(2.).hash());
+    // nodes of different kinds with the same children hash apart
+    REQUIRE(sym(sympp::sin(x)).hash() != sym(sympp::cos(x)).hash());
+    REQUIRE(sym(x + y).hash() != sym(x * y).hash());
+
+    // the hash is invalidated when the node is modified
+    sym c = a;
+    c.subs(x, y);
+    REQUIRE(c.hash() != a.hash());
+    REQUIRE(c.hash() == sym(y + 2 * y).hash());
+
+    std::unordered_set<sym> s;
+    s.insert(a);
+    s.insert(b);
+    s.insert(c);
+    REQUIRE(s.size() == 2);
+    REQUIRE(s.count(x + 2 * y) == 1);
+
+    // copies share the node, and threads can read them at once
+    sym e = x + y + 2 * x * y;
+    e[0] = sym("w");
+    sym e1 = e;
+    sym e2 = e;
+    std::vector<size_t> hashes(4);
+    std::vector<int> equal(4);
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < 4; ++i) {
+        readers.emplace_back([&, i] {
+            const sym &r = i % 2 ? e1 : e2;
+            hashes[i] = r.hash();
+            equal[i] = r == e;
+        });
+    }
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    REQUIRE(std::all_of(hashes.begin(), hashes.end(),
+                        [&](size_t h) { return h == hashes[0]; }));
+    REQUIRE(std::all_of(equal.begin(), equal.end(), [](int v) { return v; }));
+}
+
+TEST_CASE("Node kind") {
+    using namespace sympp;
+    sym x("x");
+    sym a = 2 * x + sympp::sin(x);
+    REQUIRE(a.kind() == node_kind::summation);
+    REQUIRE(x.kind() == node_kind::variable);
+    REQUIRE(sym(2).is_number());
+    REQUIRE(sym(2).kind() == node_kind::integer);
+    REQUIRE(sym(2.5).kind() == node_kind::real);
+    REQUIRE(sym(sympp::sin(x)).is_function());
+    REQUIRE(sym(2 * x).is<product>());
+    REQUIRE_FALSE(x.is_function());
+
+    // checked casts return null for other node kinds
+    REQUIRE(x.node_as<variable>() != nullptr);
+    REQUIRE(x.node_as<number_interface>() == nullptr);
+    REQUIRE(sym(2).node_as<number_interface>() != nullptr);
+    REQUIRE(sym(2).root_node_as<real>() == nullptr);
+}
+
+TEST_CASE("Arena") {
+    using namespace sympp;
+    sym x("x");
+    REQUIRE(arena::current() == nullptr);
+    std::pmr::monotonic_buffer_resource buffer;
+    {
+        arena a(&buffer);
+        REQUIRE(arena::current() == &buffer);
+        sym y("y");
+        sym e = 2 * x + y;
+        sym c = e;
+        c.subs(y, x);
+        REQUIRE(e == 2 * x + y);
+        REQUIRE(c == 2 * x + x);
+        {
+            // nested arenas
+            arena b;
+            REQUIRE(arena::current() == b.resource());
+            sym z = e * y;
+            REQUIRE(z.size() == 2);
+        }
+        REQUIRE(arena::current() == &buffer);
+    }
+    REQUIRE(arena::current() == nullptr);
+    // the built-in constants outlive the arena they are first used in
+    std::vector<std::byte> storage(1 << 16);
+    auto in_storage = [&](const sym &s) {
+        const auto *p =
+            reinterpret_cast<const std::byte *>(s.node_as<node_interface>());
+        return p >= storage.data() && p < storage.data() + storage.size();
+    };
+    {
+        std::pmr::monotonic_buffer_resource small(storage.data(),
+                                                  storage.size());
+        arena a(&small);
+        sym y = x * constant::pi() + constant::i();
+        REQUIRE(in_storage(y));
+        REQUIRE_FALSE(in_storage(constant::pi()));
+        REQUIRE_FALSE(in_storage(constant::i()));
+        {
+            // a null resource allocates from the heap
+            arena heap(nullptr);
+            REQUIRE(arena::current() == nullptr);
+            REQUIRE_FALSE(in_storage(x + y));
+        }
+        REQUIRE(arena::current() == &small);
+    }
+    std::fill(storage.begin(), storage.end(), std::byte{0xff});
+    sym z("z");
+    std::stringstream ss;
+    ss << z + constant::pi() + constant::i();
+    REQUIRE(ss.str().find("pi") != std::string::npos);
+    REQUIRE(constant::is_pi(constant::pi()));
+}
+
+TEST_CASE("Inline numbers") {
+    using namespace sympp;
+    sym a(2);
+    sym b = a;
+    REQUIRE_FALSE(a.is_shared());
+    REQUIRE_FALSE(b.is_shared());
+    REQUIRE(a == b);
+    REQUIRE(a.hash() == b.hash());
+    b = sym(3.5);
+    REQUIRE(a == sym(2));
+    REQUIRE(b.kind() == node_kind::real);
+    sym x("x");
+    sym e = x + 2;
+    REQUIRE(e.is_shared() == false);
+    for (size_t i = 0; i < e.size(); ++i) {
+        if (std::as_const(e)[i].is_number()) {
+            // assign a child to its parent
+            e = std::as_const(e)[i];
+            break;
+        }
+    }
+    REQUIRE(e == sym(2));
+    e = x;
+    REQUIRE(e == x);
+    std::vector<sym> v(100, sym(1));
+    v.emplace_back(x);
+    v.resize(1000, sym(2));
+    REQUIRE(v[0] == sym(1));
+    REQUIRE(v[100] == x);
+    REQUIRE(v[999] == sym(2));
+}
+
+TEST_CASE("Symbol table") {
+    using namespace sympp;
+    symbol_id a = symbol_table::intern("symbol_table_a");
+    symbol_id b = symbol_table::intern("symbol_table_b");
+    REQUIRE(a != b);
+    REQUIRE(symbol_table::intern("symbol_table_a") == a);
+    REQUIRE(symbol_table::name(a) == "symbol_table_a");
+    size_t n = symbol_table::size();
+    sym x("symbol_table_a");
+    sym y("symbol_table_a");
+    REQUIRE(symbol_table::size() == n);
+    REQUIRE(x.node_as<variable>()->name_id() == a);
+    REQUIRE(x == y);
+    REQUIRE(x.hash() == y.hash());
+    REQUIRE(x != sym("symbol_table_b"));
+    REQUIRE_FALSE(x.is_shared());
+    std::stringstream ss;
+    ss << x;
+    REQUIRE(ss.str() == "symbol_table_a");
+    sym pi = constant::pi();
+    REQUIRE(pi.node_as<constant>()->name() == "pi");
+}
+
+TEST_CASE("Builders") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    std::vector<sym> terms = {x, y, sym(2)};
+    sym s = sum(terms);
+    REQUIRE(s.is_summation());
+    REQUIRE(s.size() == 3);
+    REQUIRE(s == x + y + 2);
+    REQUIRE(terms.size() == 3);
+    sym p = prod(terms);
+    REQUIRE(p.is_product());
+    REQUIRE(p.size() == 3);
+    REQUIRE(sum(std::vector<sym>()) == sym(0));
+    REQUIRE(prod(std::vector<sym>()) == sym(1));
+    REQUIRE(sum(std::vector<sym>({x})) == x);
+    int numbers[] = {1, 2, 3};
+    REQUIRE(sum(numbers).size() == 3);
+
+    sym_builder b;
+    for (int i = 0; i < 100; ++i) {
+        b.push_back(sym(i) * x);
+    }
+    REQUIRE(b.size() == 100);
+    sym e = b.build();
+    REQUIRE(e.size() == 100);
+    REQUIRE(b.size() == 0);
+    REQUIRE_THROWS_AS(sym_builder(node_kind::pow), sym_error);
+
+    // += appends to the same node unless it is shared
+    sym a = x + y;
+    sym c = a;
+    for (int i = 0; i < 10; ++i) {
+        a += sym(i);
+    }
+    REQUIRE(a.size() == 12);
+    REQUIRE(c.size() == 2);
+    REQUIRE(c == x + y);
+
+    // nested sums are flattened when stealing their terms
+    sym f = (x + y) + (y + x);
+    REQUIRE(f.size() == 4);
+    sym g = std::move(c) * (x * y);
+    REQUIRE(g.size() == 3);
+}
+
+TEST_CASE("Canonical order") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    sym z("z");
+    auto str = [](const sym &s) {
+        std::stringstream ss;
+        ss << s;
+        return ss.str();
+    };
+    // the order of the terms does not matter
+    REQUIRE(str(x + y + z) == str(z + y + x));
+    REQUIRE(str(x * y * z) == str(y * z * x));
+    REQUIRE((x + y + z).compare(z + x + y) == 0);
+    REQUIRE((x + y).hash() == (y + x).hash());
+    // numbers come first
+    REQUIRE(str(x + 2) == str(2 + x));
+    REQUIRE((x + 2)[0].is_number());
+    // merging two sums keeps the terms sorted
+    sym a = x + z;
+    sym b = y + sym(3);
+    sym c = a + b;
+    REQUIRE(c.size() == 4);
+    auto is_sorted = [](const sym &s) {
+        for (size_t i = 1; i < s.size(); ++i) {
+            if (s[i - 1].compare(s[i]) > 0) {
+                return false;
+            }
+        }
+        return true;
+    };
+    REQUIRE(is_sorted(c));
+    // the order is restored after the children change
+    c.subs(z, sym("w"));
+    REQUIRE(is_sorted(c));
+    REQUIRE(c == x + y + sym("w") + 3);
+    // const functions never move the children
+    sym d = x + y + z;
+    d[0] = sym("zz");
+    const sym *first = &d[0];
+    REQUIRE(d.hash() == (y + z + sym("zz")).hash());
+    REQUIRE(d == y + z + sym("zz"));
+    REQUIRE(str(d) == str(y + z + sym("zz")));
+    REQUIRE(&std::as_const(d)[0] == first);
+    REQUIRE(&d[0] == first);
+    // operations that modify the node sort the children again
+    d.collect();
+    REQUIRE(is_sorted(d));
+    // commutative statements
+    REQUIRE(eq(x, y + z).compare(eq(z + y, x)) == 0);
+    REQUIRE(eq(x, y).compare(eq(x, z)) != 0);
+}
+
+TEST_CASE("Collect terms") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    sym a = 2 * x + 3 * x + y + 1 + 2 + x * y - y;
+    a.collect();
+    REQUIRE(a == 5 * x + x * y + 3);
+    REQUIRE(a.size() == 3);
+    sym b = x * y + 2 * y * x;
+    b.collect();
+    REQUIRE(b == 3 * x * y);
+    sym c = x - x;
+    c.collect();
+    REQUIRE(c == sym(0));
+    sym d = 2 * x + 1 - x - 1;
+    d.collect();
+    REQUIRE(d == x);
+    // nested sums are absorbed
+    sym e = x + y;
+    e[e[0] == x ? 1 : 0] = x + sym(1);
+    e.collect();
+    REQUIRE(e == 2 * x + 1);
+    // numeric coefficients are folded when simplifying
+    sym f = 3 + x + x + y - y;
+    f.simplify();
+    REQUIRE(f == 2 * x + 3);
+}
+
+TEST_CASE("Collect factors") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    auto power = [](const sym &b, const sym &e) {
+        return sym(sympp::pow(b, e));
+    };
+    sym a = x * y * x * 3 * y * y * 2;
+    a.collect();
+    REQUIRE(a == 6 * power(x, sym(2)) * power(y, sym(3)));
+    sym b = x * power(x, sym(2)) * power(x, y);
+    b.collect();
+    REQUIRE(b == power(x, 3 + y));
+    sym c = power(x, sym(rational(1, 2))) * power(x, sym(rational(1, 3)));
+    c.collect();
+    REQUIRE(c == power(x, sym(rational(5, 6))));
+    sym d = x * power(x, sym(-1)) * y;
+    d.collect();
+    REQUIRE(d == y);
+    sym e = x * 0 * y;
+    e.collect();
+    REQUIRE(e == sym(0));
+    // nested products are absorbed
+    sym f = x * y;
+    f[f[0] == x ? 1 : 0] = x * y;
+    f.collect();
+    REQUIRE(f == power(x, sym(2)) * y);
+    // exponents that overflow the integers are added symbolically
+    sym g = power(x, sym(rational(1, 2147483647))) *
+            power(x, sym(rational(1, 2147483629))) *
+            power(x, sym(rational(1, 2147483587)));
+    g.simplify();
+    REQUIRE(g != x);
+    const double sum = 1. / 2147483647 + 1. / 2147483629 + 1. / 2147483587;
+    g.subs(x, 2.);
+    REQUIRE(g.evaluate({}, {}, {}) == Approx(std::pow(2., sum)));
+}
+
+TEST_CASE("Sparse polynomials") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    sym z("z");
+    auto power = [](const sym &b, const sym &e) {
+        return sym(sympp::pow(b, e));
+    };
+    sym a = power(x + y + 1, sym(2));
+    a.expand();
+    REQUIRE(a == 1 + 2 * x + 2 * y + 2 * x * y + power(x, sym(2)) +
+                     power(y, sym(2)));
+    sym b = (x + 1) * (x - 1);
+    b.expand();
+    REQUIRE(b == power(x, sym(2)) + sym(-1));
+    sym c = power(x + y + z + 1, sym(20));
+    c.expand();
+    REQUIRE(c.size() == 1771);
+    sym d = power(sym(rational(1, 2)) * x + 1, sym(2));
+    d.expand();
+    REQUIRE(d == sym(rational(1, 4)) * power(x, sym(2)) + x + 1);
+    // generators are expanded too
+    sym e = sym(sympp::cos(power(x + 1, sym(2))));
+    e.expand();
+    REQUIRE(e == sym(sympp::cos(1 + 2 * x + power(x, sym(2)))));
+    sym f = x * x + power(x, sym(2)) + 3 * x * y + y * x;
+    f.collect();
+    REQUIRE(f == 2 * power(x, sym(2)) + 4 * x * y);
+    // collect does not expand
+    sym g = x * (y + 1) + (y + 1) * x;
+    g.collect();
+    REQUIRE(g == 2 * x * (y + 1));
+}
+
+TEST_CASE("Memoized simplify") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    sym a = x * 0 * y + x + x;
+    a.simplify();
+    REQUIRE(a == 2 * x);
+    REQUIRE(a.node_as<node_interface>()->is_simplified());
+    // simplifying a normal form does not touch the tree
+    const node_interface *root = a.node_as<node_interface>();
+    a.simplify();
+    REQUIRE(a.node_as<node_interface>() == root);
+    // modifying the tree resets the flag
+    a.subs(x, y);
+    REQUIRE_FALSE(a.node_as<node_interface>()->is_simplified());
+    sym b = x + y + y;
+    b.simplify();
+    b[0] = x + x;
+    REQUIRE_FALSE(b.node_as<node_interface>()->is_simplified());
+    b.simplify();
+    REQUIRE(b == 2 * x + 2 * y);
+    // the replacement of a node is simplified too
+    sym d = sym(sympp::pow(sym(2), sym(-3))) + x;
+    d.simplify();
+    REQUIRE(d == x + sym(rational(1, 8)));
+    // identical subtrees built separately are simplified once
+    simplify_memo memo;
+    sym c = (x + x + y) * sympp::cos(x + x + y);
+    c.simplify();
+    REQUIRE(memo.hits() > 0);
+    REQUIRE(c == (2 * x + y) * sympp::cos(2 * x + y));
+    // the flag only holds for the default options
+    memo.clear();
+    c.simplify(node_interface::default_ratio,
+               &node_interface::default_measure);
+    REQUIRE(memo.lookups() == 0);
+    c.simplify(1.2, [](const node_interface &n) {
+        return static_cast<double>(n.size());
+    });
+    REQUIRE(memo.lookups() > 0);
+    REQUIRE_FALSE(c.node_as<node_interface>()->is_simplified());
+}
+
+TEST_CASE("Budgeted simplify") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    auto power = [](const sym &b, const sym &e) {
+        return sym(sympp::pow(b, e));
+    };
+    // expand pays off when the terms cancel
+    sym a = power(x + 1, sym(2)) - power(x, sym(2)) - 2 * x;
+    simplifier s;
+    REQUIRE(s(a) == sym(1));
+    REQUIRE(s.candidates() > 0);
+    REQUIRE_FALSE(s.exhausted());
+    // candidates that grow more than the ratio are rejected
+    sym b = power(x + y + 1, sym(6));
+    simplifier strict(1.0);
+    REQUIRE(strict(b) == b);
+    REQUIRE(strict.rejected() > 0);
+    // the result is never worse than the original
+    simplifier tiny = simplifier().max_nodes(1);
+    REQUIRE(tiny(a).count_ops() <= a.count_ops());
+    REQUIRE(tiny.exhausted());
+    simplifier no_time = simplifier().max_time(simplifier::clock::duration(0));
+    REQUIRE(no_time(a) == a);
+    REQUIRE(no_time.exhausted());
+    // custom measures and passes
+    simplifier custom(2.0, [](const node_interface &n) {
+        return static_cast<double>(n.size());
+    });
+    custom.clear_passes().add_pass([](sym &e) { e.expand(); });
+    REQUIRE(custom(a) == sym(1));
+    // long passes stop when the budget runs out
+    sym big = power(x + y + sym("z") + 1, sym(12));
+    simplifier small = simplifier().max_nodes(100);
+    small.clear_passes().add_pass([](sym &e) { e.expand(); });
+    REQUIRE(small(big) == big);
+    REQUIRE(small.exhausted());
+    REQUIRE(small.candidates() == 0);
+    // other than the default options run the driver
+    sym c = a;
+    c.simplify(2.0);
+    REQUIRE(c == sym(1));
+    sym d = a;
+    d.simplify(node_interface::default_ratio, [](const node_interface &n) {
+        return node_interface::default_measure(n);
+    });
+    REQUIRE(d == sym(1));
+}
+
+TEST_CASE("E-graph") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    auto power = [](const sym &b, const sym &e) {
+        return sym(sympp::pow(b, e));
+    };
+    auto ln = [](const sym &a) { return sym(sympp::log(a)); };
+    REQUIRE(e_graph::simplify(power(power(x, sym(2)), sym(3))) ==
+            power(x, sym(6)));
+    REQUIRE(e_graph::simplify(ln(x * y) - ln(x)) == ln(y));
+    REQUIRE(e_graph::simplify(ln(power(x, sym(3))) - ln(x)) == 2 * ln(x));
+    REQUIRE(e_graph::simplify(sym(sympp::sin(x + y)) -
+                              sym(sympp::sin(x)) * sym(sympp::cos(y))) ==
+            sym(sympp::cos(x)) * sym(sympp::sin(y)));
+    // saturation and limits
+    e_graph g;
+    e_graph::class_id c = g.add(ln(x) + ln(y));
+    REQUIRE(g.saturate(e_graph::limits()));
+    REQUIRE(g.equivalent(c, g.add(ln(x * y))));
+    REQUIRE(g.extract(c) == ln(x * y));
+    e_graph::limits tiny;
+    tiny.max_nodes = 1;
+    e_graph h;
+    e_graph::class_id d = h.add(ln(x * y) - ln(x));
+    REQUIRE_FALSE(h.saturate(tiny));
+    REQUIRE(h.extract(d) == ln(x * y) - ln(x));
+    // only the rules we enable are applied
+    REQUIRE(e_graph::simplify(ln(x * y) - ln(x), e_graph::limits(),
+                              e_graph::powdenest) == ln(x * y) - ln(x));
+    // custom costs
+    auto no_logs = [](const node_interface &n) {
+        return n.kind() == node_kind::log ? 100. : 1.;
+    };
+    REQUIRE(e_graph::simplify(ln(x * y), no_logs, e_graph::limits()) ==
+            ln(x) + ln(y));
+}
+
+TEST_CASE("Rewrite rules") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    sym z("z");
+    auto power = [](const sym &b, const sym &e) {
+        return sym(sympp::pow(b, e));
+    };
+    auto ln = [](const sym &a) { return sym(sympp::log(a)); };
+    sym s = sym(sympp::sin(x));
+    sym c = sym(sympp::cos(x));
+    // the built-in rules outlive the arena they are first used in
+    std::vector<std::byte> storage(1 << 16);
+    {
+        std::pmr::monotonic_buffer_resource buffer(storage.data(),
+                                                   storage.size());
+        arena a(&buffer);
+        sym t = power(s, sym(2)) + power(c, sym(2));
+        REQUIRE(t.trigsimp() == sym(1));
+        sym p = power(x, y) * power(x, z);
+        REQUIRE(p.powsimp() == power(x, y + z));
+        sym l = ln(x) + ln(y);
+        REQUIRE(l.logcombine() == ln(x * y));
+    }
+    std::fill(storage.begin(), storage.end(), std::byte{0xff});
+    // the rules match subsets of the terms and keep the others
+    sym e = power(s, sym(2)) + power(c, sym(2)) + y;
+    REQUIRE(e.trigsimp() == 1 + y);
+    sym e2 = 3 * power(s, sym(2)) + 3 * power(c, sym(2));
+    REQUIRE(e2.trigsimp() == sym(3));
+    sym e3 = power(x, y) * power(x, z) * y;
+    REQUIRE(e3.powsimp() == y * power(x, y + z));
+    sym e4 = z + ln(x) + ln(y);
+    REQUIRE(e4.logcombine() == z + ln(x * y));
+    sym e5 = 2 * ln(x);
+    REQUIRE(e5.logcombine() == ln(power(x, sym(2))));
+    // the rules rewrite subexpressions too
+    sym e6 = sym(sympp::sin(ln(x) + ln(y)));
+    REQUIRE(e6.logcombine() == sym(sympp::sin(ln(x * y))));
+    // custom rules with wildcards and conditions
+    sym a("a_");
+    sym n("n_");
+    rule_set rules;
+    rules.add(power(a, n), a * power(a, n - 1), {a, n},
+              [](const rewrite_rule::bindings &b) {
+                  return b[1].is_number() && b[1] > 1;
+              });
+    REQUIRE(rules.size() == 1);
+    sym e7 = power(x, sym(3));
+    REQUIRE(rules.rewrite(e7) > 0);
+    sym e8 = power(x, y);
+    REQUIRE(rules.rewrite(e8) == 0);
+    REQUIRE(e8 == power(x, y));
+    // the index only returns the rules that can match
+    REQUIRE(rules.candidates(x + y).empty());
+    REQUIRE(rules.candidates(power(x, y)) == std::vector<size_t>{0});
+    REQUIRE(rule_set::trigsimp().candidates(ln(x)).empty());
+}
+
+TEST_CASE("Parallel simplify") {
+    using namespace sympp;
+    auto model = [] {
+        sym f(0);
+        for (int i = 0; i < 64; ++i) {
+            sym x("x_" + std::to_string(i));
+            sym shift = x + x + 1;
+            f = f + sym(sympp::pow(shift, sym(2))) - sym(sympp::cos(shift));
+        }
+        return f;
+    };
+    sym sequential = model();
+    sequential.simplify();
+    sym expanded = model();
+    expanded.expand();
+    // a small threshold puts every few terms in a task of their own
+    thread_pool pool(3);
+    REQUIRE(pool.size() == 3);
+    {
+        parallel_scope scope(pool, 8);
+        REQUIRE(parallel_scope::current() == &scope);
+        sym f = model();
+        f.simplify(execution::par);
+        REQUIRE(f == sequential);
+        sym g = model();
+        g.expand(execution::par);
+        REQUIRE(g == expanded);
+        // the memo, the driver and the arena of this thread keep the
+        // children in this thread
+        auto threads = [](const sym &s) {
+            std::vector<sym> children(s.begin(), s.end());
+            std::vector<std::thread::id> ids;
+            std::mutex m;
+            parallel_scope::for_each_child(children, [&](sym &) {
+                std::lock_guard<std::mutex> lock(m);
+                ids.emplace_back(std::this_thread::get_id());
+            });
+            return std::all_of(ids.begin(), ids.end(), [](auto id) {
+                return id == std::this_thread::get_id();
+            });
+        };
+        {
+            simplify_memo memo;
+            REQUIRE(threads(model()));
+            sym h = model();
+            h.simplify(execution::par);
+            REQUIRE(h == sequential);
+            REQUIRE(memo.lookups() > 0);
+        }
+        {
+            arena a;
+            REQUIRE(threads(model()));
+        }
+        simplifier driver;
+        driver.max_nodes(64);
+        sym h = driver(model());
+        REQUIRE(driver.exhausted());
+        REQUIRE(h.count_ops() <= model().count_ops());
+    }
+    REQUIRE(parallel_scope::current() == nullptr);
+    // the global pool might have no workers, which runs sequentially
+    sym f = model();
+    REQUIRE(f.simplify(execution::par) == sequential);
+    // every task runs and the first exception is rethrown
+    std::vector<int> done(100, 0);
+    REQUIRE_THROWS(pool.for_each(done.size(), [&](size_t i) {
+        done[i] = 1;
+        if (i == 50) {
+            throw std::runtime_error("task failed");
+        }
+    }));
+    REQUIRE(std::all_of(done.begin(), done.end(), [](int d) { return d; }));
+    // the workers of one pool can run loops on another pool
+    thread_pool other(2);
+    std::atomic<size_t> inner{0};
+    pool.for_each(4, [&](size_t) {
+        other.for_each(4, [&](size_t) { inner.fetch_add(1); });
+    });
+    REQUIRE(inner.load() == 16);
+}
+
+TEST_CASE("Common subexpressions") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    sym c = sym(sympp::cos(2 * x));
+    sym f = c * y + c + sym(sympp::sin(c + y)) * x;
+    f.put_indexes();
+    cse e(f);
+    // cos(2*x) appears three times and is only evaluated once
+    REQUIRE(e.subexpressions() == std::vector<sym>{c});
+    REQUIRE(e.eliminated_ops() == 4);
+    REQUIRE(e.ops() + e.eliminated_ops() == e.tree_ops());
+    const std::vector<double> values{1., 2.};
+    const double expected = f.evaluate({}, {}, values);
+    REQUIRE(e.evaluate({}, {}, values) == Approx(expected));
+    REQUIRE(f.lambdify()({}, {}, values) == Approx(expected));
+    // the generated code assigns the subexpression to a temporary
+    const std::string code = f.c_code();
+    REQUIRE(code.find("double t0 = cos(") != std::string::npos);
+    REQUIRE(code.find("t1") == std::string::npos);
+    // expressions without repeated subtrees have no temporaries
+    sym g = x * y + 1;
+    g.put_indexes();
+    REQUIRE(cse(g).subexpressions().empty());
+    REQUIRE(cse(g).eliminated_ops() == 0);
+}
+
+TEST_CASE("Horner form") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    auto power = [](const sym &b, int n) {
+        return sym(sympp::pow(b, sym(n)));
+    };
+    sym p = 3 * power(x, 3) + 2 * power(x, 2) + 1;
+    sym h = p;
+    REQUIRE(h.horner() == 1 + (2 + 3 * x) * power(x, 2));
+    // the form is stable, so a second pass does nothing
+    sym again = h;
+    REQUIRE(again.horner() == h);
+    sym e = 5 * power(x, 3) + 4 * power(x, 2) + 3 * x + 2;
+    REQUIRE(e.estrin() == 2 + 3 * x + (4 + 5 * x) * power(x, 2));
+    // the terms that are not polynomials are kept, and polynomials
+    // inside functions are rewritten too
+    sym f = power(x, 2) * y + x * power(y, 3) + 4 * x + sym(sympp::sin(p));
+    f.put_indexes();
+    const std::vector<double> values{0.7, 1.3};
+    const double expected = f.evaluate({}, {}, values);
+    for (polynomial_form form : {polynomial_form::expanded,
+                                 polynomial_form::horner,
+                                 polynomial_form::estrin}) {
+        REQUIRE(cse(f, form).evaluate({}, {}, values) == Approx(expected));
+    }
+    sym g = f;
+    g.horner();
+    REQUIRE(g.evaluate({}, {}, values) == Approx(expected));
+    REQUIRE(g.count_ops() < f.count_ops());
+    REQUIRE(f.lambdify()({}, {}, values) == Approx(expected));
+    // expressions that are not polynomials do not change
+    sym s = sym(sympp::sin(x)) + x;
+    REQUIRE(sym(s).horner() == s);
+}
+
+TEST_CASE("Power lowering") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    auto lower = [](const sym &s) { return s.node_as<power>()->lower(); };
+    REQUIRE(lower(sym(sympp::pow(x, sym(5)))).op == power::lowering::integer);
+    REQUIRE(lower(sym(sympp::pow(x, sym(-1)))).exponent == -1);
+    REQUIRE(lower(sympp::sqrt(x)).op == power::lowering::square_root);
+    REQUIRE(lower(sympp::exp(x)).op == power::lowering::exp);
+    REQUIRE(lower(sym(sympp::pow(x, y))).op == power::lowering::general);
+    REQUIRE(lower(sym(sympp::pow(x, sym(1000)))).op ==
+            power::lowering::general);
+    REQUIRE(power::integer_power(1.1, 13) == Approx(std::pow(1.1, 13)));
+    REQUIRE(power::integer_power(2., -3) == 0.125);
+    REQUIRE(power::integer_power(3., 0) == 1.);
+    // no pow calls in the generated code for these exponents
+    sym f = sym(sympp::pow(x + y, sym(7))) + sympp::sqrt(x) +
+            sympp::exp(y) / x + sym(sympp::pow(x, sym(-2)));
+    f.put_indexes();
+    const std::string code = f.c_code();
+    const std::string body = code.substr(code.find('{'));
+    REQUIRE(body.find("pow(") == std::string::npos);
+    REQUIRE(body.find("sqrt(") != std::string::npos);
+    REQUIRE(body.find("exp(") != std::string::npos);
+    const std::vector<double> values{0.7, 1.3};
+    const double expected = std::pow(2., 7) + std::sqrt(1.3) +
+                            std::exp(0.7) / 1.3 + std::pow(1.3, -2);
+    REQUIRE(f.evaluate({}, {}, values) == Approx(expected));
+    REQUIRE(f.lambdify()({}, {}, values) == Approx(expected));
+    REQUIRE(cse(f).evaluate({}, {}, values) == Approx(expected));
+}
+
+TEST_CASE("Constant folding") {
+    using namespace sympp;
+    const double pi = 3.141592653589793;
+    const double e = 2.718281828459045;
+    sym x("x");
+    // the built-in constants are shared nodes with full precision
+    REQUIRE(constant::pi().node_as<node_interface>() ==
+            constant::pi().node_as<node_interface>());
+    REQUIRE(static_cast<double>(constant::pi()) == pi);
+    REQUIRE(static_cast<double>(constant::e()) == e);
+    REQUIRE(constant::is_e(sympp::exp(x)[0]));
+    REQUIRE(constant::is_e(sym(constant("euler", sym(e)))));
+    REQUIRE_FALSE(constant::is_e(constant::pi()));
+    // constant subtrees become one real
+    sym c = sym(sympp::cos(2 * constant::pi() * x)) + constant::pi() * 3 +
+            sym(sympp::sin(constant::pi() / 4));
+    sym f = c;
+    f.fold_constants();
+    REQUIRE(f.size() == 2);
+    REQUIRE(f.count_ops() < c.count_ops());
+    REQUIRE(sym(constant::pi()).fold_constants().is_number());
+    // the base of e^x is kept, so it is still lowered to exp
+    sym g = sympp::exp(x);
+    REQUIRE(sym(g).fold_constants() == g);
+    // i has no real value and is not folded
+    REQUIRE(sym(constant::i()).fold_constants().kind() == node_kind::constant);
+    f.put_indexes();
+    c.put_indexes();
+    const std::vector<double> values{0.3};
+    const double expected = std::cos(2 * pi * 0.3) + 3 * pi +
+                            std::sin(pi / 4);
+    REQUIRE(c.evaluate({}, {}, values) == Approx(expected));
+    REQUIRE(f.evaluate({}, {}, values) == Approx(expected));
+    REQUIRE(c.lambdify()({}, {}, values) == Approx(expected));
+    // the generated code takes the absolute value of a double
+    sym a = sym(sympp::abs(x - 2));
+    a.put_indexes();
+    const std::string abs_code = a.c_code();
+    REQUIRE(abs_code.find("extern double fabs(double") != std::string::npos);
+    REQUIRE(abs_code.find(" abs(") == std::string::npos);
+    REQUIRE(abs_code.find("fabs(") != std::string::npos);
+    // and spells out the non-finite numbers
+    auto code = [&](double v) {
+        sym n = x + sym(v);
+        n.put_indexes();
+        return n.c_code();
+    };
+    const double inf = std::numeric_limits<double>::infinity();
+    REQUIRE(code(inf).find("(1./0.)") != std::string::npos);
+    REQUIRE(code(-inf).find("(-1./0.)") != std::string::npos);
+    REQUIRE(code(std::nan("")).find("(0./0.)") != std::string::npos);
+}
+
+TEST_CASE("Batch evaluation") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    sym k(variable("k", numeric_type::var_integer));
+    sym b(variable("b", numeric_type::var_boolean));
+    sym c = sym(sympp::cos(2 * constant::pi() * x));
+    sym f = c * y + sym(sympp::pow(x + y, sym(3))) + sympp::sqrt(y) +
+            k * b + sym(sympp::log(y)) * c;
+    f.put_indexes();
+    std::function<size_t(const sym &, const sym &)> index_of =
+        [&](const sym &s, const sym &v) -> size_t {
+        if (s.is_variable() && s.node_as<variable>()->name_id() ==
+                                   v.node_as<variable>()->name_id()) {
+            return s.node_as<variable>()->index();
+        }
+        if (!s.is_terminal()) {
+            for (const sym &child : s) {
+                if (const size_t i = index_of(child, v); i != size_t(-1)) {
+                    return i;
+                }
+            }
+        }
+        return size_t(-1);
+    };
+    const size_t ix = index_of(f, x);
+    const size_t iy = index_of(f, y);
+    REQUIRE(ix + iy == 1);
+    // more points than a block, so the last block is partial
+    const size_t n = 1000;
+    std::vector<uint8_t> bs(n);
+    std::vector<int> ks(n);
+    std::vector<double> xs(n);
+    std::vector<double> ys(n);
+    for (size_t j = 0; j < n; ++j) {
+        bs[j] = j % 3 == 0;
+        ks[j] = static_cast<int>(j % 7);
+        xs[j] = 0.001 * j;
+        ys[j] = 1. + 0.002 * j;
+    }
+    std::vector<double> expected(n);
+    std::vector<double> values(2);
+    for (size_t j = 0; j < n; ++j) {
+        values[ix] = xs[j];
+        values[iy] = ys[j];
+        expected[j] = f.evaluate({bs[j]}, {ks[j]}, values);
+    }
+    std::vector<const double *> columns(2);
+    columns[ix] = xs.data();
+    columns[iy] = ys.data();
+    std::vector<double> out(n);
+    f.evaluate_batch(n, {bs.data()}, {ks.data()}, columns, out.data());
+    for (size_t j = 0; j < n; ++j) {
+        REQUIRE(out[j] == Approx(expected[j]));
+    }
+    std::fill(out.begin(), out.end(), 0.);
+    f.lambdify_batch()(n, {bs.data()}, {ks.data()}, columns, out.data());
+    REQUIRE(out.back() == Approx(expected.back()));
+    // the generated loop reads the point i of each column
+    const std::optional<std::string> code = cse(f).c_batch_code();
+    REQUIRE(code);
+    REQUIRE(code->find("out[i] = ") != std::string::npos);
+    REQUIRE(code->find("double_columns[") != std::string::npos);
+}
+
+TEST_CASE("SIMD kernels") {
+    using namespace sympp;
+    // distance between two doubles in units in the last place
+    auto ulps = [](double a, double b) {
+        if (a == b || (std::isnan(a) && std::isnan(b))) {
+            return 0.;
+        }
+        if (std::isnan(a) || std::isnan(b)) {
+            return std::numeric_limits<double>::infinity();
+        }
+        auto key = [](double d) {
+            int64_t i = 0;
+            std::memcpy(&i, &d, sizeof(d));
+            return i < 0 ? std::numeric_limits<int64_t>::min() - i : i;
+        };
+        return std::abs(static_cast<double>(key(a) - key(b)));
+    };
+    // odd size, so the last vector is partial
+    const size_t n = 20003;
+    std::vector<double> xs(n);
+    for (size_t j = 0; j < n; ++j) {
+        xs[j] = -50. + 100. * static_cast<double>(j) / n;
+    }
+    xs[0] = std::numeric_limits<double>::infinity();
+    xs[1] = std::nan("");
+    xs[2] = -0.;
+    xs[3] = 1e-310;
+    std::vector<double> out(n);
+    using kernel = void (*)(const double *, double *, size_t);
+    struct checked {
+        kernel f;
+        double (*reference)(double);
+        double max_ulps;
+    };
+    const std::vector<checked> kernels = {
+        {simd::exp, [](double v) { return std::exp(v); }, 1.},
+        {simd::log, [](double v) { return std::log(v); }, 1.},
+        {simd::sin, [](double v) { return std::sin(v); }, 2.},
+        {simd::cos, [](double v) { return std::cos(v); }, 2.},
+        {simd::sinh, [](double v) { return std::sinh(v); }, 2.},
+        {simd::cosh, [](double v) { return std::cosh(v); }, 2.},
+        {simd::sqrt, [](double v) { return std::sqrt(v); }, 0.},
+        {simd::abs, [](double v) { return std::abs(v); }, 0.}};
+    const simd::instruction_set best = simd::best();
+    for (simd::instruction_set set :
+         {simd::instruction_set::scalar, simd::instruction_set::avx2,
+          simd::instruction_set::avx512}) {
+        simd::use(set);
+        REQUIRE(static_cast<int>(simd::active()) <= static_cast<int>(best));
+        for (const checked &k : kernels) {
+            k.f(xs.data(), out.data(), n);
+            for (size_t j = 0; j < n; ++j) {
+                REQUIRE(ulps(out[j], k.reference(xs[j])) <= k.max_ulps);
+            }
+        }
+        // large arguments fall back to the standard library
+        const double big[] = {1e6, -3e7, 1e300};
+        double r[3];
+        simd::sin(big, r, 3);
+        for (size_t j = 0; j < 3; ++j) {
+            REQUIRE(r[j] == std::sin(big[j]));
+        }
+        simd::integer_power(xs.data(), -5, out.data(), n);
+        for (size_t j = 4; j < n; ++j) {
+            REQUIRE(out[j] == pow::integer_power(xs[j], -5));
+        }
+        std::vector<double> ys(n);
+        for (size_t j = 0; j < n; ++j) {
+            ys[j] = 0.3 * std::cos(static_cast<double>(j));
+        }
+        simd::pow(xs.data(), ys.data(), out.data(), n);
+        for (size_t j = 0; j < n; ++j) {
+            const double t = std::abs(ys[j] * std::log(xs[j]));
+            const double bound = xs[j] > 0. && t <= 16. ? 1. + 3. * t : 0.;
+            REQUIRE(ulps(out[j], std::pow(xs[j], ys[j])) <= bound);
+        }
+    }
+    simd::use(best);
+    REQUIRE(simd::active() == best);
+
+    // batches with the kernels match the scalar batches
+    // the free function sympp::cosh hides the node class
+    using cosh_node = class sympp::cosh;
+    sym x("x");
+    sym y("y");
+    sym f = sym(sympp::sin(x)) * sym(cosh_node(y / 10)) +
+            sym(sympp::pow(x, sym(5))) + sympp::sqrt(sym(sympp::abs(y))) +
+            sym(sympp::log(y * y + 1)) - sym(sympp::pow(y * y + 1, x / 7));
+    f.put_indexes();
+    std::vector<double> ys(n);
+    for (size_t j = 0; j < n; ++j) {
+        ys[j] = 1. - 0.001 * static_cast<double>(j);
+    }
+    const std::vector<const double *> columns = {xs.data() + 4, ys.data()};
+    std::vector<double> expected(n - 4);
+    f.evaluate_batch(n - 4, {}, {}, columns, expected.data());
+    std::vector<double> vectorized(n - 4);
+    f.evaluate_batch(execution::simd, n - 4, {}, {}, columns,
+                     vectorized.data());
+    for (size_t j = 0; j < n - 4; ++j) {
+        REQUIRE(vectorized[j] == Approx(expected[j]).margin(1e-12));
+    }
+    std::fill(vectorized.begin(), vectorized.end(), 0.);
+    f.lambdify_batch(execution::simd)(n - 4, {}, {}, columns,
+                                      vectorized.data());
+    REQUIRE(vectorized.back() == Approx(expected.back()));
+}
+
+TEST_CASE("Expression tape") {
+    using namespace sympp;
+    sym x("x");
+    sym y("y");
+    sym k(variable("k", numeric_type::var_integer));
+    sym c = sym(sympp::cos(2 * constant::pi() * x));
+    sym f = c * y + sym(sympp::pow(x + y, sym(3))) + sympp::sqrt(y) + k +
+            sym(sympp::log(y)) * c + sym(sympp::abs(x - 2)) / 3;
+    f.put_indexes();
+    const tape t = f.to_tape();
+    REQUIRE(!t.empty());
+    // post-order: operands come before their instructions
+    for (size_t i = 0; i < t.size(); ++i) {
+        const tape::instruction &in = t.instructions()[i];
+        REQUIRE(tape::is_leaf(in.kind) == (in.arity == 0));
+        for (uint32_t j = 0; j < in.arity; ++j) {
+            REQUIRE(t.operands()[in.first + j] < i);
+        }
+    }
+    REQUIRE(t.instructions().back().kind == node_kind::summation);
+    // the shared cosine is stored once
+    size_t cosines = 0;
+    for (const tape::instruction &in : t.instructions()) {
+        cosines += in.kind == node_kind::cos;
+    }
+    REQUIRE(cosines == 1);
+    // round trip
+    const sym g = sym::from_tape(t);
+    REQUIRE(g == f);
+    REQUIRE(g.to_tape() == t);
+    REQUIRE(g.to_tape().hash() == t.hash());
+    REQUIRE(sym(x + 1).to_tape() != t);
+    // numbers of different kinds are different leaves
+    sym z("z");
+    const sym m = 2 * y + sym(2.0) * sym(sympp::sin(z));
+    const tape tm = m.to_tape();
+    std::vector<node_kind> kinds;
+    for (const sym &term : sym::from_tape(tm)) {
+        kinds.emplace_back(std::as_const(term)[0].kind());
+    }
+    std::sort(kinds.begin(), kinds.end());
+    REQUIRE(kinds == std::vector<node_kind>{node_kind::integer,
+                                            node_kind::real});
+    REQUIRE(tm != sym(2 * y + 2 * sym(sympp::sin(z))).to_tape());
+    // the tape evaluates like the tree
+    for (double v : {0.25, 0.5, 1.5}) {
+        std::vector<double> values(2);
+        values[0] = v;
+        values[1] = 2 * v;
+        REQUIRE(t.evaluate({}, {3}, values) ==
+                Approx(f.evaluate({}, {3}, values)));
+    }
+    REQUIRE(tape().empty());
+}
+
+TEST_CASE("Bytecode interpreter") {
+    using namespace sympp;
+    using cosh_node = class sympp::cosh;
+    using sinh_node = class sympp::sinh;
+    sym x("x");
+    sym y("y");
+    sym k(variable("k", numeric_type::var_integer));
+    sym b(variable("b", numeric_type::var_boolean));
+    sym s = sym(sympp::sin(3 * x));
+    sym c = sym(sympp::cos(3 * x));
+    sym f = s * y + c * x + x / y + sym(sympp::pow(x + y, sym(5))) +
+            sympp::sqrt(y) + sym(sympp::pow(x + 2, sym(-0.5))) +
+            sympp::exp(x) + sym(sympp::log(y)) +
+            sym(sympp::log(x + 3, y + 1)) +
+            sym(sinh_node(x)) * sym(cosh_node(y)) +
+            sym(sympp::abs(x - y)) + k * b + sym(sympp::pow(y, x));
+    f.put_indexes();
+    std::function<size_t(const sym &, const sym &)> index_of =
+        [&](const sym &e, const sym &v) -> size_t {
+        if (e.is_variable() && e.node_as<variable>()->name_id() ==
+                                   v.node_as<variable>()->name_id()) {
+            return e.node_as<variable>()->index();
+        }
+        if (!e.is_terminal()) {
+            for (const sym &child : e) {
+                if (const size_t i = index_of(child, v); i != size_t(-1)) {
+                    return i;
+                }
+            }
+        }
+        return size_t(-1);
+    };
+    const size_t ix = index_of(f, x);
+    const size_t iy = index_of(f, y);
+    const bytecode program(f);
+    // the fused instructions are used
+    auto count = [&](bytecode::opcode op) {
+        size_t r = 0;
+        for (const bytecode::instruction &in : program.instructions()) {
+            r += in.op == op;
+        }
+        return r;
+    };
+    REQUIRE(count(bytecode::opcode::sincos) == 1);
+    REQUIRE(count(bytecode::opcode::sin) == 0);
+    REQUIRE(count(bytecode::opcode::cos) == 0);
+    REQUIRE(count(bytecode::opcode::mul_add) > 0);
+    REQUIRE(count(bytecode::opcode::divide) > 0);
+    REQUIRE(count(bytecode::opcode::pow_int) == 1);
+    REQUIRE(count(bytecode::opcode::rsqrt) == 1);
+    REQUIRE(program.instructions().back().op == bytecode::opcode::halt);
+    const node_lambda l = f.compile_bytecode();
+    for (double v : {0.25, 0.5, 1.5}) {
+        std::vector<double> values(2);
+        values[ix] = v;
+        values[iy] = 2 * v;
+        for (int kv : {0, 3}) {
+            const double expected = f.evaluate({1}, {kv}, values);
+            REQUIRE(program.evaluate({1}, {kv}, values) == Approx(expected));
+            REQUIRE(l({1}, {kv}, values) == Approx(expected));
+        }
+    }
+    // registers are reused, so deep expressions need few of them
+    sym g = x;
+    for (int i = 0; i < 200; ++i) {
+        g = sym(sympp::sin(g * y + 1));
+    }
+    g.put_indexes();
+    const bytecode deep_program(g);
+    REQUIRE(deep_program.instructions().size() > 400);
+    REQUIRE(deep_program.registers() < 8);
+    std::vector<double> values(2, 0.3);
+    REQUIRE(deep_program.evaluate({}, {}, values) ==
+            Approx(g.evaluate({}, {}, values)));
+    // numbers
+    REQUIRE(bytecode(sym(2.5)).evaluate({}, {}, {}) == 2.5);
+}